@@ -19,6 +19,7 @@
 #include "biquad.h"
 
 #include <math.h>
+#include <string.h>
 
 float biquad_process(Biquad *biquad, float in) {
     float out = in * biquad->a0 + biquad->z1;
@@ -28,9 +29,13 @@ float biquad_process(Biquad *biquad, float in) {
 }
 
 void biquad_configure(Biquad *biquad, BiquadType type, float frequency) {
+    // maximum sharpness (0.5 = maximum smoothness)
+    biquad_configure_q(biquad, type, frequency, 0.707);
+}
+
+void biquad_configure_q(Biquad *biquad, BiquadType type, float frequency, float q) {
     float K = tanf(M_PI * frequency);
-    float Q = 0.707;  // maximum sharpness (0.5 = maximum smoothness)
-    float norm = 1 / (1 + K / Q + K * K);
+    float norm = 1 / (1 + K / q + K * K);
     if (type == BQ_LOWPASS) {
         biquad->a0 = K * K * norm;
         biquad->a1 = 2 * biquad->a0;
@@ -39,12 +44,143 @@ void biquad_configure(Biquad *biquad, BiquadType type, float frequency) {
         biquad->a0 = 1 * norm;
         biquad->a1 = -2 * biquad->a0;
         biquad->a2 = biquad->a0;
+    } else if (type == BQ_BANDPASS) {
+        biquad->a0 = K / q * norm;
+        biquad->a1 = 0;
+        biquad->a2 = -biquad->a0;
+    } else if (type == BQ_NOTCH) {
+        biquad->a0 = (1 + K * K) * norm;
+        biquad->a1 = 2 * (K * K - 1) * norm;
+        biquad->a2 = biquad->a0;
     }
     biquad->b1 = 2 * (K * K - 1) * norm;
-    biquad->b2 = (1 - K / Q + K * K) * norm;
+    biquad->b2 = (1 - K / q + K * K) * norm;
 }
 
 void biquad_reset(Biquad *biquad) {
     biquad->z1 = 0;
     biquad->z2 = 0;
 }
+
+#define Q29_ONE (1 << 29)
+
+static int32_t float_to_q29(float value) {
+    float scaled = roundf(value * Q29_ONE);
+    if (scaled >= 2147483647.0f) {
+        return INT32_MAX;
+    } else if (scaled <= -2147483648.0f) {
+        return INT32_MIN;
+    }
+    return (int32_t) scaled;
+}
+
+void biquad_q31_configure(BiquadQ31 *biquad, BiquadType type, float frequency, float q) {
+    Biquad bq;
+    biquad_configure_q(&bq, type, frequency, q);
+    biquad->a0 = float_to_q29(bq.a0);
+    biquad->a1 = float_to_q29(bq.a1);
+    biquad->a2 = float_to_q29(bq.a2);
+    biquad->b1 = float_to_q29(bq.b1);
+    biquad->b2 = float_to_q29(bq.b2);
+}
+
+int32_t biquad_q31_process(BiquadQ31 *biquad, int32_t in) {
+    // The coefficients of a stable section sum up to less than 8 in absolute
+    // value, in Q3.29 that is below 2^32 and times samples of up to 2^31 the
+    // sum of products stays within 2^63.
+    int64_t acc = (int64_t) biquad->a0 * in;
+    acc += (int64_t) biquad->a1 * biquad->x1;
+    acc += (int64_t) biquad->a2 * biquad->x2;
+    acc -= (int64_t) biquad->b1 * biquad->y1;
+    acc -= (int64_t) biquad->b2 * biquad->y2;
+
+    acc = (acc + (1 << 28)) >> 29;
+    int32_t out;
+    if (acc > INT32_MAX) {
+        out = INT32_MAX;
+    } else if (acc < INT32_MIN) {
+        out = INT32_MIN;
+    } else {
+        out = (int32_t) acc;
+    }
+
+    biquad->x2 = biquad->x1;
+    biquad->x1 = in;
+    biquad->y2 = biquad->y1;
+    biquad->y1 = out;
+    return out;
+}
+
+void biquad_q31_reset(BiquadQ31 *biquad) {
+    biquad->x1 = 0;
+    biquad->x2 = 0;
+    biquad->y1 = 0;
+    biquad->y2 = 0;
+}
+
+void biquad_bank_init(BiquadBank *bank, uint8_t channels, uint8_t sections) {
+    memset(bank, 0, sizeof(BiquadBank));
+    bank->channels = channels < BIQUAD_BANK_MAX_CHANNELS ? channels : BIQUAD_BANK_MAX_CHANNELS;
+    bank->sections = sections < BIQUAD_BANK_MAX_SECTIONS ? sections : BIQUAD_BANK_MAX_SECTIONS;
+    for (uint8_t s = 0; s < BIQUAD_BANK_MAX_SECTIONS; ++s) {
+        for (uint8_t c = 0; c < BIQUAD_BANK_MAX_CHANNELS; ++c) {
+            bank->a0[s][c] = 1;
+        }
+    }
+}
+
+void biquad_bank_configure(
+    BiquadBank *bank, uint8_t channel, uint8_t section, BiquadType type, float frequency, float q
+) {
+    if (channel >= bank->channels || section >= bank->sections) {
+        return;
+    }
+
+    Biquad bq;
+    biquad_configure_q(&bq, type, frequency, q);
+    bank->a0[section][channel] = bq.a0;
+    bank->a1[section][channel] = bq.a1;
+    bank->a2[section][channel] = bq.a2;
+    bank->b1[section][channel] = bq.b1;
+    bank->b2[section][channel] = bq.b2;
+}
+
+void biquad_bank_process(BiquadBank *bank, const float *in, float *out) {
+    // All lanes are always processed, unused ones pass zeros through, so that
+    // the inner loop has a constant trip count and unrolls or vectorizes
+    // completely.
+    float x[BIQUAD_BANK_MAX_CHANNELS];
+    const uint8_t channels = bank->channels;
+
+    for (uint8_t c = 0; c < BIQUAD_BANK_MAX_CHANNELS; ++c) {
+        x[c] = c < channels ? in[c] : 0;
+    }
+
+    for (uint8_t s = 0; s < bank->sections; ++s) {
+        float *restrict z1 = bank->z1[s];
+        float *restrict z2 = bank->z2[s];
+        const float *restrict a0 = bank->a0[s];
+        const float *restrict a1 = bank->a1[s];
+        const float *restrict a2 = bank->a2[s];
+        const float *restrict b1 = bank->b1[s];
+        const float *restrict b2 = bank->b2[s];
+
+        for (uint8_t c = 0; c < BIQUAD_BANK_MAX_CHANNELS; ++c) {
+            float y = x[c] * a0[c] + z1[c];
+            z1[c] = x[c] * a1[c] + z2[c] - b1[c] * y;
+            z2[c] = x[c] * a2[c] - b2[c] * y;
+            x[c] = y;
+        }
+    }
+
+    for (uint8_t c = 0; c < BIQUAD_BANK_MAX_CHANNELS; ++c) {
+        if (c < channels) {
+            out[c] = x[c];
+        }
+    }
+}
+
+void biquad_bank_reset(BiquadBank *bank) {
+    memset(bank->z1, 0, sizeof(bank->z1));
+    memset(bank->z2, 0, sizeof(bank->z2));
+}
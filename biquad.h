@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 typedef struct {
 	float a0, a1, a2, b1, b2;
 	float z1, z2;
@@ -25,11 +27,88 @@ typedef struct {
 
 typedef enum {
     BQ_LOWPASS,
-    BQ_HIGHPASS
+    BQ_HIGHPASS,
+    BQ_BANDPASS,
+    BQ_NOTCH
 } BiquadType;
 
 float biquad_process(Biquad *biquad, float in);
 
+/**
+ * Configures a Butterworth-like section with Q = 0.707.
+ *
+ * @param frequency Cutoff (center for bandpass and notch) frequency as a
+ * fraction of the sampling frequency.
+ */
 void biquad_configure(Biquad *biquad, BiquadType type, float frequency);
 
+/**
+ * Configures the section with an explicit @p q. Higher Q means a sharper knee
+ * for lowpass/highpass and a narrower band for bandpass/notch.
+ */
+void biquad_configure_q(Biquad *biquad, BiquadType type, float frequency, float q);
+
 void biquad_reset(Biquad *biquad);
+
+/**
+ * Fixed-point direct form I biquad for integer-only paths. Samples are Q31
+ * (full scale = +-1.0), coefficients Q3.29 so that the sum of all five products
+ * fits the 64-bit accumulator even with full scale samples. The output
+ * saturates, so a full scale input can't wrap around.
+ */
+typedef struct {
+    int32_t a0, a1, a2, b1, b2;
+    int32_t x1, x2, y1, y2;
+} BiquadQ31;
+
+#define BIQUAD_Q31_ONE 2147483647
+
+/**
+ * Designs the section with biquad_configure_q() and quantizes the
+ * coefficients, arguments are the same.
+ */
+void biquad_q31_configure(BiquadQ31 *biquad, BiquadType type, float frequency, float q);
+
+int32_t biquad_q31_process(BiquadQ31 *biquad, int32_t in);
+
+void biquad_q31_reset(BiquadQ31 *biquad);
+
+#define BIQUAD_BANK_MAX_CHANNELS 4
+#define BIQUAD_BANK_MAX_SECTIONS 4
+
+/**
+ * A bank of filters processing several independent channels, each through the
+ * same number of cascaded sections, in one call. Coefficients and state are
+ * laid out as arrays per section indexed by channel, so the per-section loop
+ * over channels is straight-line independent arithmetic that the compiler can
+ * interleave on the FPU and vectorize on the host.
+ */
+typedef struct {
+    uint8_t channels;
+    uint8_t sections;
+    float a0[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+    float a1[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+    float a2[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+    float b1[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+    float b2[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+    float z1[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+    float z2[BIQUAD_BANK_MAX_SECTIONS][BIQUAD_BANK_MAX_CHANNELS];
+} BiquadBank;
+
+/**
+ * Sets the bank up for @p channels x @p sections with all sections passing the
+ * input through unchanged and the state reset.
+ */
+void biquad_bank_init(BiquadBank *bank, uint8_t channels, uint8_t sections);
+
+void biquad_bank_configure(
+    BiquadBank *bank, uint8_t channel, uint8_t section, BiquadType type, float frequency, float q
+);
+
+/**
+ * Filters one sample of every channel, @p in and @p out hold `channels`
+ * samples and may point to the same array.
+ */
+void biquad_bank_process(BiquadBank *bank, const float *in, float *out);
+
+void biquad_bank_reset(BiquadBank *bank);
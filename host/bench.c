@@ -0,0 +1,167 @@
+// Measures the cost of the per-cycle motor data and traction control update
+// against a synthetic ride: a slow erpm/current swing with noise and a burst of
+// wheel spin every two seconds.
+
+#include "vesc_host.h"
+
+#include "../loop_timing.h"
+#include "../motor_data.h"
+#include "../traction.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    float t;
+    uint32_t seed;
+} Ride;
+
+static float noise(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+static void ride_step(VescHostPlant *plant, float dt, void *arg) {
+    Ride *ride = arg;
+    ride->t += dt;
+
+    float base = 4000.0f + 3000.0f * sinf(ride->t * 0.5f);
+    float slip_phase = fmodf(ride->t, 2.0f);
+    float slip = slip_phase < 0.1f ? 100000.0f * slip_phase : 0.0f;
+
+    plant->erpm = base + slip + 20.0f * noise(&ride->seed);
+    plant->current = 15.0f + 10.0f * sinf(ride->t * 0.7f) + noise(&ride->seed);
+    plant->duty_cycle = plant->erpm / 20000.0f;
+}
+
+static double elapsed_s(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+typedef struct {
+    long activations;
+    long wheelslip_cycles;
+    uint32_t recorded_events;
+    double seconds;
+    LoopTiming timing;
+} Result;
+
+// Runs the loop with the plant stepping and the clock advancing, with or
+// without the update itself, so that the cost of the harness can be
+// subtracted.
+static Result run(long iterations, bool update) {
+    vesc_host_init(VESC_HOST_CLOCK_VIRTUAL);
+
+    Ride ride = {.t = 0, .seed = 1};
+    vesc_host_set_step(ride_step, &ride);
+
+    config cfg = {0};
+    cfg.hertz = 832;
+    cfg.wheelslip_accelstart = 29;
+    cfg.wheelslip_accelend = 2;
+    cfg.wheelslip_scaleaccel = 5;
+    cfg.wheelslip_scaleerpm = 3000;
+    uint32_t loop_time_us = 1000000 / cfg.hertz;
+
+    MotorData motor = {0};
+    TractionData traction = {0};
+    TractionDebug traction_dbg = {0};
+    TractionRecorder recorder;
+    State state = {0};
+    RuntimeData rt = {0};
+
+    state_init(&state, false);
+    motor_data_reset(&motor);
+    motor_data_configure(&motor, 3.0f / cfg.hertz);
+    configure_traction(&traction, &cfg, &traction_dbg);
+    reset_traction(&traction, &state);
+    traction_recorder_reset(&recorder);
+    traction_dbg.recorder = &recorder;
+
+    Result res = {0};
+    loop_timing_reset(&res.timing);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (long i = 0; i < iterations; ++i) {
+        vesc_host_advance(loop_time_us);
+        rt.current_time = VESC_IF->system_time();
+
+        if (!update) {
+            continue;
+        }
+
+        bool was_wheelslip = state.wheelslip;
+        LOOP_TIMING_BEGIN(&res.timing);
+        motor_data_update(&motor);
+        LOOP_TIMING_MARK(&res.timing, LOOP_STAGE_MOTOR_DATA);
+        check_traction(&motor, &traction, &state, &rt, &traction_dbg);
+        LOOP_TIMING_MARK(&res.timing, LOOP_STAGE_TRACTION);
+        LOOP_TIMING_END(&res.timing);
+
+        if (state.wheelslip) {
+            ++res.wheelslip_cycles;
+            if (!was_wheelslip) {
+                ++res.activations;
+            }
+        }
+    }
+
+    res.seconds = elapsed_s(&start);
+    res.recorded_events = recorder.count;
+    return res;
+}
+
+#ifdef LOOP_TIMING
+static void print_stage(const char *name, const LoopStageTiming *s) {
+    if (s->count == 0) {
+        return;
+    }
+
+    printf(
+        "  %-12s min %7.3f  mean %7.3f  max %9.3f us\n",
+        name,
+        (float) s->min / LOOP_TIMING_TICKS_PER_US,
+        loop_timing_mean(s) / LOOP_TIMING_TICKS_PER_US,
+        (float) s->max / LOOP_TIMING_TICKS_PER_US
+    );
+
+    printf("  %-12s", "");
+    for (int b = 0; b < LOOP_TIMING_BUCKETS; b++) {
+        if (s->histogram[b]) {
+            printf(" 2^%d:%u", b, s->histogram[b]);
+        }
+    }
+    printf("\n");
+}
+#endif
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+
+    Result harness = run(iterations, false);
+    Result res = run(iterations, true);
+    double update_s = res.seconds - harness.seconds;
+
+    printf("iterations:      %ld\n", iterations);
+    printf("simulated time:  %.1f s\n", VESC_IF->system_time());
+    printf("activations:     %ld\n", res.activations);
+    printf("wheelslip:       %.2f %%\n", 100.0 * res.wheelslip_cycles / iterations);
+    printf("recorded events: %u\n", res.recorded_events);
+    printf("harness:         %.1f ns/iteration\n", 1e9 * harness.seconds / iterations);
+    printf("update:          %.1f ns/iteration\n", 1e9 * update_s / iterations);
+    printf("throughput:      %.2f M iterations/s\n", iterations / update_s / 1e6);
+
+#ifdef LOOP_TIMING
+    printf("stages (ticks: 2^n ns):\n");
+    print_stage("motor data", &res.timing.stages[LOOP_STAGE_MOTOR_DATA]);
+    print_stage("traction", &res.timing.stages[LOOP_STAGE_TRACTION]);
+    print_stage("total", &res.timing.stages[LOOP_STAGE_TOTAL]);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Compares the cost per sample of the float biquad, the Q31 biquad and a
+// three channel BiquadBank against the same input. Cycles are the host TSC on
+// x86, elsewhere only nanoseconds are reported.
+
+#include "../biquad.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#define BLOCK 4096
+
+typedef struct {
+    double seconds;
+    double cycles;
+} Timing;
+
+typedef struct {
+    struct timespec time;
+    uint64_t tsc;
+} Stamp;
+
+static float in_float[BLOCK];
+static int32_t in_q31[BLOCK];
+static volatile float sink_float;
+static volatile int32_t sink_q31;
+
+static Stamp stamp(void) {
+    Stamp s;
+    clock_gettime(CLOCK_MONOTONIC, &s.time);
+#if HAVE_TSC
+    s.tsc = __rdtsc();
+#else
+    s.tsc = 0;
+#endif
+    return s;
+}
+
+static Timing since(const Stamp *start, long samples) {
+    Stamp end = stamp();
+    double seconds =
+        (end.time.tv_sec - start->time.tv_sec) + (end.time.tv_nsec - start->time.tv_nsec) * 1e-9;
+    return (Timing) {
+        .seconds = seconds / samples,
+        .cycles = (double) (end.tsc - start->tsc) / samples,
+    };
+}
+
+static void print_timing(const char *name, Timing t) {
+    printf("%-22s %6.2f ns/sample", name, 1e9 * t.seconds);
+    if (HAVE_TSC) {
+        printf("  %6.1f cycles/sample", t.cycles);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    long blocks = argc > 1 ? atol(argv[1]) : 5000;
+    long samples = blocks * BLOCK;
+
+    uint32_t seed = 1;
+    for (int i = 0; i < BLOCK; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        in_float[i] = (seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+        in_q31[i] = (int32_t) (in_float[i] * 2147483648.0f);
+    }
+
+    Biquad bq;
+    biquad_configure_q(&bq, BQ_LOWPASS, 0.01f, 0.707f);
+    biquad_reset(&bq);
+
+    Stamp start = stamp();
+    float acc_float = 0;
+    for (long b = 0; b < blocks; ++b) {
+        for (int i = 0; i < BLOCK; ++i) {
+            acc_float += biquad_process(&bq, in_float[i]);
+        }
+    }
+    Timing t_float = since(&start, samples);
+    sink_float = acc_float;
+
+    BiquadQ31 bq31;
+    biquad_q31_configure(&bq31, BQ_LOWPASS, 0.01f, 0.707f);
+    biquad_q31_reset(&bq31);
+
+    start = stamp();
+    int32_t acc_q31 = 0;
+    for (long b = 0; b < blocks; ++b) {
+        for (int i = 0; i < BLOCK; ++i) {
+            acc_q31 ^= biquad_q31_process(&bq31, in_q31[i]);
+        }
+    }
+    Timing t_q31 = since(&start, samples);
+    sink_q31 = acc_q31;
+
+    BiquadBank bank;
+    biquad_bank_init(&bank, 3, 1);
+    for (uint8_t c = 0; c < 3; ++c) {
+        biquad_bank_configure(&bank, c, 0, BQ_LOWPASS, 0.01f * (c + 1), 0.707f);
+    }
+
+    start = stamp();
+    acc_float = 0;
+    for (long b = 0; b < blocks; ++b) {
+        for (int i = 0; i < BLOCK - 2; ++i) {
+            float out[3];
+            biquad_bank_process(&bank, &in_float[i], out);
+            acc_float += out[0] + out[1] + out[2];
+        }
+    }
+    // per channel sample, to compare with the single filters
+    Timing t_bank = since(&start, blocks * (BLOCK - 2) * 3);
+    sink_float = acc_float;
+
+    printf("samples:               %ld\n", samples);
+    print_timing("float biquad:", t_float);
+    print_timing("q31 biquad:", t_q31);
+    print_timing("bank, per channel:", t_bank);
+
+    return 0;
+}
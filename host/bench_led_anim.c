@@ -0,0 +1,423 @@
+// Renders the Refloat LED animations with the fixed-point keyframe tables and
+// with the float code they replaced, 10k frames at 30 Hz of each on strips of
+// a few lengths, and reports the largest difference of a channel and the cost
+// per frame of both. Cycles are the host TSC on x86, elsewhere only
+// nanoseconds are reported. Exits non-zero if a channel is off by more than
+// the animation allows.
+
+#include "led_anim.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#define FRAMES 10000
+#define MAX_LENGTH 60
+// Rounding of the weights to 1/256
+#define MAX_ERROR 2
+// The end of a knight rider tail steps from 0 to the backlight, a beam
+// position rounded to 1/256 LED can fall on the other side of it
+#define MAX_ERROR_KNIGHT_RIDER 16
+
+#define COLOR1 0x00FF7830
+#define COLOR2 0x800070FF
+#define BRIGHTNESS 0.8f
+
+typedef enum {
+    ANIM_FADE,
+    ANIM_STROBE,
+    ANIM_PULSE,
+    ANIM_KNIGHT_RIDER,
+    ANIM_DISABLED,
+    ANIM_TRANS_FADE,
+    ANIM_COUNT
+} Anim;
+
+static const char *anim_names[ANIM_COUNT] = {
+    "fade", "strobe", "pulse", "knight rider", "disabled", "transition fade"
+};
+
+static const uint8_t lengths[] = {7, 20, 60};
+
+typedef struct {
+    double seconds;
+    double cycles;
+} Timing;
+
+typedef struct {
+    struct timespec time;
+    uint64_t tsc;
+} Stamp;
+
+static uint32_t out_float[MAX_LENGTH];
+static uint32_t out_fixed[MAX_LENGTH];
+static volatile uint32_t sink;
+
+static Stamp stamp(void) {
+    Stamp s;
+    clock_gettime(CLOCK_MONOTONIC, &s.time);
+#if HAVE_TSC
+    s.tsc = __rdtsc();
+#else
+    s.tsc = 0;
+#endif
+    return s;
+}
+
+static Timing since(const Stamp *start, long frames) {
+    Stamp end = stamp();
+    double seconds =
+        (end.time.tv_sec - start->time.tv_sec) + (end.time.tv_nsec - start->time.tv_nsec) * 1e-9;
+    return (Timing) {
+        .seconds = seconds / frames,
+        .cycles = (double) (end.tsc - start->tsc) / frames,
+    };
+}
+
+// The float reference, as leds.c had it
+
+#define R(c) ((uint8_t) ((c) >> 16))
+#define G(c) ((uint8_t) ((c) >> 8))
+#define B(c) ((uint8_t) (c))
+#define W(c) ((uint8_t) ((c) >> 24))
+#define RGBW(r, g, b, w) ((uint32_t) (w) << 24 | (r) << 16 | (g) << 8 | (b))
+
+static float clampf(float v, float min, float max) {
+    return v < min ? min : v > max ? max : v;
+}
+
+static uint32_t color_blend(uint32_t color1, uint32_t color2, float blend) {
+    if (blend <= 0.0f) {
+        return color1;
+    } else if (blend >= 1.0f) {
+        return color2;
+    }
+
+    float blend1 = 1.0f - blend;
+
+    uint8_t r = R(color1) * blend1 + R(color2) * blend;
+    uint8_t g = G(color1) * blend1 + G(color2) * blend;
+    uint8_t b = B(color1) * blend1 + B(color2) * blend;
+    uint8_t w = W(color1) * blend1 + W(color2) * blend;
+
+    return RGBW(r, g, b, w);
+}
+
+static void led_set_color(uint32_t *out, uint8_t i, uint32_t color, float br, float blend) {
+    if (blend <= 0.0f) {
+        return;
+    }
+
+    uint8_t r = R(color) * br + 0.5f;
+    uint8_t g = G(color) * br + 0.5f;
+    uint8_t b = B(color) * br + 0.5f;
+    uint8_t w = W(color) * br + 0.5f;
+
+    if (blend < 1.0f) {
+        uint32_t orig_color = out[i];
+        float orig_blend = 1.0f - blend;
+
+        r = r * blend + R(orig_color) * orig_blend;
+        g = g * blend + G(orig_color) * orig_blend;
+        b = b * blend + B(orig_color) * orig_blend;
+        w = w * blend + W(orig_color) * orig_blend;
+    }
+
+    out[i] = RGBW(r, g, b, w);
+}
+
+static float cosine_progress(float time) {
+    uint32_t rounded = lroundf(time);
+    float x = (time - rounded) * M_PI;
+    float cos = 10 * x * x / (4 * x * x + 4 * M_PI * M_PI);
+    if (rounded % 2 == 1) {
+        cos = 1 - cos;
+    }
+    return cos;
+}
+
+static void float_pulse(uint32_t *out, uint8_t length, float time, float center) {
+    float p = cosine_progress(time);
+
+    float half = length / 2.0f - center;
+    float offset = half * (1.0f - p);
+    float feather = length / 4.0f;
+
+    float fade = 1.0f;
+    float ratio = center / half;
+    if (time < ratio) {
+        fade = time / ratio;
+    }
+
+    for (uint8_t i = 0; i < length; ++i) {
+        float dist1 = i - offset + 1.0f;
+        float dist2 = length - offset - i;
+        float k1 = clampf(dist1 / feather, 0.0f, 1.0f);
+        float k2 = clampf(dist2 / feather, 0.0f, 1.0f);
+
+        uint32_t color = color_blend(COLOR2, COLOR1, fminf(k1, k2) * fade);
+        led_set_color(out, i, color, BRIGHTNESS, 1.0f);
+    }
+}
+
+static void float_knight_rider(uint32_t *out, uint8_t length, float time) {
+    const uint8_t tail = length / 3 + 1;
+
+    time *= 0.7f;
+    float backlight = time > 0.3f ? 0.08f : 0.0f;
+    float x1 = length * fmodf(time, 2.0f) - 0.5f * length - 1.0f;
+    float x2 = 1.5f * length - length * fmodf(time - 1.0f, 2.0f);
+
+    for (uint8_t i = 0; i < length; ++i) {
+        float k1 = backlight;
+        float dist1 = fabsf(x1 - i);
+        if (i <= x1) {
+            if (dist1 <= tail) {
+                k1 = (tail - dist1) / tail;
+            }
+        } else if (i < x1 + 1) {
+            k1 = x1 - floorf(x1);
+        }
+
+        float k2 = backlight;
+        float dist2 = fabsf(x2 - i);
+        if (i >= x2) {
+            if (dist2 <= tail) {
+                k2 = (tail - dist2) / tail;
+            }
+        } else if (i > x2 - 1) {
+            k2 = 1 - x2 + floorf(x2);
+        }
+
+        uint32_t color = color_blend(COLOR2, COLOR1, fmaxf(k1, k2));
+        led_set_color(out, i, color, BRIGHTNESS, 1.0f);
+    }
+}
+
+static void render_float(Anim anim, uint32_t *out, uint8_t length, float time) {
+    switch (anim) {
+    case ANIM_FADE: {
+        uint32_t color = color_blend(COLOR2, COLOR1, cosine_progress(time));
+        for (uint8_t i = 0; i < length; ++i) {
+            led_set_color(out, i, color, BRIGHTNESS, 1.0f);
+        }
+        break;
+    }
+    case ANIM_STROBE: {
+        uint32_t color = fmodf(time, 2.0f) >= 1.0f ? COLOR2 : COLOR1;
+        for (uint8_t i = 0; i < length; ++i) {
+            led_set_color(out, i, color, BRIGHTNESS, 1.0f);
+        }
+        break;
+    }
+    case ANIM_PULSE:
+        float_pulse(out, length, time, length / 5.0f);
+        break;
+    case ANIM_KNIGHT_RIDER:
+        float_knight_rider(out, length, time);
+        break;
+    case ANIM_DISABLED:
+        float_pulse(out, length, time / 2.0f, length / 3.0f);
+        break;
+    case ANIM_TRANS_FADE: {
+        // Toward COLOR2 and back over the period, on top of the previous frame
+        float prog = cosine_progress(time);
+        for (uint8_t i = 0; i < length; ++i) {
+            led_set_color(out, i, COLOR2, BRIGHTNESS * (1.0f - 0.5f * prog), prog);
+        }
+        break;
+    }
+    case ANIM_COUNT:
+        break;
+    }
+}
+
+// The fixed point, as leds.c has it
+
+static uint32_t to_fixed(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    } else if (value >= 1.0f) {
+        return LED_ANIM_ONE;
+    }
+    return value * LED_ANIM_ONE + 0.5f;
+}
+
+static void led_set(uint32_t *out, uint8_t i, uint32_t color, uint32_t br, uint32_t blend) {
+    if (blend == 0) {
+        return;
+    }
+
+    color = led_anim_scale(color, br);
+    if (blend < LED_ANIM_ONE) {
+        color = led_anim_blend(out[i], color, blend);
+    }
+    out[i] = color;
+}
+
+static void fixed_pulse(
+    uint32_t *out, const LedAnimStrip *strip, uint8_t length, float time, float center
+) {
+    LedAnimPulse pulse;
+    led_anim_pulse_begin(&pulse, strip, time, center);
+
+    uint32_t br = to_fixed(BRIGHTNESS);
+    for (uint8_t i = 0; i < length; ++i) {
+        uint32_t k = led_anim_pulse_weight(&pulse, strip, i);
+        led_set(out, i, led_anim_blend(COLOR2, COLOR1, k), br, LED_ANIM_ONE);
+    }
+}
+
+static void render_fixed(
+    Anim anim, uint32_t *out, const LedAnimStrip *strip, uint8_t length, float time
+) {
+    uint32_t br = to_fixed(BRIGHTNESS);
+
+    switch (anim) {
+    case ANIM_FADE: {
+        uint32_t p = led_anim_progress(led_anim_phase(time));
+        uint32_t color = led_anim_blend(COLOR2, COLOR1, p);
+        for (uint8_t i = 0; i < length; ++i) {
+            led_set(out, i, color, br, LED_ANIM_ONE);
+        }
+        break;
+    }
+    case ANIM_STROBE: {
+        uint32_t color = led_anim_phase(time) >= LED_ANIM_PERIOD / 2 ? COLOR2 : COLOR1;
+        for (uint8_t i = 0; i < length; ++i) {
+            led_set(out, i, color, br, LED_ANIM_ONE);
+        }
+        break;
+    }
+    case ANIM_PULSE:
+        fixed_pulse(out, strip, length, time, length / 5.0f);
+        break;
+    case ANIM_KNIGHT_RIDER: {
+        LedAnimKnightRider kr;
+        led_anim_knight_rider_begin(&kr, strip, time);
+        for (uint8_t i = 0; i < length; ++i) {
+            uint32_t k = led_anim_knight_rider_weight(&kr, strip, i);
+            led_set(out, i, led_anim_blend(COLOR2, COLOR1, k), br, LED_ANIM_ONE);
+        }
+        break;
+    }
+    case ANIM_DISABLED:
+        fixed_pulse(out, strip, length, time / 2.0f, length / 3.0f);
+        break;
+    case ANIM_TRANS_FADE: {
+        float prog = led_anim_progress(led_anim_phase(time)) / (float) LED_ANIM_ONE;
+        uint32_t trans_br = to_fixed(BRIGHTNESS * (1.0f - 0.5f * prog));
+        uint32_t blend = to_fixed(prog);
+        for (uint8_t i = 0; i < length; ++i) {
+            led_set(out, i, COLOR2, trans_br, blend);
+        }
+        break;
+    }
+    case ANIM_COUNT:
+        break;
+    }
+}
+
+static float frame_time(long frame) {
+    return frame / 30.0f;
+}
+
+static int channel_error(uint32_t a, uint32_t b) {
+    int max = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int diff = abs((int) ((a >> shift) & 0xFF) - (int) ((b >> shift) & 0xFF));
+        if (diff > max) {
+            max = diff;
+        }
+    }
+    return max;
+}
+
+// The largest channel difference over all frames, each frame rendered by both
+// on top of the same previous frame
+static int check(Anim anim, uint8_t length) {
+    LedAnimStrip strip;
+    led_anim_compile(&strip, length);
+
+    int max_error = 0;
+    for (long f = 0; f < FRAMES; ++f) {
+        float time = frame_time(f);
+        memcpy(out_fixed, out_float, sizeof(out_float));
+        render_float(anim, out_float, length, time);
+        render_fixed(anim, out_fixed, &strip, length, time);
+
+        for (uint8_t i = 0; i < length; ++i) {
+            int error = channel_error(out_float[i], out_fixed[i]);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+    }
+    return max_error;
+}
+
+int main(void) {
+    bool ok = true;
+
+    printf("%-16s %9s %22s %22s\n", "", "max error", "float", "fixed point");
+    for (Anim anim = 0; anim < ANIM_COUNT; ++anim) {
+        int max_error = 0;
+        for (size_t l = 0; l < sizeof(lengths); ++l) {
+            int error = check(anim, lengths[l]);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+
+        LedAnimStrip strip;
+        led_anim_compile(&strip, MAX_LENGTH);
+
+        Stamp start = stamp();
+        for (long f = 0; f < FRAMES; ++f) {
+            render_float(anim, out_float, MAX_LENGTH, frame_time(f));
+            sink = out_float[f % MAX_LENGTH];
+        }
+        Timing t_float = since(&start, FRAMES);
+
+        start = stamp();
+        for (long f = 0; f < FRAMES; ++f) {
+            render_fixed(anim, out_fixed, &strip, MAX_LENGTH, frame_time(f));
+            sink = out_fixed[f % MAX_LENGTH];
+        }
+        Timing t_fixed = since(&start, FRAMES);
+
+        bool anim_ok =
+            max_error <= (anim == ANIM_KNIGHT_RIDER ? MAX_ERROR_KNIGHT_RIDER : MAX_ERROR);
+        ok &= anim_ok;
+        printf(
+            "%-16s %9d %10.0f ns/frame %10.0f ns/frame  %s\n",
+            anim_names[anim],
+            max_error,
+            1e9 * t_float.seconds,
+            1e9 * t_fixed.seconds,
+            anim_ok ? "ok" : "FAIL"
+        );
+        if (HAVE_TSC) {
+            printf(
+                "%-16s %9s %10.0f cyc/frame %9.0f cyc/frame\n",
+                "",
+                "",
+                t_float.cycles,
+                t_fixed.cycles
+            );
+        }
+    }
+
+    printf("%d frames of %d LEDs\n", FRAMES, MAX_LENGTH);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// Compares the table-driven WS2812 encoding of the Refloat LED driver against
+// the per-bit loop it replaced, bit for bit over every byte value in every
+// channel, both color orders and RGB/RGBW, then the cost per LED of both.
+// Cycles are the host TSC on x86, elsewhere only nanoseconds are reported.
+// Exits non-zero if the outputs differ.
+
+#include "ws2812.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+// A long strip
+#define LEDS 120
+
+typedef struct {
+    double seconds;
+    double cycles;
+} Timing;
+
+typedef struct {
+    struct timespec time;
+    uint64_t tsc;
+} Stamp;
+
+static uint32_t colors[LEDS];
+static uint16_t out_ref[LEDS * 32];
+static uint16_t out_table[LEDS * 32];
+static volatile uint16_t sink;
+
+static Stamp stamp(void) {
+    Stamp s;
+    clock_gettime(CLOCK_MONOTONIC, &s.time);
+#if HAVE_TSC
+    s.tsc = __rdtsc();
+#else
+    s.tsc = 0;
+#endif
+    return s;
+}
+
+static Timing since(const Stamp *start, long leds) {
+    Stamp end = stamp();
+    double seconds =
+        (end.time.tv_sec - start->time.tv_sec) + (end.time.tv_nsec - start->time.tv_nsec) * 1e-9;
+    return (Timing) {
+        .seconds = seconds / leds,
+        .cycles = (double) (end.tsc - start->tsc) / leds,
+    };
+}
+
+static void print_timing(const char *name, Timing t) {
+    printf("%-22s %6.2f ns/LED", name, 1e9 * t.seconds);
+    if (HAVE_TSC) {
+        printf("  %6.1f cycles/LED", t.cycles);
+    }
+    printf("\n");
+}
+
+static inline uint8_t cgamma(uint8_t c) {
+    return (c * c + c) / 256;
+}
+
+// led_driver_paint before the tables
+static void encode_reference(
+    uint16_t *bitbuffer, const uint32_t *data, uint32_t length, uint8_t bit_nr, LedColorOrder order
+) {
+    for (uint32_t i = 0; i < length; ++i) {
+        uint32_t color = data[i];
+        uint8_t w = cgamma((color >> 24) & 0xFF);
+        uint8_t r = cgamma((color >> 16) & 0xFF);
+        uint8_t g = cgamma((color >> 8) & 0xFF);
+        uint8_t b = cgamma(color & 0xFF);
+
+        if (order == LED_COLOR_GRB) {
+            color = (g << 16) | (r << 8) | b;
+        } else {
+            color = (r << 16) | (g << 8) | b;
+        }
+
+        if (bit_nr == 32) {
+            color <<= 8;
+            color |= w;
+        }
+
+        for (int8_t bit = bit_nr - 1; bit >= 0; --bit) {
+            bitbuffer[bit + i * bit_nr] = color & 0x1 ? WS2812_ONE : WS2812_ZERO;
+            color >>= 1;
+        }
+    }
+}
+
+static bool check_exact(void) {
+    static const LedColorOrder orders[] = {LED_COLOR_GRB, LED_COLOR_RGB};
+    static const uint8_t bit_nrs[] = {24, 32};
+
+    for (int o = 0; o < 2; ++o) {
+        for (int n = 0; n < 2; ++n) {
+            // Every value in every channel, then random colors
+            for (uint32_t base = 0; base < 256 + 4 * LEDS; base += LEDS) {
+                for (uint32_t i = 0; i < LEDS; ++i) {
+                    uint32_t v = base + i;
+                    colors[i] = v < 256 ? (v & 0xFF) * 0x01010101u ^ 0x00FF00FFu
+                                        : (uint32_t) rand() ^ (uint32_t) rand() << 16;
+                }
+
+                memset(out_ref, 0, sizeof(out_ref));
+                memset(out_table, 0, sizeof(out_table));
+                encode_reference(out_ref, colors, LEDS, bit_nrs[n], orders[o]);
+                ws2812_encode(out_table, colors, LEDS, bit_nrs[n], orders[o]);
+                if (memcmp(out_ref, out_table, sizeof(out_ref)) != 0) {
+                    printf("order %d, %d bits: output differs  FAIL\n", orders[o], bit_nrs[n]);
+                    return false;
+                }
+            }
+        }
+    }
+
+    printf("bit-exact:             ok\n");
+    return true;
+}
+
+int main(int argc, char **argv) {
+    long frames = argc > 1 ? atol(argv[1]) : 100000;
+
+    srand(1);
+    if (!check_exact()) {
+        return 1;
+    }
+
+    for (int i = 0; i < LEDS; ++i) {
+        colors[i] = rand();
+    }
+
+    Stamp start = stamp();
+    for (long f = 0; f < frames; ++f) {
+        colors[f % LEDS] ^= f;
+        encode_reference(out_ref, colors, LEDS, 32, LED_COLOR_GRB);
+        sink = out_ref[f % LEDS];
+    }
+    Timing t_ref = since(&start, frames * LEDS);
+
+    start = stamp();
+    for (long f = 0; f < frames; ++f) {
+        colors[f % LEDS] ^= f;
+        ws2812_encode(out_table, colors, LEDS, 32, LED_COLOR_GRB);
+        sink = out_table[f % LEDS];
+    }
+    Timing t_table = since(&start, frames * LEDS);
+
+    printf("LEDs:                  %ld\n", frames * LEDS);
+    print_timing("per-bit loop:", t_ref);
+    print_timing("tables:", t_table);
+
+    return 0;
+}
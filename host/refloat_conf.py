@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+# Generates the Refloat config sources that `vesc_tool --xmlConfToCode` would
+# generate from settings.xml, for the host build of Refloat where vesc_tool is
+# not available.
+#
+# Only what running the package needs is generated: conf_default.h,
+# conf_general.h, the config signature and confparser_set_defaults_*(). The
+# serializer and the XML blob are stubs, the host never exchanges the config
+# with VESC Tool.
+#
+# usage: refloat_conf.py settings.xml conf_general.h.in version outdir
+
+import os
+import sys
+import xml.etree.ElementTree as ET
+import zlib
+
+TYPE_DOUBLE = 1
+TYPE_INT = 2
+TYPE_ENUM = 4
+TYPE_BOOL = 5
+
+
+def default_value(param):
+    kind = int(param.findtext('type'))
+    if kind == TYPE_DOUBLE:
+        return repr(float(param.findtext('valDouble')))
+    if kind in (TYPE_INT, TYPE_ENUM, TYPE_BOOL):
+        return str(int(param.findtext('valInt')))
+    return None
+
+
+def write(path, text):
+    # Leave the file alone when unchanged, so that make doesn't rebuild
+    # everything including it
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+def main():
+    if len(sys.argv) != 5:
+        sys.exit('usage: refloat_conf.py settings.xml conf_general.h.in version outdir')
+    settings, general_in, version_file, outdir = sys.argv[1:]
+
+    root = ET.parse(settings).getroot()
+    name = root.find('Params/config_name/valString').text
+    lower = name.lower()
+    params = {p.tag: p for p in root.find('Params')}
+    ser_order = [s.text for s in root.findall('SerOrder/ser')]
+
+    defaults = []
+    for param in params.values():
+        define = param.findtext('cDefine')
+        value = default_value(param)
+        if define and value is not None:
+            defaults.append('#define %s %s\n' % (define, value))
+
+    signature = zlib.crc32(
+        ''.join('%s:%s;' % (s, params[s].findtext('type')) for s in ser_order).encode()
+    )
+
+    with open(version_file) as f:
+        version = f.read().strip()
+    with open(general_in) as f:
+        general = f.read()
+    general = general.replace('{{VERSION}}', version)
+    general = general.replace('{{MAJOR_MINOR}}', '.'.join(version.split('.')[:2]))
+
+    set_defaults = ''.join(
+        '    conf->%s = %s;\n' % (s, params[s].findtext('cDefine')) for s in ser_order
+    )
+
+    os.makedirs(outdir, exist_ok=True)
+    write(os.path.join(outdir, 'conf_default.h'), '#pragma once\n\n' + ''.join(defaults))
+    write(os.path.join(outdir, 'conf_general.h'), general)
+    write(
+        os.path.join(outdir, 'confparser.h'),
+        '#pragma once\n\n'
+        '#include "datatypes.h"\n\n'
+        '#include <stdbool.h>\n'
+        '#include <stdint.h>\n\n'
+        '#define %s_SIGNATURE %uu\n\n'
+        'int32_t confparser_serialize_%s(uint8_t *buffer, const %s *conf);\n'
+        'bool confparser_deserialize_%s(const uint8_t *buffer, %s *conf);\n'
+        'void confparser_set_defaults_%s(%s *conf);\n'
+        % (name.upper(), signature, lower, name, lower, name, lower, name),
+    )
+    write(
+        os.path.join(outdir, 'confparser.c'),
+        '#include "confparser.h"\n'
+        '#include "conf_default.h"\n\n'
+        'int32_t confparser_serialize_%s(uint8_t *buffer, const %s *conf) {\n'
+        '    (void) buffer;\n'
+        '    (void) conf;\n'
+        '    return 0;\n'
+        '}\n\n'
+        'bool confparser_deserialize_%s(const uint8_t *buffer, %s *conf) {\n'
+        '    (void) buffer;\n'
+        '    (void) conf;\n'
+        '    return false;\n'
+        '}\n\n'
+        'void confparser_set_defaults_%s(%s *conf) {\n'
+        '%s'
+        '}\n' % (lower, name, lower, name, lower, name, set_defaults),
+    )
+    write(
+        os.path.join(outdir, 'confxml.h'),
+        '#pragma once\n\n'
+        '#include <stdint.h>\n\n'
+        'extern uint8_t data_%s_[];\n\n'
+        '#define DATA_%s__SIZE 0\n' % (lower, name.upper()),
+    )
+    write(
+        os.path.join(outdir, 'confxml.c'),
+        '#include "confxml.h"\n\n'
+        'uint8_t data_%s_[1];\n' % lower,
+    )
+
+
+if __name__ == '__main__':
+    main()
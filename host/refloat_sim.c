@@ -0,0 +1,585 @@
+// Rides the Refloat package, built unmodified from vesc_pkg/refloat/src, on a
+// simulated board: a deck balanced on a hub motor under a rider whose weight
+// shift chases a target speed, over terrain with slopes, drops and slippery
+// patches. Refloat runs its own thread on the virtual clock, sees the board
+// through the IMU callback and the motor getters and drives it through
+// set_current(), so a scenario takes a fraction of its ridden time.
+//
+// The model, nose-up pitch and forward motion positive:
+//   deck    J_deck * pitch'' = motor torque - rider torque - leg damping
+//   rider   torque = M g lean - M h a, lean being the horizontal offset of the
+//           rider's centre of mass from the axle, set by a PI controller on
+//           the speed error with a reaction time lag
+//   wheel   J_wheel * wheel' = motor torque - traction * r, the traction
+//           sticking up to mu * N and sliding at 0.8 of that beyond
+//   board   M * a = traction - slope, rolling and air resistance
+//   motor   torque = kt * current, forward current fading out as the duty
+//           cycle approaches 1
+//
+// usage: refloat_sim [--csv DIR] [scenario...]
+//   --csv DIR   write a 100 Hz time series of each scenario to DIR/<name>.csv
+//   scenarios   hill, drop, wheelslip, pushback (default: all of them)
+
+#include "vesc_host.h"
+
+#include "conf/buffer.h"
+#include "led_driver.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TICK_US 50
+#define IMU_HZ 1000
+#define TELEMETRY_HZ 100
+
+#define G 9.81f
+#define MASS 90.0f  // rider and board
+#define COM_HEIGHT 1.0f  // rider centre of mass above the axle
+#define DECK_INERTIA 4.0f  // deck plus what the rider's legs couple into it
+#define LEG_DAMPING 30.0f  // Nms/rad
+#define WHEEL_RADIUS 0.14f
+#define WHEEL_INERTIA 0.1f
+#define POLE_PAIRS 15
+#define ERPM_PER_VOLT 150.0f
+#define KT 0.83f  // Nm/A
+#define PHASE_RESISTANCE 0.1f
+#define CURRENT_TAU 0.0005f
+#define BATTERY_VOLTAGE 63.0f
+#define ROLLING_RESISTANCE 0.015f
+#define AIR_DRAG 0.3f  // N/(m/s)^2
+#define PITCH_STOP 0.26f  // nose or tail on the ground
+#define LANDING_G 2.5f
+#define LANDING_TIME 0.04f
+
+#define RIDER_REACTION 0.15f
+#define RIDER_ACCEL_GAIN 0.6f  // desired m/s^2 per m/s of speed error
+#define RIDER_MAX_ACCEL 1.5f
+#define RIDER_INTEGRAL_GAIN 0.01f  // lean in m per m/s*s of speed error
+#define RIDER_MAX_LEAN 0.3f
+#define PUSHBACK_FEEL 2.0f  // nose-up degrees the rider reads as pushback
+#define PUSHBACK_FEEL_TIME 0.25f
+#define PUSHBACK_SETTLE_TIME 2.0f
+
+#define RTDATA_STATE 14
+#define RTDATA_BALANCE_PITCH 6
+#define RTDATA_SETPOINT 24
+#define STATE_RUNNING_WHEELSLIP 3
+#define SAT_PB_DUTY 3
+
+typedef struct {
+    float slope;  // rad, uphill positive
+    float mu;
+    bool airborne;
+    bool footpads;
+    float target_speed;  // m/s
+} Conditions;
+
+typedef struct {
+    const char *name;
+    const char *description;
+    float duration;
+    float event;  // time the interesting part starts, for time to pushback
+    bool rider_eases_off;  // rider slows down when feeling pushback
+    void (*script)(float t, Conditions *c);
+} Scenario;
+
+typedef struct {
+    const Scenario *scenario;
+    FILE *csv;
+    Conditions cond;
+
+    float t;
+    float pitch, pitch_rate;
+    float speed, wheel_speed;  // ground and wheel surface speed
+    float accel;
+    float current;
+    float position;
+    bool slipping;
+    float landing_timer;
+    bool was_airborne;
+
+    float lean;
+    float lean_integral;
+    float settled_pitch;
+    float pushback_timer;
+    float eased_speed;  // speed the rider settles for after feeling pushback
+
+    float imu_timer;
+    float telemetry_timer;
+
+    // Last telemetry from Refloat
+    uint8_t state;
+    uint8_t sat;
+    float balance_pitch;
+    float setpoint;
+
+    // Metrics
+    bool engaged;
+    float engage_time;
+    double error_sq_sum;
+    uint32_t error_samples;
+    float max_current, min_current;
+    float max_slip;
+    float slip_time;
+    float wheelslip_flag_time;
+    float pushback_time;
+    float pushback_duty;
+    uint32_t disengages;
+} Sim;
+
+static void hill(float t, Conditions *c) {
+    c->target_speed = t > 2 ? 4 : 0;
+    float ramp = fminf(fmaxf(t - 6, 0), 1) - fminf(fmaxf(t - 14, 0), 1);
+    c->slope = ramp * 0.15f;
+}
+
+static void drop(float t, Conditions *c) {
+    c->target_speed = t > 2 ? 4 : 0;
+    c->airborne = t > 7 && t < 7.35f;
+}
+
+static void wheelslip(float t, Conditions *c) {
+    c->target_speed = t > 6 ? 6 : t > 2 ? 3 : 0;
+    if (t > 6.2f && t < 6.8f) {
+        c->mu = 0.15f;
+    }
+}
+
+static void pushback(float t, Conditions *c) {
+    c->target_speed = fminf(fmaxf(t - 2, 0) * 0.8f, 10);
+}
+
+static const Scenario scenarios[] = {
+    {"hill", "4 m/s up a 15% grade and back onto the flat", 18, 6, false, hill},
+    {"drop", "4 m/s off a 0.6 m ledge", 11, 7, false, drop},
+    {"wheelslip", "hard acceleration over a wet patch (mu 0.15)", 10, 6.2f, false, wheelslip},
+    {"pushback", "accelerating towards top speed until duty pushback", 18, 2, true, pushback},
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// Refloat's entry point, INIT_FUN in main.c
+bool init(lib_info *info);
+
+// led_driver.c programs the STM32 timer and DMA, LEDs are not simulated
+bool led_driver_init(
+    LedDriver *driver, LedPin pin, LedType type, LedColorOrder color_order, uint8_t led_nr
+) {
+    (void) driver;
+    (void) pin;
+    (void) type;
+    (void) color_order;
+    (void) led_nr;
+    return false;
+}
+
+void led_driver_paint(LedDriver *driver, uint32_t *data, uint32_t length) {
+    (void) driver;
+    (void) data;
+    (void) length;
+}
+
+void led_driver_destroy(LedDriver *driver) {
+    (void) driver;
+}
+
+static float clampf(float v, float min, float max) {
+    return v < min ? min : v > max ? max : v;
+}
+
+static float erpm_of(float wheel_speed) {
+    return wheel_speed / WHEEL_RADIUS * 60.0f / (2.0f * (float) M_PI) * POLE_PAIRS;
+}
+
+static void on_app_data(unsigned char *data, unsigned int len, void *arg) {
+    Sim *sim = arg;
+    if (len < RTDATA_SETPOINT + 4 || data[0] != 101 || data[1] != 1) {
+        return;
+    }
+
+    int32_t ind = RTDATA_BALANCE_PITCH;
+    sim->balance_pitch = buffer_get_float32_auto(data, &ind);
+    sim->state = data[RTDATA_STATE] & 0xF;
+    sim->sat = data[RTDATA_STATE] >> 4;
+    ind = RTDATA_SETPOINT;
+    sim->setpoint = buffer_get_float32_auto(data, &ind);
+}
+
+static void rider_update(Sim *sim, float dt) {
+    float target = sim->cond.target_speed;
+
+    // Pushback is the nose rising against the stance the rider has settled
+    // into, which is nose-down for as long as the board accelerates
+    sim->settled_pitch += (sim->pitch - sim->settled_pitch) * dt / PUSHBACK_SETTLE_TIME;
+    if (sim->scenario->rider_eases_off) {
+        float rise = (sim->pitch - sim->settled_pitch) * 180.0f / (float) M_PI;
+        sim->pushback_timer = rise > PUSHBACK_FEEL ? sim->pushback_timer + dt : 0;
+        if (sim->pushback_timer > PUSHBACK_FEEL_TIME && sim->eased_speed == 0) {
+            sim->eased_speed = 0.85f * sim->speed;
+        }
+        if (sim->eased_speed > 0) {
+            target = fminf(target, sim->eased_speed);
+        }
+    }
+
+    // Until the board balances there's nothing to lean against
+    float lean_target = 0;
+    if (sim->engaged && sim->state != 0 && sim->state < 6) {
+        float error = target - sim->speed;
+        float accel = clampf(RIDER_ACCEL_GAIN * error, -RIDER_MAX_ACCEL, RIDER_MAX_ACCEL);
+        sim->lean_integral = clampf(
+            sim->lean_integral + RIDER_INTEGRAL_GAIN * error * dt, -RIDER_MAX_LEAN, RIDER_MAX_LEAN
+        );
+        lean_target = accel * (WHEEL_RADIUS + COM_HEIGHT) / G + sim->lean_integral;
+    } else {
+        sim->lean_integral = 0;
+    }
+
+    lean_target = clampf(lean_target, -RIDER_MAX_LEAN, RIDER_MAX_LEAN);
+    sim->lean += (lean_target - sim->lean) * dt / RIDER_REACTION;
+}
+
+static void motor_update(Sim *sim, const VescHostPlant *plant, float dt) {
+    float erpm = erpm_of(sim->wheel_speed);
+    float duty = erpm / (ERPM_PER_VOLT * BATTERY_VOLTAGE);
+
+    float cmd;
+    if (plant->released) {
+        cmd = 0;
+    } else if (plant->set_brake_current != 0) {
+        cmd = fabsf(erpm) > 10 ? -copysignf(plant->set_brake_current, erpm) : 0;
+    } else {
+        cmd = plant->set_current;
+    }
+
+    // The back-EMF leaves less and less voltage to drive current with
+    if (cmd * duty > 0) {
+        float headroom = fmaxf(1 - fabsf(duty), 0) * BATTERY_VOLTAGE / PHASE_RESISTANCE;
+        cmd = clampf(cmd, -headroom, headroom);
+    }
+
+    sim->current += (cmd - sim->current) * dt / CURRENT_TAU;
+}
+
+static void physics_update(Sim *sim, float dt) {
+    const Conditions *c = &sim->cond;
+    float torque = KT * sim->current;
+
+    float normal = c->airborne ? 0 : MASS * G * cosf(c->slope);
+    float rolling = ROLLING_RESISTANCE * normal * clampf(sim->speed / 0.1f, -1, 1);
+    float resist = MASS * G * sinf(c->slope) * (c->airborne ? 0 : 1) + rolling +
+        AIR_DRAG * sim->speed * fabsf(sim->speed);
+
+    // Traction that keeps the wheel rolling without slip, if friction allows
+    float rolling_traction = (torque * WHEEL_RADIUS / WHEEL_INERTIA + resist / MASS) /
+        (1 / MASS + WHEEL_RADIUS * WHEEL_RADIUS / WHEEL_INERTIA);
+    float grip = c->mu * normal;
+    float slip = sim->wheel_speed - sim->speed;
+
+    if (!sim->slipping && fabsf(rolling_traction) > grip) {
+        sim->slipping = true;
+    }
+    float traction = rolling_traction;
+    if (sim->slipping) {
+        float dir = fabsf(slip) > 1e-4f ? copysignf(1, slip) : copysignf(1, rolling_traction);
+        traction = 0.8f * grip * dir;
+    }
+
+    sim->accel = (traction - resist) / MASS;
+    sim->speed += sim->accel * dt;
+    sim->wheel_speed +=
+        (torque - traction * WHEEL_RADIUS) * WHEEL_RADIUS / WHEEL_INERTIA * dt;
+    sim->position += sim->speed * dt;
+
+    float new_slip = sim->wheel_speed - sim->speed;
+    if (sim->slipping) {
+        // Slid back to rolling speed, or close to it with enough grip to hold
+        if (normal > 0 &&
+            (new_slip * slip < 0 ||
+             (fabsf(new_slip) < 0.01f && fabsf(rolling_traction) <= grip))) {
+            sim->slipping = false;
+            sim->wheel_speed = sim->speed;
+        }
+    } else {
+        sim->wheel_speed = sim->speed;
+    }
+
+    if (sim->was_airborne && !c->airborne) {
+        sim->landing_timer = LANDING_TIME;
+    }
+    sim->was_airborne = c->airborne;
+    sim->landing_timer = fmaxf(sim->landing_timer - dt, 0);
+
+    // Weightless in the air, the rider pushes on neither end of the deck
+    float rider = c->airborne ? 0 : MASS * (G * sim->lean - COM_HEIGHT * sim->accel);
+    float pitch_accel = (torque - rider - LEG_DAMPING * sim->pitch_rate) / DECK_INERTIA;
+    sim->pitch_rate += pitch_accel * dt;
+    sim->pitch += sim->pitch_rate * dt;
+
+    if (fabsf(sim->pitch) > PITCH_STOP && !c->airborne) {
+        sim->pitch = copysignf(PITCH_STOP, sim->pitch);
+        sim->pitch_rate = 0;
+    }
+}
+
+static void sensors_update(Sim *sim, VescHostPlant *plant) {
+    const Conditions *c = &sim->cond;
+    float erpm = erpm_of(sim->wheel_speed);
+
+    plant->erpm = erpm;
+    plant->duty_cycle = erpm / (ERPM_PER_VOLT * BATTERY_VOLTAGE);
+    plant->current = sim->current;
+    plant->current_in = sim->current * plant->duty_cycle;
+    plant->speed = sim->speed;
+    plant->distance = sim->position;
+
+    float adc = c->footpads ? 3.0f : 0.0f;
+    plant->adc[0] = adc;
+    plant->adc[1] = adc;
+
+    // Specific force in g in the world frame, then in the sensor frame, which
+    // reads -sin(pitch), 0, cos(pitch) at rest
+    float fx = 0, fz = 0;
+    if (!c->airborne) {
+        fx = sim->accel / G;
+        fz = 1 + (sim->landing_timer > 0 ? LANDING_G : 0);
+    }
+    float sp = sinf(sim->pitch);
+    float cp = cosf(sim->pitch);
+    plant->accel[0] = -(fx * cp + fz * sp);
+    plant->accel[1] = 0;
+    plant->accel[2] = fz * cp - fx * sp;
+
+    plant->gyro[0] = 0;
+    plant->gyro[1] = sim->pitch_rate * 180.0f / (float) M_PI;
+    plant->gyro[2] = 0;
+
+    plant->pitch = sim->pitch;
+    plant->quaternions[0] = cosf(sim->pitch / 2);
+    plant->quaternions[2] = sinf(sim->pitch / 2);
+}
+
+static void record(Sim *sim, float dt) {
+    float pitch_deg = sim->pitch * 180.0f / (float) M_PI;
+    bool running = sim->state >= 1 && sim->state <= 5;
+
+    if (running && !sim->engaged) {
+        sim->engaged = true;
+        sim->engage_time = sim->t;
+    } else if (!running && sim->engaged && sim->state != 0) {
+        ++sim->disengages;
+        sim->engaged = false;
+    }
+
+    if (running) {
+        float error = pitch_deg - sim->setpoint;
+        sim->error_sq_sum += error * error;
+        ++sim->error_samples;
+    }
+
+    if (sim->state == STATE_RUNNING_WHEELSLIP) {
+        sim->wheelslip_flag_time += dt;
+    }
+
+    if (sim->sat == SAT_PB_DUTY && sim->pushback_time < 0 && sim->t >= sim->scenario->event) {
+        sim->pushback_time = sim->t - sim->scenario->event;
+        sim->pushback_duty = erpm_of(sim->wheel_speed) / (ERPM_PER_VOLT * BATTERY_VOLTAGE);
+    }
+
+    if (sim->csv) {
+        fprintf(
+            sim->csv,
+            "%.3f,%.2f,%.2f,%d,%.3f,%.3f,%.0f,%.3f,%.3f,%.3f,%.3f,%.2f,%.4f,%u,%u\n",
+            sim->t,
+            sim->cond.slope * 180.0f / (float) M_PI,
+            sim->cond.mu,
+            sim->cond.airborne,
+            sim->speed,
+            sim->wheel_speed,
+            erpm_of(sim->wheel_speed),
+            erpm_of(sim->wheel_speed) / (ERPM_PER_VOLT * BATTERY_VOLTAGE),
+            pitch_deg,
+            sim->balance_pitch,
+            sim->setpoint,
+            sim->current,
+            sim->lean,
+            sim->state,
+            sim->sat
+        );
+    }
+}
+
+static void step(VescHostPlant *plant, float dt, void *arg) {
+    Sim *sim = arg;
+    sim->t += dt;
+
+    Conditions *c = &sim->cond;
+    *c = (Conditions) {.mu = 1.0f, .footpads = sim->t > 0.5f};
+    sim->scenario->script(sim->t, c);
+
+    rider_update(sim, dt);
+    motor_update(sim, plant, dt);
+    physics_update(sim, dt);
+    sensors_update(sim, plant);
+
+    if (sim->current > sim->max_current) {
+        sim->max_current = sim->current;
+    }
+    if (sim->current < sim->min_current) {
+        sim->min_current = sim->current;
+    }
+    float slip = fabsf(sim->wheel_speed - sim->speed);
+    if (slip > sim->max_slip) {
+        sim->max_slip = slip;
+    }
+    if (sim->slipping && !c->airborne) {
+        sim->slip_time += dt;
+    }
+
+    // Everything else is asleep while the clock moves, so Refloat's callbacks
+    // run here just as they would from the IMU and comm threads
+    sim->imu_timer += dt;
+    if (sim->imu_timer >= 1.0f / IMU_HZ - 1e-6f) {
+        vesc_host_imu_sample(sim->imu_timer);
+        sim->imu_timer = 0;
+    }
+
+    sim->telemetry_timer += dt;
+    if (sim->telemetry_timer >= 1.0f / TELEMETRY_HZ - 1e-6f) {
+        unsigned char cmd[2] = {101, 1};  // COMMAND_GET_RTDATA
+        vesc_host_app_data_receive(cmd, sizeof(cmd));
+        record(sim, sim->telemetry_timer);
+        sim->telemetry_timer = 0;
+    }
+}
+
+static double elapsed_s(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static void configure_vesc(void) {
+    VESC_IF->set_cfg_float(CFG_PARAM_l_current_max, 80);
+    VESC_IF->set_cfg_float(CFG_PARAM_l_current_min, -80);
+    VESC_IF->set_cfg_float(CFG_PARAM_l_max_duty, 0.95f);
+    VESC_IF->set_cfg_float(CFG_PARAM_l_temp_fet_start, 85);
+    VESC_IF->set_cfg_float(CFG_PARAM_l_temp_motor_start, 100);
+    VESC_IF->set_cfg_float(CFG_PARAM_IMU_mahony_kp, 0.4f);
+
+    VescHostPlant *plant = vesc_host_plant();
+    plant->input_voltage = BATTERY_VOLTAGE;
+    plant->temp_fet = 40;
+    plant->temp_motor = 40;
+}
+
+static bool run(const Scenario *scenario, const char *csv_dir) {
+    Sim sim = {.scenario = scenario, .pushback_time = -1};
+
+    if (csv_dir) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.csv", csv_dir, scenario->name);
+        sim.csv = fopen(path, "w");
+        if (!sim.csv) {
+            perror(path);
+            return false;
+        }
+        fprintf(
+            sim.csv,
+            "time,slope,mu,airborne,speed,wheel_speed,erpm,duty,pitch,balance_pitch,setpoint,"
+            "current,lean,state,sat\n"
+        );
+    }
+
+    printf("%s: %s\n", scenario->name, scenario->description);
+
+    vesc_host_init(VESC_HOST_CLOCK_VIRTUAL);
+    vesc_host_set_tick(TICK_US);
+    configure_vesc();
+    vesc_host_set_app_data_sink(on_app_data, &sim);
+
+    lib_info info = {0};
+    if (!init(&info)) {
+        fprintf(stderr, "%s: Refloat failed to start\n", scenario->name);
+        return false;
+    }
+    // The firmware hands info.arg back through get_arg()
+    *VESC_IF->get_arg(0) = info.arg;
+
+    vesc_host_set_step(step, &sim);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    vesc_host_run_until(scenario->duration);
+    double seconds = elapsed_s(&start);
+
+    vesc_host_set_step(NULL, NULL);
+    info.stop_fun(info.arg);
+
+    if (sim.csv) {
+        fclose(sim.csv);
+    }
+
+    printf("  simulated         %.1f s in %.2f s, %.0fx real time\n",
+           scenario->duration, seconds, scenario->duration / seconds);
+    if (!sim.engaged && sim.disengages == 0) {
+        printf("  never engaged\n");
+        return true;
+    }
+    printf("  engaged at        %.2f s, %u disengagements\n", sim.engage_time, sim.disengages);
+    printf("  pitch error RMS   %.2f deg\n",
+           sim.error_samples ? sqrt(sim.error_sq_sum / sim.error_samples) : 0.0);
+    printf("  current peaks     %.1f A, %.1f A\n", sim.max_current, sim.min_current);
+    printf("  wheel slip        %.2f m/s max, %.2f s slipping, %.2f s flagged by Refloat\n",
+           sim.max_slip, sim.slip_time, sim.wheelslip_flag_time);
+    if (sim.pushback_time >= 0) {
+        printf("  time to pushback  %.2f s, at %.0f%% duty\n",
+               sim.pushback_time, 100 * sim.pushback_duty);
+    } else {
+        printf("  time to pushback  -\n");
+    }
+    printf("  final speed       %.2f m/s\n", sim.speed);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *csv_dir = NULL;
+    const Scenario *selected[SCENARIO_COUNT];
+    size_t count = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_dir = argv[++i];
+            continue;
+        }
+
+        const Scenario *s = NULL;
+        for (size_t j = 0; j < SCENARIO_COUNT; ++j) {
+            if (strcmp(argv[i], scenarios[j].name) == 0) {
+                s = &scenarios[j];
+            }
+        }
+        if (!s || count == SCENARIO_COUNT) {
+            fprintf(stderr, "usage: refloat_sim [--csv DIR] [hill|drop|wheelslip|pushback...]\n");
+            return 1;
+        }
+        selected[count++] = s;
+    }
+
+    if (count == 0) {
+        for (size_t j = 0; j < SCENARIO_COUNT; ++j) {
+            selected[count++] = &scenarios[j];
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!run(selected[i], csv_dir)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
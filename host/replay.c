@@ -0,0 +1,328 @@
+#include "replay.h"
+
+#include "vesc_host.h"
+
+#include "../motor_data.h"
+#include "../traction.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE_MAX_LEN 1024
+#define MAX_COLUMNS 32
+
+static const int exit_reasons[] = {
+    TRACTION_EXIT_NONE,
+    TRACTION_EXIT_ACCEL_DIRECTION,
+    TRACTION_EXIT_ACCEL_SLOWED,
+    TRACTION_EXIT_REVERSE_RECOVERED,
+    TRACTION_EXIT_NO_DECEL,
+    TRACTION_EXIT_NO_DECEL_MAGNITUDE,
+    TRACTION_EXIT_TIMEOUT,
+};
+
+_Static_assert(
+    sizeof(exit_reasons) / sizeof(exit_reasons[0]) == REPLAY_EXIT_REASONS,
+    "REPLAY_EXIT_REASONS doesn't match the exit reasons"
+);
+
+int replay_exit_index(int reason) {
+    for (size_t i = 0; i < sizeof(exit_reasons) / sizeof(exit_reasons[0]); ++i) {
+        if (exit_reasons[i] == reason) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static int find_column(char **names, int count, const char *name) {
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int split_line(char *line, char **fields) {
+    int n = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(line, ",\r\n", &save); tok && n < MAX_COLUMNS;
+         tok = strtok_r(NULL, ",\r\n", &save)) {
+        while (*tok == ' ') {
+            ++tok;
+        }
+        fields[n++] = tok;
+    }
+    return n;
+}
+
+bool replay_load_csv(ReplayLog *log, const char *path) {
+    memset(log, 0, sizeof(ReplayLog));
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+
+    const char *base = strrchr(path, '/');
+    snprintf(log->name, sizeof(log->name), "%s", base ? base + 1 : path);
+
+    char header[LINE_MAX_LEN];
+    char *names[MAX_COLUMNS];
+    if (!fgets(header, sizeof(header), f)) {
+        fprintf(stderr, "%s: empty log\n", path);
+        fclose(f);
+        return false;
+    }
+
+    int columns = split_line(header, names);
+    int col_time = find_column(names, columns, "time");
+    int col_erpm = find_column(names, columns, "erpm");
+    int col_current = find_column(names, columns, "current");
+    int col_duty = find_column(names, columns, "duty");
+    int col_braking = find_column(names, columns, "braking");
+    int col_slip = find_column(names, columns, "slip");
+
+    if (col_erpm < 0 || col_current < 0) {
+        fprintf(stderr, "%s: the log needs erpm and current columns\n", path);
+        fclose(f);
+        return false;
+    }
+
+    log->has_time = col_time >= 0;
+    log->has_slip = col_slip >= 0;
+
+    uint32_t capacity = 4096;
+    log->samples = malloc(capacity * sizeof(ReplaySample));
+
+    char line[LINE_MAX_LEN];
+    char *fields[MAX_COLUMNS];
+    while (log->samples && fgets(line, sizeof(line), f)) {
+        int n = split_line(line, fields);
+        if (n <= col_erpm || n <= col_current) {
+            continue;
+        }
+
+        if (log->count == capacity) {
+            capacity *= 2;
+            ReplaySample *samples = realloc(log->samples, capacity * sizeof(ReplaySample));
+            if (!samples) {
+                free(log->samples);
+                log->samples = NULL;
+                break;
+            }
+            log->samples = samples;
+        }
+
+        ReplaySample *s = &log->samples[log->count++];
+        s->time = col_time >= 0 && col_time < n ? strtof(fields[col_time], NULL) : 0;
+        s->erpm = strtof(fields[col_erpm], NULL);
+        s->current = strtof(fields[col_current], NULL);
+        s->duty = col_duty >= 0 && col_duty < n ? strtof(fields[col_duty], NULL) : 0;
+        if (col_braking >= 0 && col_braking < n) {
+            s->braking = atoi(fields[col_braking]) != 0;
+        } else {
+            s->braking = s->current != 0 && (s->current < 0) != (s->erpm < 0);
+        }
+        s->slip = col_slip >= 0 && col_slip < n && atoi(fields[col_slip]) != 0;
+    }
+
+    fclose(f);
+
+    if (!log->samples) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+void replay_free(ReplayLog *log) {
+    free(log->samples);
+    log->samples = NULL;
+    log->count = 0;
+}
+
+void replay_default_config(config *cfg) {
+    memset(cfg, 0, sizeof(config));
+    cfg->hertz = 832;
+    cfg->is_traction_enabled = true;
+    cfg->wheelslip_accelstart = 29;
+    cfg->wheelslip_accelend = 2;
+    cfg->wheelslip_scaleaccel = 5;
+    cfg->wheelslip_scaleerpm = 3000;
+}
+
+static double elapsed_s(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+void replay_run(const ReplayLog *log, config *cfg, ReplayMetrics *metrics, FILE *trace) {
+    memset(metrics, 0, sizeof(ReplayMetrics));
+
+    MotorData motor = {0};
+    TractionData traction = {0};
+    TractionDebug traction_dbg = {0};
+    State state = {0};
+    RuntimeData rt = {0};
+
+    state_init(&state, false);
+    state.state = STATE_RUNNING;
+    motor_data_reset(&motor);
+    motor_data_configure(&motor, 3.0f / cfg->hertz);
+    configure_traction(&traction, cfg, &traction_dbg);
+    reset_traction(&traction, &state);
+
+    VescHostPlant *plant = vesc_host_plant();
+    float t0 = log->count > 0 ? log->samples[0].time : 0;
+    float loop_time = 1.0f / cfg->hertz;
+
+    bool in_slip = false;
+    bool slip_detected = false;
+    float slip_start = 0;
+    bool activation_overlaps = false;
+
+    if (trace) {
+        fprintf(
+            trace,
+            "time,erpm,current,acceleration,slip,wheelslip,reverse_wheelslip,highaccelon,"
+            "accelstartval,timeron,timeroff,exit_reason\n"
+        );
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t i = 0; i < log->count; ++i) {
+        const ReplaySample *s = &log->samples[i];
+
+        plant->erpm = s->erpm;
+        plant->current = s->current;
+        plant->duty_cycle = s->duty;
+        rt.current_time = log->has_time ? s->time - t0 : i * loop_time;
+        state.braking_pos = s->braking;
+
+        bool was_wheelslip = state.wheelslip;
+
+        motor_data_update(&motor);
+        check_traction(&motor, &traction, &state, &rt, &traction_dbg);
+
+        if (state.wheelslip) {
+            ++metrics->wheelslip_cycles;
+            if (!was_wheelslip) {
+                ++metrics->activations;
+                activation_overlaps = false;
+            }
+            activation_overlaps |= s->slip;
+        }
+
+        // Traction control can't start again in the cycle it ended in
+        if (was_wheelslip && !state.wheelslip) {
+            metrics->total_duration += traction.timeroff - traction.timeron;
+            ++metrics->exits[replay_exit_index(traction_dbg.debug4)];
+            if (log->has_slip && !activation_overlaps) {
+                ++metrics->false_trips;
+            }
+        }
+
+        if (log->has_slip) {
+            if (s->slip && !in_slip) {
+                in_slip = true;
+                slip_start = rt.current_time;
+                slip_detected = false;
+                ++metrics->slips;
+            }
+
+            if (in_slip && state.wheelslip && !slip_detected) {
+                slip_detected = true;
+                ++metrics->detected_slips;
+                metrics->total_latency +=
+                    was_wheelslip ? 0 : rt.current_time - slip_start;
+            }
+
+            if (!s->slip && in_slip) {
+                in_slip = false;
+                if (!slip_detected) {
+                    ++metrics->missed_slips;
+                }
+            }
+        }
+
+        if (trace) {
+            fprintf(
+                trace,
+                "%.6f,%.1f,%.2f,%.3f,%d,%d,%d,%d,%.3f,%.6f,%.6f,%d\n",
+                rt.current_time,
+                motor.erpm,
+                motor.current,
+                motor.acceleration,
+                s->slip,
+                state.wheelslip,
+                traction.reverse_wheelslip,
+                traction.highaccelon,
+                traction.accelstartval,
+                traction.timeron,
+                traction.timeroff,
+                (int) traction_dbg.debug4
+            );
+        }
+    }
+
+    metrics->seconds = elapsed_s(&start);
+    metrics->samples = log->count;
+    metrics->labelled = log->has_slip;
+
+    if (state.wheelslip && log->has_slip && !activation_overlaps) {
+        ++metrics->false_trips;
+    }
+    if (in_slip && !slip_detected) {
+        ++metrics->missed_slips;
+    }
+}
+
+void replay_print_metrics(const ReplayMetrics *m, FILE *out) {
+    static const char *exit_names[REPLAY_EXIT_REASONS] = {
+        "none", "accel direction", "accel slowed", "reverse recovered",
+        "no decel (210ms)", "no decel magnitude (220ms)", "timeout (300ms)",
+    };
+
+    uint32_t exits = 0;
+    for (int i = 0; i < REPLAY_EXIT_REASONS; ++i) {
+        exits += m->exits[i];
+    }
+
+    fprintf(out, "samples:          %u\n", m->samples);
+    fprintf(out, "activations:      %u\n", m->activations);
+    fprintf(out, "wheelslip cycles: %u\n", m->wheelslip_cycles);
+    fprintf(
+        out, "mean duration:    %.1f ms\n", exits ? 1000.0f * m->total_duration / exits : 0.0f
+    );
+    for (int i = 1; i < REPLAY_EXIT_REASONS; ++i) {
+        if (m->exits[i]) {
+            fprintf(out, "  exit %-26s %u\n", exit_names[i], m->exits[i]);
+        }
+    }
+
+    if (m->labelled) {
+        fprintf(out, "labelled slips:   %u\n", m->slips);
+        fprintf(out, "missed slips:     %u\n", m->missed_slips);
+        fprintf(out, "false trips:      %u\n", m->false_trips);
+        fprintf(
+            out,
+            "mean latency:     %.1f ms\n",
+            m->detected_slips ? 1000.0f * m->total_latency / m->detected_slips : 0.0f
+        );
+    }
+
+    fprintf(out, "replay time:      %.3f s\n", m->seconds);
+    fprintf(
+        out,
+        "throughput:       %.2f M samples/s\n",
+        m->seconds > 0 ? m->samples / m->seconds / 1e6 : 0.0
+    );
+}
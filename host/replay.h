@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../datatypes.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Offline replay of recorded motor logs through motor_data_update() and
+// check_traction(), one log row per control loop iteration, as on the ESC.
+
+typedef struct {
+    float time;
+    float erpm;
+    float current;
+    float duty;
+    // braking_pos as the balance loop would have set it, derived from the
+    // current direction when the log doesn't have it
+    bool braking;
+    // ground truth of whether the wheel was slipping, when the log has it
+    bool slip;
+} ReplaySample;
+
+typedef struct {
+    ReplaySample *samples;
+    uint32_t count;
+    bool has_time;
+    bool has_slip;
+    char name[64];
+} ReplayLog;
+
+// Number of TractionExitReason values, see replay_exit_index()
+#define REPLAY_EXIT_REASONS 7
+
+typedef struct {
+    uint32_t samples;
+    uint32_t activations;
+    uint32_t wheelslip_cycles;
+    float total_duration;
+    uint32_t exits[REPLAY_EXIT_REASONS];  // per TractionExitReason, see replay_exit_index()
+
+    bool labelled;
+
+    // Only with ground truth: activations that didn't overlap a labelled
+    // slip, labelled slips that were never detected, and the sum of delays
+    // from the start of a labelled slip to its detection.
+    uint32_t false_trips;
+    uint32_t slips;
+    uint32_t missed_slips;
+    float total_latency;
+    uint32_t detected_slips;
+
+    double seconds;  // wall time spent in the replay loop
+} ReplayMetrics;
+
+/**
+ * Loads a CSV log. The first line names the columns, `erpm` and `current` are
+ * required, `time` (seconds), `duty`, `braking` (0/1) and `slip` (0/1) are
+ * optional. Without `time` the samples are spaced by the loop frequency.
+ *
+ * @return false on failure, with the reason printed to stderr.
+ */
+bool replay_load_csv(ReplayLog *log, const char *path);
+
+void replay_free(ReplayLog *log);
+
+/**
+ * Sets @p cfg to the default traction control tune.
+ */
+void replay_default_config(config *cfg);
+
+/**
+ * Replays @p log with the tune in @p cfg. When @p trace is not NULL, writes
+ * the per-sample state as CSV into it.
+ */
+void replay_run(const ReplayLog *log, config *cfg, ReplayMetrics *metrics, FILE *trace);
+
+/**
+ * Index of a TractionExitReason into ReplayMetrics.exits.
+ */
+int replay_exit_index(int reason);
+
+void replay_print_metrics(const ReplayMetrics *metrics, FILE *out);
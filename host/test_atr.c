@@ -0,0 +1,326 @@
+// Checks the Refloat ATR with the expected acceleration from the compiled
+// current curve against the model it replaced, evaluated with its branches
+// and divides every update: runs both on the same random rides, accelerating
+// and braking in both directions and beyond the ends of the curve, with the
+// default tune and random ones, and compares the ATR and braketilt state
+// after every update. Exits non-zero when they differ.
+
+#include "atr.h"
+
+#include "conf/conf_default.h"
+#include "utils.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HERTZ CFG_DFLT_HERTZ
+#define RIDE_UPDATES (60 * HERTZ)
+#define RANDOM_TUNES 50
+
+// The curve rounds differently from the divides, relative to the magnitude
+#define MAX_ERROR_ACCEL_DIFF 1e-5
+// The same rounding, carried into the offsets
+#define MAX_ERROR_OFFSET 1e-4
+
+static uint32_t seed = 1;
+
+static float noise(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+// atr_update before the curve
+static void atr_update_reference(ATR *atr, const MotorData *motor, const RefloatConfig *config) {
+    float abs_torque = fabsf(motor->atr_filtered_current);
+    float torque_offset = 8;
+    float atr_threshold = motor->braking ? config->atr_threshold_down : config->atr_threshold_up;
+    float accel_factor =
+        motor->braking ? config->atr_amps_decel_ratio : config->atr_amps_accel_ratio;
+    float accel_factor2 = accel_factor * 1.3;
+
+    float measured_acc = fmaxf(motor->acceleration, -5);
+    measured_acc = fminf(measured_acc, 5);
+
+    float expected_acc;
+    if (abs_torque < 25) {
+        expected_acc =
+            (motor->atr_filtered_current - motor->erpm_sign * torque_offset) / accel_factor;
+    } else {
+        int torque_sign = sign(motor->atr_filtered_current);
+        expected_acc = (torque_sign * 25 - motor->erpm_sign * torque_offset) / accel_factor;
+        expected_acc += torque_sign * (abs_torque - 25) / accel_factor2;
+    }
+
+    bool forward = motor->erpm > 0;
+    if (motor->abs_erpm < 250 && abs_torque > 30) {
+        forward = (expected_acc > 0);
+    }
+
+    float new_accel_diff = expected_acc - measured_acc;
+    if (motor->abs_erpm > 2000) {
+        atr->accel_diff = 0.9f * atr->accel_diff + 0.1f * new_accel_diff;
+    } else if (motor->abs_erpm > 1000) {
+        atr->accel_diff = 0.95f * atr->accel_diff + 0.05f * new_accel_diff;
+    } else if (motor->abs_erpm > 250) {
+        atr->accel_diff = 0.98f * atr->accel_diff + 0.02f * new_accel_diff;
+    } else {
+        atr->accel_diff = 0;
+    }
+
+    float atr_strength =
+        forward == (atr->accel_diff > 0) ? config->atr_strength_up : config->atr_strength_down;
+
+    if (motor->abs_erpm > 3000 && !motor->braking) {
+        float speed_boost_mult = (motor->abs_erpm - 3000.0f) * atr->speed_boost_mult;
+        atr->speed_boost = fminf(1, speed_boost_mult) * config->atr_speed_boost;
+        atr_strength += atr_strength * atr->speed_boost;
+    } else {
+        atr->speed_boost = 0.0f;
+    }
+
+    float new_atr_target = atr_strength * atr->accel_diff;
+    if (fabsf(new_atr_target) < atr_threshold) {
+        new_atr_target = 0;
+    } else {
+        new_atr_target -= sign(new_atr_target) * atr_threshold;
+    }
+
+    atr->target_offset = atr->target_offset * 0.95 + 0.05 * new_atr_target;
+    atr->target_offset = fminf(atr->target_offset, config->atr_angle_limit);
+    atr->target_offset = fmaxf(atr->target_offset, -config->atr_angle_limit);
+
+    float response_boost = 1;
+    if (motor->abs_erpm > 2500) {
+        response_boost = config->atr_response_boost;
+    }
+    if (motor->abs_erpm > 6000) {
+        response_boost *= config->atr_response_boost;
+    }
+
+    float atr_step_size = 0;
+    const float TT_BOOST_MARGIN = 2;
+    if (forward) {
+        if (atr->offset < 0) {
+            if (atr->offset < atr->target_offset) {
+                atr_step_size = atr->off_step_size;
+                if ((atr->target_offset > 0) &&
+                    ((atr->target_offset - atr->offset) > TT_BOOST_MARGIN) &&
+                    motor->abs_erpm > 2000) {
+                    atr_step_size = atr->off_step_size * config->atr_transition_boost;
+                }
+            } else {
+                atr_step_size = atr->on_step_size * response_boost;
+            }
+        } else {
+            if ((atr->target_offset > -3) && (atr->offset > atr->target_offset)) {
+                atr_step_size = atr->off_step_size;
+            } else {
+                atr_step_size = atr->on_step_size * response_boost;
+            }
+        }
+    } else {
+        if (atr->offset > 0) {
+            if (atr->offset > atr->target_offset) {
+                atr_step_size = atr->off_step_size;
+                if ((atr->target_offset < 0) &&
+                    ((atr->offset - atr->target_offset) > TT_BOOST_MARGIN) &&
+                    motor->abs_erpm > 2000) {
+                    atr_step_size = atr->off_step_size * config->atr_transition_boost;
+                }
+            } else {
+                atr_step_size = atr->on_step_size * response_boost;
+            }
+        } else {
+            if ((atr->target_offset < 3) && (atr->offset < atr->target_offset)) {
+                atr_step_size = atr->off_step_size;
+            } else {
+                atr_step_size = atr->on_step_size * response_boost;
+            }
+        }
+    }
+
+    if (motor->abs_erpm < 500) {
+        atr_step_size /= 2;
+    }
+
+    rate_limitf(&atr->offset, atr->target_offset, atr_step_size);
+}
+
+// braketilt_update, unchanged, for the accel_diff it reads
+static void braketilt_update_reference(
+    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional
+) {
+    if (atr->braketilt_factor < 0 && motor->braking && motor->abs_erpm > 2000) {
+        if (sign(proportional) != motor->erpm_sign) {
+            float downhill_damper = 1;
+            if ((motor->erpm > 1000 && atr->accel_diff < -1) ||
+                (motor->erpm < -1000 && atr->accel_diff > 1)) {
+                downhill_damper += fabsf(atr->accel_diff) / 2;
+            }
+            atr->braketilt_target_offset = proportional / atr->braketilt_factor / downhill_damper;
+            if (downhill_damper > 2) {
+                atr->braketilt_target_offset = 0;
+            }
+        }
+    } else {
+        atr->braketilt_target_offset = 0;
+    }
+
+    float braketilt_step_size = atr->off_step_size / config->braketilt_lingering;
+    if (fabsf(atr->braketilt_target_offset) > fabsf(atr->braketilt_offset)) {
+        braketilt_step_size = atr->on_step_size * 1.5;
+    } else if (motor->abs_erpm < 800) {
+        braketilt_step_size = atr->on_step_size;
+    }
+
+    if (motor->abs_erpm < 500) {
+        braketilt_step_size /= 2;
+    }
+
+    rate_limitf(&atr->braketilt_offset, atr->braketilt_target_offset, braketilt_step_size);
+}
+
+static void update_reference(
+    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional
+) {
+    atr_update_reference(atr, motor, config);
+    braketilt_update_reference(atr, motor, config, proportional);
+}
+
+static void default_config(RefloatConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->hertz = HERTZ;
+    // The defaults have ATR and braketilt off
+    config->atr_strength_up = 1.0f;
+    config->atr_strength_down = 0.8f;
+    config->atr_threshold_up = CFG_DFLT_ATR_THRESHOLD_UP;
+    config->atr_threshold_down = CFG_DFLT_ATR_THRESHOLD_DOWN;
+    config->atr_speed_boost = CFG_DFLT_ATR_SPEED_BOOST;
+    config->atr_angle_limit = CFG_DFLT_ATR_ANGLE_LIMIT;
+    config->atr_on_speed = CFG_DFLT_ATR_ON_SPEED;
+    config->atr_off_speed = CFG_DFLT_ATR_OFF_SPEED;
+    config->atr_response_boost = CFG_DFLT_ATR_RESPONSE_BOOST;
+    config->atr_transition_boost = CFG_DFLT_ATR_TRANSITION_BOOST;
+    config->atr_amps_accel_ratio = CFG_DFLT_ATR_AMPS_ACCEL_RATIO;
+    config->atr_amps_decel_ratio = CFG_DFLT_ATR_AMPS_DECEL_RATIO;
+    config->braketilt_strength = 10.0f;
+    config->braketilt_lingering = CFG_DFLT_BRAKETILT_LINGERING;
+}
+
+static void random_config(RefloatConfig *config) {
+    default_config(config);
+    config->atr_strength_up = 1.5f * (noise() + 0.5f);
+    config->atr_strength_down = 1.5f * (noise() + 0.5f);
+    config->atr_threshold_up = 3.0f * (noise() + 0.5f);
+    config->atr_threshold_down = 3.0f * (noise() + 0.5f);
+    config->atr_speed_boost = 2.0f * noise();
+    config->atr_response_boost = 1.0f + 2.0f * (noise() + 0.5f);
+    config->atr_amps_accel_ratio = 3.0f + 17.0f * (noise() + 0.5f);
+    config->atr_amps_decel_ratio = 3.0f + 17.0f * (noise() + 0.5f);
+    config->braketilt_strength = noise() > 0 ? 20.0f * (noise() + 0.5f) : 0.0f;
+}
+
+typedef struct {
+    MotorData motor;
+    float proportional;
+    // Random walk targets
+    float erpm_target;
+    float current_target;
+} Ride;
+
+// A random walk of speed and current, at times stopping, reversing and
+// pulling more current than the curve spans
+static void ride_step(Ride *r, int i) {
+    if (i % (2 * HERTZ) == 0) {
+        r->erpm_target = 24000.0f * noise();
+        if (noise() > 0.3f) {
+            r->erpm_target = 400.0f * noise();
+        }
+    }
+    if (i % (HERTZ / 4) == 0) {
+        r->current_target = 160.0f * noise();
+        if (noise() > 0.4f) {
+            r->current_target *= 3.0f;
+        }
+    }
+
+    MotorData *m = &r->motor;
+    m->erpm += (r->erpm_target - m->erpm) * 0.002f + 20.0f * noise();
+    m->abs_erpm = fabsf(m->erpm);
+    m->erpm_sign = sign(m->erpm);
+    m->atr_filtered_current += (r->current_target - m->atr_filtered_current) * 0.01f + noise();
+    m->braking = m->abs_erpm > 250 && sign(m->atr_filtered_current) != m->erpm_sign;
+    m->acceleration = 12.0f * noise();
+    r->proportional = 10.0f * noise();
+}
+
+typedef struct {
+    double accel_diff;
+    double offset;
+} Errors;
+
+static void compare(const ATR *a, const ATR *b, Errors *e) {
+    double accel_diff = fabs(a->accel_diff - b->accel_diff) / fmax(1, fabs(b->accel_diff));
+    double offsets[] = {
+        fabs(a->target_offset - b->target_offset),
+        fabs(a->offset - b->offset),
+        fabs(a->speed_boost - b->speed_boost),
+        fabs(a->braketilt_target_offset - b->braketilt_target_offset),
+        fabs(a->braketilt_offset - b->braketilt_offset),
+    };
+
+    e->accel_diff = fmax(e->accel_diff, accel_diff);
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+        e->offset = fmax(e->offset, offsets[i]);
+    }
+}
+
+static void ride(const RefloatConfig *config, Errors *e) {
+    ATR atr, ref;
+    atr_reset(&atr);
+    atr_configure(&atr, config);
+    ref = atr;
+
+    Ride r;
+    memset(&r, 0, sizeof(r));
+    for (int i = 0; i < RIDE_UPDATES; ++i) {
+        ride_step(&r, i);
+        atr_and_braketilt_update(&atr, &r.motor, config, r.proportional);
+        update_reference(&ref, &r.motor, config, r.proportional);
+        compare(&atr, &ref, e);
+    }
+}
+
+static bool check(const char *name, const Errors *e) {
+    bool ok = e->accel_diff <= MAX_ERROR_ACCEL_DIFF && e->offset <= MAX_ERROR_OFFSET;
+    printf(
+        "%-14s accel_diff %.2e (relative)  offsets %.2e deg  %s\n",
+        name,
+        e->accel_diff,
+        e->offset,
+        ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+int main(void) {
+    bool ok = true;
+
+    RefloatConfig config;
+    default_config(&config);
+    Errors e = {0};
+    ride(&config, &e);
+    ok &= check("default tune:", &e);
+
+    Errors random = {0};
+    for (int i = 0; i < RANDOM_TUNES; ++i) {
+        random_config(&config);
+        ride(&config, &random);
+    }
+    ok &= check("random tunes:", &random);
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// Checks the Euler angles the Refloat balance filter extracts on update, with
+// libm and with the fast trig approximations, against atan2 and asin in double
+// precision of the same float arguments, over random orientations including
+// ones close to +-90 deg of pitch, and that the cached angles follow the
+// quaternion while integrating a rotation. Exits non-zero on failure.
+
+#include "balance_filter.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ORIENTATIONS 200000
+// libm in float
+#define MAX_ERROR_LIBM 1e-6
+// The error of the atan polynomial plus float rounding
+#define MAX_ERROR_FAST 2e-5
+
+typedef struct {
+    double roll, pitch, yaw;
+} Angles;
+
+static double noise(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) * (1.0 / 16777216.0) - 0.5;
+}
+
+// The angles of the float arguments the filter computes, where the float
+// rounding close to the singularities dwarfs the error of the trig itself
+static Angles reference(const BalanceFilterData *bf) {
+    float q0 = bf->q0, q1 = bf->q1, q2 = bf->q2, q3 = bf->q3;
+    float sin_pitch = -2.0f * (q1 * q3 - q0 * q2);
+    sin_pitch = sin_pitch < -1 ? -1 : sin_pitch > 1 ? 1 : sin_pitch;
+    return (Angles) {
+        .roll = -atan2((double) (q0 * q1 + q2 * q3), 0.5f - (q1 * q1 + q2 * q2)),
+        .pitch = asin((double) sin_pitch),
+        .yaw = -atan2((double) (q0 * q3 + q1 * q2), 0.5f - (q2 * q2 + q3 * q3)),
+    };
+}
+
+// Angle difference, wrapped so that +-pi compare equal
+static double angle_error(double a, double b) {
+    double diff = fabs(a - b);
+    return diff > M_PI ? 2 * M_PI - diff : diff;
+}
+
+// Sets the quaternion and runs an update that leaves it as it is: no rotation
+// and no accelerometer feedback
+static void set_orientation(BalanceFilterData *bf, double q[4]) {
+    double norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    bf->q0 = q[0] / norm;
+    bf->q1 = q[1] / norm;
+    bf->q2 = q[2] / norm;
+    bf->q3 = q[3] / norm;
+
+    float zero[3] = {0, 0, 0};
+    balance_filter_update(bf, zero, zero, 0.001f);
+}
+
+static bool check_accuracy(bool fast_trig, double max_allowed) {
+    BalanceFilterData bf;
+    memset(&bf, 0, sizeof(bf));
+    bf.fast_trig = fast_trig;
+
+    uint32_t seed = 1;
+    double max_error[3] = {0};
+    for (int i = 0; i < ORIENTATIONS; ++i) {
+        double q[4] = {noise(&seed), noise(&seed), noise(&seed), noise(&seed)};
+        if (i % 4 == 0) {
+            // Near the poles of pitch, where asin is steepest
+            q[1] *= 1e-3;
+            q[3] *= 1e-3;
+        }
+        set_orientation(&bf, q);
+
+        Angles ref = reference(&bf);
+        double errors[3] = {
+            angle_error(balance_filter_get_roll(&bf), ref.roll),
+            angle_error(balance_filter_get_pitch(&bf), ref.pitch),
+            angle_error(balance_filter_get_yaw(&bf), ref.yaw),
+        };
+        for (int a = 0; a < 3; ++a) {
+            if (errors[a] > max_error[a]) {
+                max_error[a] = errors[a];
+            }
+        }
+    }
+
+    bool ok = max_error[0] <= max_allowed && max_error[1] <= max_allowed &&
+        max_error[2] <= max_allowed;
+    printf(
+        "%-4s roll %.2e  pitch %.2e  yaw %.2e rad  %s\n",
+        fast_trig ? "fast" : "libm",
+        max_error[0],
+        max_error[1],
+        max_error[2],
+        ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+static bool check_tracking(void) {
+    BalanceFilterData bf;
+    memset(&bf, 0, sizeof(bf));
+    double level[4] = {1, 0, 0, 0};
+    set_orientation(&bf, level);
+
+    // Pitch through 180 deg with some roll and yaw on the way, the cache has
+    // to match the quaternion after every update
+    float gyro[3] = {0.3f, 1.0f, -0.2f};
+    float zero[3] = {0, 0, 0};
+    double max_error = 0;
+    for (int i = 0; i < 4000; ++i) {
+        balance_filter_update(&bf, gyro, zero, 1.0f / 1000);
+        Angles ref = reference(&bf);
+        double error = angle_error(balance_filter_get_pitch(&bf), ref.pitch);
+        if (error > max_error) {
+            max_error = error;
+        }
+    }
+
+    bool ok = max_error <= MAX_ERROR_LIBM;
+    printf("tracking: max error %.2e rad  %s\n", max_error, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(void) {
+    bool ok = true;
+    ok &= check_accuracy(false, MAX_ERROR_LIBM);
+    ok &= check_accuracy(true, MAX_ERROR_FAST);
+    ok &= check_tracking();
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Checks the biquad bank against biquad_process: every lane of banks of 1 to
+// 4 channels through 1 to 4 cascaded sections of random types, frequencies
+// and Qs has to match per-channel Biquad cascades with the same coefficients
+// sample for sample, also when filtering in place and after a reset. Then
+// checks the magnitude of the bandpass and notch sections on sines at their
+// center frequency and a decade away from it. Exits non-zero on failure.
+
+#include "../biquad.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SAMPLES 20000
+#define RANDOM_BANKS 200
+
+// The arithmetic is the same, this only leaves room for a compiler fusing
+// multiply-adds differently in the two
+#define MAX_LANE_ERROR 1e-5
+
+// Bandpass and notch at their center frequency
+#define MAX_CENTER_ERROR 0.01
+// A decade below and above the center frequency, for Q from 0.707 up, where
+// the analog prototypes give 0.141 and 0.990
+#define MAX_BANDPASS_FAR 0.15
+#define MIN_NOTCH_FAR 0.98
+
+static float noise(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+static float input(uint32_t i, uint32_t *seed) {
+    return 0.4f * sinf(0.002f * i) + 0.3f * sinf(0.05f * i) + 0.2f * noise(seed);
+}
+
+static bool check_lanes(uint32_t *seed) {
+    static const BiquadType types[] = {BQ_LOWPASS, BQ_HIGHPASS, BQ_BANDPASS, BQ_NOTCH};
+
+    uint8_t channels = 1 + (uint8_t) ((noise(seed) + 0.5f) * BIQUAD_BANK_MAX_CHANNELS);
+    uint8_t sections = 1 + (uint8_t) ((noise(seed) + 0.5f) * BIQUAD_BANK_MAX_SECTIONS);
+    channels = channels > BIQUAD_BANK_MAX_CHANNELS ? BIQUAD_BANK_MAX_CHANNELS : channels;
+    sections = sections > BIQUAD_BANK_MAX_SECTIONS ? BIQUAD_BANK_MAX_SECTIONS : sections;
+
+    BiquadBank bank;
+    biquad_bank_init(&bank, channels, sections);
+    Biquad ref[BIQUAD_BANK_MAX_CHANNELS][BIQUAD_BANK_MAX_SECTIONS];
+    for (uint8_t c = 0; c < channels; ++c) {
+        for (uint8_t s = 0; s < sections; ++s) {
+            BiquadType type = types[(int) ((noise(seed) + 0.5f) * 4) & 3];
+            float frequency = 0.002f + 0.2f * (noise(seed) + 0.5f);
+            float q = 0.5f + 4.0f * (noise(seed) + 0.5f);
+            biquad_bank_configure(&bank, c, s, type, frequency, q);
+            biquad_configure_q(&ref[c][s], type, frequency, q);
+            biquad_reset(&ref[c][s]);
+        }
+    }
+    // Out of range, has to be ignored
+    biquad_bank_configure(&bank, channels, 0, BQ_LOWPASS, 0.01f, 0.707f);
+    biquad_bank_configure(&bank, 0, sections, BQ_LOWPASS, 0.01f, 0.707f);
+
+    uint32_t mismatches = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t i = 0; i < SAMPLES; ++i) {
+            float in[BIQUAD_BANK_MAX_CHANNELS];
+            float out[BIQUAD_BANK_MAX_CHANNELS + 1];
+            out[channels] = 12345.0f;
+            for (uint8_t c = 0; c < channels; ++c) {
+                in[c] = input(i + 1000 * c, seed);
+            }
+
+            // The second pass filters in place
+            float *dst = pass ? in : out;
+            float expected[BIQUAD_BANK_MAX_CHANNELS];
+            for (uint8_t c = 0; c < channels; ++c) {
+                expected[c] = in[c];
+                for (uint8_t s = 0; s < sections; ++s) {
+                    expected[c] = biquad_process(&ref[c][s], expected[c]);
+                }
+            }
+            biquad_bank_process(&bank, in, dst);
+
+            for (uint8_t c = 0; c < channels; ++c) {
+                mismatches += fabsf(dst[c] - expected[c]) > MAX_LANE_ERROR;
+            }
+            // Lanes past the channel count aren't written
+            mismatches += !pass && out[channels] != 12345.0f;
+        }
+
+        biquad_bank_reset(&bank);
+        for (uint8_t c = 0; c < channels; ++c) {
+            for (uint8_t s = 0; s < sections; ++s) {
+                biquad_reset(&ref[c][s]);
+            }
+        }
+    }
+
+    if (mismatches) {
+        printf(
+            "lanes: %u channels x %u sections, %u mismatches  FAIL\n",
+            channels,
+            sections,
+            mismatches
+        );
+    }
+    return mismatches == 0;
+}
+
+// RMS gain of a steady sine of @p frequency through the section
+static double gain(BiquadType type, float center, float q, float frequency) {
+    BiquadBank bank;
+    biquad_bank_init(&bank, 1, 1);
+    biquad_bank_configure(&bank, 0, 0, type, center, q);
+
+    // Settle for 20 time constants of the section, then measure over whole
+    // periods of the sine
+    uint32_t settle = (uint32_t) (20 * q / (M_PI * center)) + 1000;
+    uint32_t periods = (uint32_t) (10 / frequency);
+    double sum_in = 0, sum_out = 0;
+    for (uint32_t i = 0; i < settle + periods; ++i) {
+        float x = sinf(2 * M_PI * frequency * i);
+        float y;
+        biquad_bank_process(&bank, &x, &y);
+        if (i >= settle) {
+            sum_in += (double) x * x;
+            sum_out += (double) y * y;
+        }
+    }
+    return sqrt(sum_out / sum_in);
+}
+
+static bool check_magnitude(float center, float q) {
+    double bp_center = gain(BQ_BANDPASS, center, q, center);
+    double bp_far = fmax(
+        gain(BQ_BANDPASS, center, q, center / 10), gain(BQ_BANDPASS, center, q, center * 10)
+    );
+    double notch_center = gain(BQ_NOTCH, center, q, center);
+    double notch_far =
+        fmin(gain(BQ_NOTCH, center, q, center / 10), gain(BQ_NOTCH, center, q, center * 10));
+
+    bool ok = fabs(bp_center - 1) < MAX_CENTER_ERROR && bp_far < MAX_BANDPASS_FAR &&
+        notch_center < MAX_CENTER_ERROR && notch_far > MIN_NOTCH_FAR;
+    printf(
+        "f=%.3f q=%.3f  bandpass %.4f / %.4f  notch %.4f / %.4f  %s\n",
+        center,
+        q,
+        bp_center,
+        bp_far,
+        notch_center,
+        notch_far,
+        ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+int main(void) {
+    bool ok = true;
+
+    uint32_t seed = 1;
+    bool lanes_ok = true;
+    for (int i = 0; i < RANDOM_BANKS; ++i) {
+        lanes_ok &= check_lanes(&seed);
+    }
+    printf("lanes: %d random banks  %s\n", RANDOM_BANKS, lanes_ok ? "ok" : "FAIL");
+    ok &= lanes_ok;
+
+    static const float centers[] = {0.005f, 0.01f, 0.02f};
+    static const float qs[] = {0.707f, 2.0f, 5.0f};
+    for (size_t f = 0; f < sizeof(centers) / sizeof(centers[0]); ++f) {
+        for (size_t q = 0; q < sizeof(qs) / sizeof(qs[0]); ++q) {
+            ok &= check_magnitude(centers[f], qs[q]);
+        }
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
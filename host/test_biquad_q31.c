@@ -0,0 +1,171 @@
+// Checks the Q31 biquad against the float reference on noisy multi-tone input
+// for every filter type over a range of frequencies, and that full scale input
+// saturates instead of wrapping around, including the low cutoff highpass and
+// notch sections whose accumulator sees the largest sums. Exits non-zero on failure.
+
+#include "../biquad.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SAMPLES 200000
+// Worst case deviation allowed from the float reference, in full scale units.
+// Float itself only has 24 bits of mantissa, so this is mostly its error.
+#define MAX_DEVIATION 2e-4
+// With full scale input the output keeps hitting the rails, a wrap around
+// lands on the opposite one
+#define MAX_FULL_SCALE_DEVIATION 0.01
+
+static float noise(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+static float input(uint32_t i, uint32_t *seed) {
+    return 0.4f * sinf(0.002f * i) + 0.3f * sinf(0.05f * i) + 0.2f * noise(seed);
+}
+
+static int32_t to_q31(float value) {
+    return (int32_t) lrintf(value * 2147483648.0f);
+}
+
+static float from_q31(int32_t value) {
+    return value * (1.0f / 2147483648.0f);
+}
+
+static bool check_deviation(BiquadType type, const char *name, float frequency, float q) {
+    Biquad ref;
+    BiquadQ31 fixed;
+    biquad_configure_q(&ref, type, frequency, q);
+    biquad_reset(&ref);
+    biquad_q31_configure(&fixed, type, frequency, q);
+    biquad_q31_reset(&fixed);
+
+    uint32_t seed = 1;
+    double max_dev = 0;
+    double sum_sq = 0;
+    for (uint32_t i = 0; i < SAMPLES; ++i) {
+        float x = input(i, &seed);
+        float y_ref = biquad_process(&ref, x);
+        float y = from_q31(biquad_q31_process(&fixed, to_q31(x)));
+
+        double dev = fabs((double) y - y_ref);
+        sum_sq += dev * dev;
+        if (dev > max_dev) {
+            max_dev = dev;
+        }
+    }
+
+    bool ok = max_dev < MAX_DEVIATION;
+    printf(
+        "%-9s f=%.4f q=%.3f  max %.2e  rms %.2e  %s\n",
+        name,
+        frequency,
+        q,
+        max_dev,
+        sqrt(sum_sq / SAMPLES),
+        ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+static bool check_saturation(void) {
+    // A resonant lowpass overshoots a full scale square wave, the
+    // output has to clip at the rails instead of flipping sign.
+    BiquadQ31 bq;
+    biquad_q31_configure(&bq, BQ_LOWPASS, 0.05f, 5.0f);
+    biquad_q31_reset(&bq);
+
+    bool clipped = false;
+    for (int i = 0; i < 2000; ++i) {
+        int32_t x = (i / 20) % 2 ? INT32_MIN : INT32_MAX;
+        int32_t y = biquad_q31_process(&bq, x);
+        clipped |= y == INT32_MAX || y == INT32_MIN;
+        if (i % 20 == 19 && (x > 0) != (y > 0)) {
+            printf("saturation: sign flip at %d  FAIL\n", i);
+            return false;
+        }
+    }
+
+    printf("saturation: %s\n", clipped ? "ok" : "FAIL (never clipped)");
+    return clipped;
+}
+
+// Full scale random input through a section that saturates its output and
+// keeps the saturated output as state, in double.
+static bool check_full_scale(BiquadType type, const char *name, float frequency, float q) {
+    Biquad ref;
+    BiquadQ31 fixed;
+    biquad_configure_q(&ref, type, frequency, q);
+    biquad_q31_configure(&fixed, type, frequency, q);
+    biquad_q31_reset(&fixed);
+
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    uint32_t seed = 1;
+    uint32_t flips = 0;
+    for (uint32_t i = 0; i < SAMPLES; ++i) {
+        int32_t x = noise(&seed) < 0 ? INT32_MIN : INT32_MAX;
+        double xf = from_q31(x);
+        double y_ref = ref.a0 * xf + ref.a1 * x1 + ref.a2 * x2 - ref.b1 * y1 - ref.b2 * y2;
+        y_ref = fmin(fmax(y_ref, -1), 1);
+        x2 = x1;
+        x1 = xf;
+        y2 = y1;
+        y1 = y_ref;
+
+        double y = from_q31(biquad_q31_process(&fixed, x));
+        if (fabs(y - y_ref) > MAX_FULL_SCALE_DEVIATION) {
+            if (flips == 0) {
+                printf("%s: i=%u expected %.4f got %.4f\n", name, i, y_ref, y);
+            }
+            ++flips;
+        }
+    }
+
+    printf(
+        "full scale %-9s f=%.4f q=%.3f  %u off  %s\n",
+        name,
+        frequency,
+        q,
+        flips,
+        flips ? "FAIL" : "ok"
+    );
+    return flips == 0;
+}
+
+int main(void) {
+    static const struct {
+        BiquadType type;
+        const char *name;
+    } types[] = {
+        {BQ_LOWPASS, "lowpass"},
+        {BQ_HIGHPASS, "highpass"},
+        {BQ_BANDPASS, "bandpass"},
+        {BQ_NOTCH, "notch"},
+    };
+    static const float frequencies[] = {0.002f, 0.01f, 0.05f, 0.2f};
+    static const float qs[] = {0.5f, 0.707f, 2.0f};
+
+    bool ok = true;
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+        for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); ++f) {
+            for (size_t q = 0; q < sizeof(qs) / sizeof(qs[0]); ++q) {
+                ok &= check_deviation(types[t].type, types[t].name, frequencies[f], qs[q]);
+            }
+        }
+    }
+    ok &= check_saturation();
+
+    // Low cutoff highpass and notch have the largest sum of coefficients
+    static const float low_frequencies[] = {0.002f, 0.01f, 0.05f};
+    for (size_t f = 0; f < sizeof(low_frequencies) / sizeof(low_frequencies[0]); ++f) {
+        ok &= check_full_scale(BQ_HIGHPASS, "highpass", low_frequencies[f], 0.707f);
+        ok &= check_full_scale(BQ_NOTCH, "notch", low_frequencies[f], 0.707f);
+        ok &= check_full_scale(BQ_NOTCH, "notch", low_frequencies[f], 5.0f);
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
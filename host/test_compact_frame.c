@@ -0,0 +1,207 @@
+// Round-trips a synthetic telemetry stream through the Refloat compact frame
+// codec, checking that every field comes back within half a step of its scale,
+// that a decoder which lost frames waits for the next keyframe, and the varint
+// and zig-zag edge cases. Prints the average frame size against four bytes per
+// field. Exits non-zero on failure.
+
+#include "../vesc_pkg/refloat/src/compact_frame.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FRAMES 5000
+#define FIELDS 8
+#define KEYFRAME_INTERVAL 50
+#define LOST_FRAME 1234
+
+// Angles in 0.01 deg, currents in 0.1 A, speed in erpm, voltage in 0.01 V
+static const float scales[FIELDS] = {100, 100, 100, 10, 10, 1, 100, 1};
+
+static void sample(uint32_t i, float *values) {
+    float t = i * 0.02f;
+    values[0] = 3.0f * sinf(0.7f * t);
+    values[1] = 1.5f * sinf(2.3f * t) + 0.2f * sinf(31.0f * t);
+    values[2] = 8.0f * sinf(0.1f * t);
+    values[3] = 25.0f * sinf(0.4f * t) + 3.0f * sinf(17.0f * t);
+    values[4] = 0.8f * values[3];
+    values[5] = 12000.0f * sinf(0.05f * t);
+    values[6] = 84.0f - 0.001f * i;
+    values[7] = 1 + (i / 700) % 3;
+}
+
+static bool check_round_trip(void) {
+    CompactFrameEncoder enc;
+    CompactFrameDecoder dec;
+    compact_frame_encoder_init(&enc, KEYFRAME_INTERVAL);
+    compact_frame_decoder_reset(&dec);
+
+    uint8_t buffer[COMPACT_FRAME_MAX_SIZE(FIELDS)];
+    float values[FIELDS];
+    float decoded[FIELDS];
+    double max_error = 0;
+    uint32_t bytes = 0;
+    uint32_t decoded_frames = 0;
+    bool waited = false;
+    bool recovered = false;
+
+    for (uint32_t i = 0; i < FRAMES; ++i) {
+        sample(i, values);
+        int32_t size = compact_frame_encode(&enc, values, scales, FIELDS, buffer);
+        bytes += size;
+
+        if (size > COMPACT_FRAME_MAX_SIZE(FIELDS)) {
+            printf("frame %u: %d bytes over the worst case  FAIL\n", i, size);
+            return false;
+        }
+
+        if (i == LOST_FRAME) {
+            // The client notices the gap in the frame counter
+            compact_frame_decoder_reset(&dec);
+            continue;
+        }
+
+        CompactFrameResult res = compact_frame_decode(&dec, buffer, size, scales, FIELDS, decoded);
+        bool keyframe = buffer[0] & COMPACT_FRAME_KEYFRAME;
+        if (i > LOST_FRAME && !recovered) {
+            if (!keyframe) {
+                if (res != COMPACT_FRAME_NEED_KEYFRAME) {
+                    printf("frame %u: decoded a delta after a lost frame  FAIL\n", i);
+                    return false;
+                }
+                waited = true;
+                continue;
+            }
+            recovered = true;
+        }
+
+        if (res != COMPACT_FRAME_OK) {
+            printf("frame %u: result %d  FAIL\n", i, res);
+            return false;
+        }
+
+        ++decoded_frames;
+        for (int f = 0; f < FIELDS; ++f) {
+            double error = fabs((double) decoded[f] - values[f]) * scales[f];
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+    }
+
+    bool ok = max_error <= 0.5 + 1e-3 && waited && recovered;
+    printf(
+        "round trip: %u/%u frames, max error %.3f steps, %.2f bytes/frame vs %d  %s\n",
+        decoded_frames,
+        FRAMES,
+        max_error,
+        (double) bytes / FRAMES,
+        4 * FIELDS,
+        ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+static bool check_limits(void) {
+    CompactFrameEncoder enc;
+    CompactFrameDecoder dec;
+    compact_frame_encoder_init(&enc, 2);
+    compact_frame_decoder_reset(&dec);
+
+    // Full range swings between frames, out of range values and NaN
+    static const float scale[3] = {1, 1, 1};
+    static const float series[][3] = {
+        {1e9f, -1e9f, 0},
+        {-1e9f, 1e9f, 0},
+        {1e12f, -1e12f, NAN},
+        {0, 0, 0},
+    };
+    static const float expected[][3] = {
+        {1e9f, -1e9f, 0},
+        {-1e9f, 1e9f, 0},
+        {1e9f, -1e9f, -1e9f},
+        {0, 0, 0},
+    };
+
+    for (size_t i = 0; i < sizeof(series) / sizeof(series[0]); ++i) {
+        uint8_t buffer[COMPACT_FRAME_MAX_SIZE(3)];
+        float decoded[3];
+        int32_t size = compact_frame_encode(&enc, series[i], scale, 3, buffer);
+        CompactFrameResult res = compact_frame_decode(&dec, buffer, size, scale, 3, decoded);
+        for (int f = 0; f < 3; ++f) {
+            if (res != COMPACT_FRAME_OK || decoded[f] != expected[i][f]) {
+                printf("limits: frame %zu field %d: %g  FAIL\n", i, f, decoded[f]);
+                return false;
+            }
+        }
+    }
+
+    // A truncated frame or a different version is refused
+    uint8_t buffer[COMPACT_FRAME_MAX_SIZE(3)];
+    float decoded[3];
+    int32_t size = compact_frame_encode(&enc, series[0], scale, 3, buffer);
+    if (compact_frame_decode(&dec, buffer, size - 1, scale, 3, decoded) != COMPACT_FRAME_INVALID) {
+        printf("limits: truncated frame accepted  FAIL\n");
+        return false;
+    }
+    buffer[0] = (COMPACT_FRAME_VERSION + 1) << 4;
+    if (compact_frame_decode(&dec, buffer, size, scale, 3, decoded) != COMPACT_FRAME_INVALID) {
+        printf("limits: unknown version accepted  FAIL\n");
+        return false;
+    }
+
+    printf("limits: ok\n");
+    return true;
+}
+
+static bool check_varint(void) {
+    static const uint32_t numbers[] = {0, 1, 127, 128, 16383, 16384, 0xFFFFFFFF};
+    static const int32_t sizes[] = {1, 1, 1, 2, 2, 3, 5};
+    static const int32_t values[] = {0, -1, 1, INT32_MIN, INT32_MAX};
+
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i) {
+        uint8_t buffer[5];
+        int32_t size = 0;
+        buffer_append_varint(buffer, numbers[i], &size);
+
+        uint32_t number = 0;
+        int32_t ind = 0;
+        if (size != sizes[i] || !buffer_get_varint(buffer, size, &number, &ind) ||
+            number != numbers[i] || ind != size) {
+            printf("varint: %u  FAIL\n", numbers[i]);
+            return false;
+        }
+
+        ind = 0;
+        if (size > 1 && buffer_get_varint(buffer, size - 1, &number, &ind)) {
+            printf("varint: truncated %u accepted  FAIL\n", numbers[i]);
+            return false;
+        }
+    }
+
+    // Small magnitudes of either sign take the smallest codes
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        if (zigzag_decode(zigzag_encode(values[i])) != values[i]) {
+            printf("zigzag: %d  FAIL\n", values[i]);
+            return false;
+        }
+    }
+    if (zigzag_encode(-1) != 1 || zigzag_encode(1) != 2 || zigzag_encode(INT32_MIN) != 0xFFFFFFFF) {
+        printf("zigzag: mapping  FAIL\n");
+        return false;
+    }
+
+    printf("varint: ok\n");
+    return true;
+}
+
+int main(void) {
+    bool ok = true;
+    ok &= check_round_trip();
+    ok &= check_limits();
+    ok &= check_varint();
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+// Checks the Refloat footpad sensor filter on synthetic ADC traces: that
+// with filtering, hysteresis and debouncing off it thresholds the median of
+// the last three readings, that with the default config a noisy trace with
+// spikes changes state once per press and release within a bounded delay
+// where plain thresholding flickers, that a voltage hovering inside the
+// hysteresis band and taps shorter than the press debounce don't change the
+// state, and the single and no sensor setups. Exits non-zero on failure.
+//
+// With a CSV file of `time,adc1,adc2` rows (s, V), e.g. from a log of the
+// FOOTPAD_ADC telemetry, instead prints the state changes the default config
+// makes of it against plain thresholding.
+
+#include "footpad_sensor.h"
+
+#include "conf/conf_default.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HERTZ CFG_DFLT_HERTZ
+#define DT (1.0f / HERTZ)
+
+// From the middle of the press or release ramp to the state change, the
+// press debounce plus the filter and median delays
+#define MAX_LATENCY 0.035f
+
+static float noise(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (*seed >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+static void default_config(RefloatConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->hertz = HERTZ;
+    config->fault_adc1 = CFG_DFLT_FAULT_ADC1;
+    config->fault_adc2 = CFG_DFLT_FAULT_ADC2;
+    config->fault_adc_hysteresis = CFG_DFLT_FAULT_ADC_HYSTERESIS;
+    config->fault_adc_filter = CFG_DFLT_FAULT_ADC_FILTER;
+    config->fault_delay_adc_engage = CFG_DFLT_FAULT_DELAY_ADC_ENGAGE;
+    config->fault_delay_adc_release = CFG_DFLT_FAULT_DELAY_ADC_RELEASE;
+}
+
+static void sensor_setup(FootpadSensor *fs, const RefloatConfig *config) {
+    footpad_sensor_init(fs);
+    footpad_sensor_configure(fs, config);
+}
+
+static FootpadSensorState raw_state(const RefloatConfig *config, float adc1, float adc2) {
+    bool left = adc1 > config->fault_adc1;
+    bool right = adc2 > config->fault_adc2;
+    return (left ? FS_LEFT : FS_NONE) | (right ? FS_RIGHT : FS_NONE);
+}
+
+static float median3(float a, float b, float c) {
+    return fmaxf(fminf(a, b), fminf(fmaxf(a, b), c));
+}
+
+static bool check_passthrough(void) {
+    RefloatConfig config;
+    default_config(&config);
+    config.fault_adc_hysteresis = 0;
+    config.fault_adc_filter = 0;
+    config.fault_delay_adc_engage = 0;
+    config.fault_delay_adc_release = 0;
+
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+
+    uint32_t seed = 1;
+    float w1[3] = {0}, w2[3] = {0};
+    uint32_t mismatches = 0;
+    for (int i = 0; i < 100000; ++i) {
+        float adc1 = 2.0f + 2.0f * noise(&seed);
+        float adc2 = 2.0f + 2.0f * noise(&seed);
+        if (i == 0) {
+            w1[0] = w1[1] = w1[2] = adc1;
+            w2[0] = w2[1] = w2[2] = adc2;
+        }
+        w1[i % 3] = adc1;
+        w2[i % 3] = adc2;
+
+        footpad_sensor_filter(&fs, adc1, adc2, i * DT);
+        float m1 = median3(w1[0], w1[1], w1[2]);
+        float m2 = median3(w2[0], w2[1], w2[2]);
+        if (fs.adc1 != m1 || fs.adc2 != m2 || fs.state != raw_state(&config, m1, m2)) {
+            ++mismatches;
+        }
+    }
+
+    bool ok = mismatches == 0;
+    printf("pass-through: %u mismatches  %s\n", mismatches, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A foot on the pad: 3.0 V pressed, 0.3 V released, 10 ms ramps between, with
+// noise and spikes
+static float pad_voltage(float t, float press, float release, uint32_t *seed) {
+    float ramp = 0.01f;
+    float level;
+    if (t < press || t >= release + ramp) {
+        level = 0.3f;
+    } else if (t < press + ramp) {
+        level = 0.3f + 2.7f * (t - press) / ramp;
+    } else if (t < release) {
+        level = 3.0f;
+    } else {
+        level = 3.0f - 2.7f * (t - release) / ramp;
+    }
+
+    float v = level + 0.6f * noise(seed);
+    if (noise(seed) > 0.48f) {
+        v = noise(seed) > 0 ? 3.3f : 0.0f;
+    }
+    return fminf(fmaxf(v, 0.0f), 3.3f);
+}
+
+typedef struct {
+    float press, release;
+} Step;
+
+static bool check_noisy_trace(void) {
+    // Left and right footpad presses, overlapping and not
+    static const Step left[] = {{0.5f, 2.0f}, {3.0f, 6.0f}, {7.0f, 7.2f}};
+    static const Step right[] = {{1.0f, 2.5f}, {3.5f, 5.0f}, {5.5f, 6.5f}};
+    const int steps = 3;
+
+    RefloatConfig config;
+    default_config(&config);
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+
+    uint32_t seed = 7;
+    FootpadSensorState prev = FS_NONE, prev_raw = FS_NONE;
+    uint32_t changes = 0, raw_changes = 0;
+    float max_latency = 0;
+    bool late = false;
+    for (int i = 0; i < 8 * HERTZ; ++i) {
+        float t = i * DT;
+        float adc1 = 0, adc2 = 0;
+        int l = 0, r = 0;
+        // The step closest to t, the voltage of the others is the same
+        while (l < steps - 1 && t > (left[l].release + left[l + 1].press) / 2) {
+            ++l;
+        }
+        while (r < steps - 1 && t > (right[r].release + right[r + 1].press) / 2) {
+            ++r;
+        }
+        adc1 = pad_voltage(t, left[l].press, left[l].release, &seed);
+        adc2 = pad_voltage(t, right[r].press, right[r].release, &seed);
+
+        footpad_sensor_filter(&fs, adc1, adc2, t);
+
+        FootpadSensorState raw = raw_state(&config, adc1, adc2);
+        raw_changes += raw != prev_raw;
+        prev_raw = raw;
+        if (fs.state == prev) {
+            continue;
+        }
+        ++changes;
+        prev = fs.state;
+
+        // The latency from the closest edge of the channel that changed
+        const Step *s = fs.channels[0].change_time == t ? &left[l] : &right[r];
+        float edge = fabsf(t - s->press) < fabsf(t - s->release) ? s->press : s->release;
+        float latency = t - (edge + 0.005f);
+        max_latency = fmaxf(max_latency, fabsf(latency));
+        late |= latency < 0 || latency > MAX_LATENCY;
+    }
+
+    bool ok = changes == 4 * steps && !late;
+    printf(
+        "noisy trace: %u state changes (%u thresholding raw), max latency %.1f ms  %s\n",
+        changes,
+        raw_changes,
+        max_latency * 1000,
+        ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+static bool check_hysteresis(void) {
+    RefloatConfig config;
+    default_config(&config);
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+
+    // Pressed, then hovering around the switch voltage within the band
+    uint32_t seed = 3;
+    float t = 0;
+    for (int i = 0; i < HERTZ / 2; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 3.0f, 3.0f, t);
+    }
+    uint32_t released = 0;
+    for (int i = 0; i < 2 * HERTZ; ++i, t += DT) {
+        float v = 1.95f + 0.2f * noise(&seed);
+        footpad_sensor_filter(&fs, v, v, t);
+        released += fs.state != FS_BOTH;
+    }
+    // Released below the band
+    for (int i = 0; i < HERTZ / 10; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 1.7f, 1.7f, t);
+    }
+
+    bool ok = released == 0 && fs.state == FS_NONE;
+    printf(
+        "hysteresis: %u iterations released inside the band  %s\n", released, ok ? "ok" : "FAIL"
+    );
+    return ok;
+}
+
+static bool check_debounce(void) {
+    RefloatConfig config;
+    default_config(&config);
+    config.fault_adc_filter = 0;
+    config.fault_delay_adc_release = 50;
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+
+    float t = 0;
+    int engage = config.fault_delay_adc_engage * HERTZ / 1000;
+    int release = config.fault_delay_adc_release * HERTZ / 1000;
+    bool ok = true;
+
+    // Released, then a tap shorter than the press debounce
+    for (int i = 0; i < 10; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 0.0f, 0.0f, t);
+    }
+    for (int i = 0; i < engage - 2; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 3.0f, 0.0f, t);
+        ok &= fs.state == FS_NONE;
+    }
+    for (int i = 0; i < 10; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 0.0f, 0.0f, t);
+        ok &= fs.state == FS_NONE;
+    }
+
+    // A press, counted after the debounce and the median delay
+    int i = 0;
+    for (; fs.state == FS_NONE && i < HERTZ; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 3.0f, 0.0f, t);
+    }
+    ok &= fs.state == FS_LEFT && i >= engage && i <= engage + 3;
+    ok &= fs.channels[0].change_time == t - DT;
+
+    // A short release doesn't count, a long one does
+    for (i = 0; i < release - 2; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 0.0f, 0.0f, t);
+        ok &= fs.state == FS_LEFT;
+    }
+    for (i = 0; i < 10; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 3.0f, 0.0f, t);
+        ok &= fs.state == FS_LEFT;
+    }
+    for (i = 0; fs.state == FS_LEFT && i < HERTZ; ++i, t += DT) {
+        footpad_sensor_filter(&fs, 0.0f, 0.0f, t);
+    }
+    ok &= fs.state == FS_NONE && i >= release && i <= release + 3;
+
+    printf("debounce: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static FootpadSensorState settle(float fault_adc1, float fault_adc2, float adc1, float adc2) {
+    RefloatConfig config;
+    default_config(&config);
+    config.fault_adc1 = fault_adc1;
+    config.fault_adc2 = fault_adc2;
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+    for (int i = 0; i < HERTZ; ++i) {
+        footpad_sensor_filter(&fs, adc1, adc2, i * DT);
+    }
+    return fs.state;
+}
+
+static bool check_setups(void) {
+    bool ok = settle(0, 0, 0, 0) == FS_BOTH && settle(2, 0, 3, 0) == FS_BOTH &&
+        settle(2, 0, 0, 3) == FS_NONE && settle(0, 2, 0, 3) == FS_BOTH &&
+        settle(0, 2, 3, 0) == FS_NONE && settle(2, 2, 3, 0) == FS_LEFT &&
+        settle(2, 2, 0, 3) == FS_RIGHT && settle(2, 2, 3, 3) == FS_BOTH;
+    printf("sensor setups: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void time_filter(void) {
+    RefloatConfig config;
+    default_config(&config);
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+
+    uint32_t seed = 5;
+    const int iterations = 10000000;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < iterations; ++i) {
+        footpad_sensor_filter(&fs, 2.0f + noise(&seed), 2.0f + noise(&seed), i * DT);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    printf("filter: %.1f ns per iteration on the host\n", seconds * 1e9 / iterations);
+}
+
+static int replay(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    RefloatConfig config;
+    default_config(&config);
+    FootpadSensor fs;
+    sensor_setup(&fs, &config);
+
+    char line[256];
+    if (!fgets(line, sizeof(line), f)) {
+        fprintf(stderr, "%s: empty\n", path);
+        fclose(f);
+        return 1;
+    }
+
+    FootpadSensorState prev = FS_NONE, prev_raw = FS_NONE;
+    uint32_t rows = 0, changes = 0, raw_changes = 0;
+    float t, adc1, adc2;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%f,%f,%f", &t, &adc1, &adc2) != 3) {
+            continue;
+        }
+        footpad_sensor_filter(&fs, adc1, adc2, t);
+        ++rows;
+
+        FootpadSensorState raw = raw_state(&config, adc1, adc2);
+        raw_changes += raw != prev_raw;
+        prev_raw = raw;
+        if (fs.state != prev) {
+            printf("%10.4f s  %d -> %d  (%.2f V, %.2f V)\n", t, prev, fs.state, fs.adc1, fs.adc2);
+            prev = fs.state;
+            ++changes;
+        }
+    }
+    fclose(f);
+
+    printf("%u rows: %u state changes, %u thresholding raw\n", rows, changes, raw_changes);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        return replay(argv[1]);
+    }
+
+    bool ok = true;
+    ok &= check_passthrough();
+    ok &= check_noisy_trace();
+    ok &= check_hysteresis();
+    ok &= check_debounce();
+    ok &= check_setups();
+    time_filter();
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// Replays recorded motor logs through motor_data_update() and check_traction()
+// and reports traction control activations, exits and throughput.
+//
+// usage: traction_replay [options] log.csv...
+//   --trace FILE        write per-sample state of the last log as CSV
+//   --hertz N           control loop frequency (default 832)
+//   --accelstart N      wheelslip_accelstart
+//   --accelend N        wheelslip_accelend
+//   --scaleaccel N      wheelslip_scaleaccel
+//   --scaleerpm N       wheelslip_scaleerpm
+//   --repeat N          replay each log N times, for throughput measurement
+
+#include "replay.h"
+#include "vesc_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(void) {
+    fprintf(
+        stderr,
+        "usage: traction_replay [--trace FILE] [--hertz N] [--accelstart N] [--accelend N]\n"
+        "                       [--scaleaccel N] [--scaleerpm N] [--repeat N] log.csv...\n"
+    );
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    config cfg;
+    replay_default_config(&cfg);
+
+    const char *trace_path = NULL;
+    int repeat = 1;
+    int first_log = argc;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (arg[0] != '-') {
+            first_log = i;
+            break;
+        }
+        if (i + 1 >= argc) {
+            usage();
+        }
+
+        const char *val = argv[++i];
+        if (strcmp(arg, "--trace") == 0) {
+            trace_path = val;
+        } else if (strcmp(arg, "--hertz") == 0) {
+            cfg.hertz = atoi(val);
+        } else if (strcmp(arg, "--accelstart") == 0) {
+            cfg.wheelslip_accelstart = atoi(val);
+        } else if (strcmp(arg, "--accelend") == 0) {
+            cfg.wheelslip_accelend = atoi(val);
+        } else if (strcmp(arg, "--scaleaccel") == 0) {
+            cfg.wheelslip_scaleaccel = atoi(val);
+        } else if (strcmp(arg, "--scaleerpm") == 0) {
+            cfg.wheelslip_scaleerpm = atoi(val);
+        } else if (strcmp(arg, "--repeat") == 0) {
+            repeat = atoi(val);
+        } else {
+            usage();
+        }
+    }
+
+    if (first_log >= argc || cfg.hertz == 0 || repeat < 1) {
+        usage();
+    }
+
+    vesc_host_init(VESC_HOST_CLOCK_VIRTUAL);
+
+    for (int i = first_log; i < argc; ++i) {
+        ReplayLog log;
+        if (!replay_load_csv(&log, argv[i])) {
+            return 1;
+        }
+
+        FILE *trace = NULL;
+        if (trace_path && i == argc - 1) {
+            trace = fopen(trace_path, "w");
+            if (!trace) {
+                fprintf(stderr, "%s: cannot open\n", trace_path);
+                return 1;
+            }
+        }
+
+        ReplayMetrics metrics;
+        double seconds = 0;
+        for (int r = 0; r < repeat; ++r) {
+            replay_run(&log, &cfg, &metrics, r == 0 ? trace : NULL);
+            seconds += metrics.seconds;
+        }
+        metrics.seconds = seconds / repeat;
+
+        if (trace) {
+            fclose(trace);
+        }
+
+        printf("%s\n", log.name);
+        replay_print_metrics(&metrics, stdout);
+        replay_free(&log);
+    }
+
+    return 0;
+}
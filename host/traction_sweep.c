@@ -0,0 +1,307 @@
+// Searches the traction control thresholds on recorded rides: every candidate
+// tune is replayed over all the logs, spread over all host cores, and the tunes
+// are ranked by missed and false detections, then by detection latency.
+//
+// The logs need the `slip` ground-truth column for the ranking to mean
+// anything, see replay.h for the log format.
+//
+// usage: traction_sweep [options] log.csv...
+//   --accelstart MIN:MAX:STEP   wheelslip_accelstart range (default 15:45:5)
+//   --accelend MIN:MAX:STEP     wheelslip_accelend range (default 0:6:2)
+//   --scaleaccel MIN:MAX:STEP   wheelslip_scaleaccel range (default 1:8:1)
+//   --scaleerpm MIN:MAX:STEP    wheelslip_scaleerpm range (default 1000:6000:1000)
+//   --random N                  evaluate N random points of the ranges instead of the full grid
+//   --hertz N                   control loop frequency (default 832)
+//   --jobs N                    number of worker threads (default: number of cores)
+//   --top N                     number of best tunes to print (default 10)
+
+#include "replay.h"
+#include "vesc_host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    int min, max, step;
+} Range;
+
+typedef struct {
+    config cfg;
+
+    uint32_t activations;
+    uint32_t false_trips;
+    uint32_t missed_slips;
+    uint32_t detected_slips;
+    float total_latency;
+} Candidate;
+
+typedef struct {
+    const ReplayLog *logs;
+    int log_count;
+    Candidate *candidates;
+    uint32_t candidate_count;
+    uint32_t next;  // index of the next candidate to evaluate, taken atomically
+} Sweep;
+
+static void usage(void) {
+    fprintf(
+        stderr,
+        "usage: traction_sweep [--accelstart MIN:MAX:STEP] [--accelend MIN:MAX:STEP]\n"
+        "                      [--scaleaccel MIN:MAX:STEP] [--scaleerpm MIN:MAX:STEP]\n"
+        "                      [--random N] [--hertz N] [--jobs N] [--top N] log.csv...\n"
+    );
+    exit(1);
+}
+
+static Range parse_range(const char *arg) {
+    Range r = {0, 0, 1};
+    if (sscanf(arg, "%d:%d:%d", &r.min, &r.max, &r.step) < 2 || r.step <= 0 || r.max < r.min) {
+        usage();
+    }
+    return r;
+}
+
+static int range_count(const Range *r) {
+    return (r->max - r->min) / r->step + 1;
+}
+
+static int range_value(const Range *r, int i) {
+    return r->min + i * r->step;
+}
+
+static void *worker(void *arg) {
+    Sweep *sweep = arg;
+
+    // Every worker drives its own plant, MotorData and TractionData live on
+    // the stack of replay_run(), so nothing is shared but the read-only logs.
+    VescHostPlant plant = {0};
+    vesc_host_use_thread_plant(&plant);
+
+    for (;;) {
+        uint32_t i = __atomic_fetch_add(&sweep->next, 1, __ATOMIC_RELAXED);
+        if (i >= sweep->candidate_count) {
+            break;
+        }
+
+        Candidate *c = &sweep->candidates[i];
+        for (int l = 0; l < sweep->log_count; ++l) {
+            ReplayMetrics m;
+            replay_run(&sweep->logs[l], &c->cfg, &m, NULL);
+            c->activations += m.activations;
+            c->false_trips += m.false_trips;
+            c->missed_slips += m.missed_slips;
+            c->detected_slips += m.detected_slips;
+            c->total_latency += m.total_latency;
+        }
+    }
+
+    return NULL;
+}
+
+static float mean_latency(const Candidate *c) {
+    return c->detected_slips ? c->total_latency / c->detected_slips : 1e9f;
+}
+
+static int compare_candidates(const void *a, const void *b) {
+    const Candidate *ca = a;
+    const Candidate *cb = b;
+
+    uint32_t errors_a = ca->false_trips + ca->missed_slips;
+    uint32_t errors_b = cb->false_trips + cb->missed_slips;
+    if (errors_a != errors_b) {
+        return errors_a < errors_b ? -1 : 1;
+    }
+
+    float latency_a = mean_latency(ca);
+    float latency_b = mean_latency(cb);
+    if (latency_a != latency_b) {
+        return latency_a < latency_b ? -1 : 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Range accelstart = {15, 45, 5};
+    Range accelend = {0, 6, 2};
+    Range scaleaccel = {1, 8, 1};
+    Range scaleerpm = {1000, 6000, 1000};
+    int random_count = 0;
+    int hertz = 832;
+    int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int top = 10;
+    int first_log = argc;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (arg[0] != '-') {
+            first_log = i;
+            break;
+        }
+        if (i + 1 >= argc) {
+            usage();
+        }
+
+        const char *val = argv[++i];
+        if (strcmp(arg, "--accelstart") == 0) {
+            accelstart = parse_range(val);
+        } else if (strcmp(arg, "--accelend") == 0) {
+            accelend = parse_range(val);
+        } else if (strcmp(arg, "--scaleaccel") == 0) {
+            scaleaccel = parse_range(val);
+        } else if (strcmp(arg, "--scaleerpm") == 0) {
+            scaleerpm = parse_range(val);
+        } else if (strcmp(arg, "--random") == 0) {
+            random_count = atoi(val);
+        } else if (strcmp(arg, "--hertz") == 0) {
+            hertz = atoi(val);
+        } else if (strcmp(arg, "--jobs") == 0) {
+            jobs = atoi(val);
+        } else if (strcmp(arg, "--top") == 0) {
+            top = atoi(val);
+        } else {
+            usage();
+        }
+    }
+
+    if (first_log >= argc || hertz <= 0 || jobs < 1 || random_count < 0) {
+        usage();
+    }
+
+    vesc_host_init(VESC_HOST_CLOCK_VIRTUAL);
+
+    int log_count = argc - first_log;
+    ReplayLog *logs = calloc(log_count, sizeof(ReplayLog));
+    if (!logs) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < log_count; ++i) {
+        if (!replay_load_csv(&logs[i], argv[first_log + i])) {
+            return 1;
+        }
+        if (!logs[i].has_slip) {
+            fprintf(stderr, "%s: warning: no slip column, nothing to rank by\n", logs[i].name);
+        }
+    }
+
+    int counts[4] = {
+        range_count(&accelstart),
+        range_count(&accelend),
+        range_count(&scaleaccel),
+        range_count(&scaleerpm),
+    };
+    uint32_t grid_size = counts[0] * counts[1] * counts[2] * counts[3];
+    uint32_t candidate_count = random_count > 0 ? (uint32_t) random_count : grid_size;
+
+    Candidate *candidates = calloc(candidate_count, sizeof(Candidate));
+    if (!candidates) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < candidate_count; ++i) {
+        int idx[4];
+        uint32_t rest = i;
+        for (int p = 0; p < 4; ++p) {
+            if (random_count > 0) {
+                seed = seed * 1664525u + 1013904223u;
+                idx[p] = (seed >> 8) % counts[p];
+            } else {
+                idx[p] = rest % counts[p];
+                rest /= counts[p];
+            }
+        }
+
+        config *cfg = &candidates[i].cfg;
+        replay_default_config(cfg);
+        cfg->hertz = hertz;
+        cfg->wheelslip_accelstart = range_value(&accelstart, idx[0]);
+        cfg->wheelslip_accelend = range_value(&accelend, idx[1]);
+        cfg->wheelslip_scaleaccel = range_value(&scaleaccel, idx[2]);
+        cfg->wheelslip_scaleerpm = range_value(&scaleerpm, idx[3]);
+    }
+
+    Sweep sweep = {
+        .logs = logs,
+        .log_count = log_count,
+        .candidates = candidates,
+        .candidate_count = candidate_count,
+        .next = 0,
+    };
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_t *threads = calloc(jobs, sizeof(pthread_t));
+    if (!threads) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    // The workers take candidates until none are left, so the ones that
+    // started do all the work
+    int started = 0;
+    for (int i = 0; i < jobs; ++i) {
+        int err = pthread_create(&threads[started], NULL, worker, &sweep);
+        if (err) {
+            fprintf(stderr, "warning: can't start worker thread: %s\n", strerror(err));
+            continue;
+        }
+        ++started;
+    }
+    if (started == 0) {
+        worker(&sweep);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    uint64_t samples = 0;
+    for (int i = 0; i < log_count; ++i) {
+        samples += logs[i].count;
+    }
+    samples *= candidate_count;
+
+    qsort(candidates, candidate_count, sizeof(Candidate), compare_candidates);
+
+    printf(
+        "%u tunes x %d logs on %d threads in %.2f s, %.2f M samples/s\n\n",
+        candidate_count,
+        log_count,
+        started > 0 ? started : 1,
+        seconds,
+        samples / seconds / 1e6
+    );
+    printf("accelstart accelend scaleaccel scaleerpm  false missed  activations  latency\n");
+    for (uint32_t i = 0; i < candidate_count && i < (uint32_t) top; ++i) {
+        const Candidate *c = &candidates[i];
+        printf(
+            "%10d %8d %10d %9d %6u %6u %12u %6.1f ms\n",
+            c->cfg.wheelslip_accelstart,
+            c->cfg.wheelslip_accelend,
+            c->cfg.wheelslip_scaleaccel,
+            c->cfg.wheelslip_scaleerpm,
+            c->false_trips,
+            c->missed_slips,
+            c->activations,
+            c->detected_slips ? 1000.0f * mean_latency(c) : 0.0f
+        );
+    }
+
+    for (int i = 0; i < log_count; ++i) {
+        replay_free(&logs[i]);
+    }
+    free(logs);
+    free(candidates);
+
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Host build shim for vesc_c_if.h.
+//
+// Sources include "vesc_c_if.h" and call everything through VESC_IF, which on
+// the ESC is a fixed address in the firmware. This header sits in front of the
+// real one on the include path and points VESC_IF at the function table
+// implemented by vesc_host.c instead, so the same sources build unmodified on
+// the host.
+
+#include "../vesc_pkg/c_libs/vesc_c_if.h"
+
+#undef VESC_IF
+
+extern vesc_c_if vesc_host_if;
+
+#define VESC_IF (&vesc_host_if)
@@ -0,0 +1,873 @@
+#include "vesc_host.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_THREADS 16
+
+typedef struct {
+    pthread_t pthread;
+    void (*fun)(void *arg);
+    void *arg;
+    volatile bool terminate;
+    bool joined;
+    bool exited;
+    bool sleeping;
+    uint64_t deadline_us;
+} HostThread;
+
+static struct {
+    VescHostClock clock;
+    struct timespec start;
+
+    // Virtual clock scheduler, guarded by sched_mutex
+    pthread_mutex_t sched_mutex;
+    pthread_cond_t sched_cond;
+    uint64_t now_us;
+    uint32_t tick_us;
+    int running;
+    HostThread harness;
+    HostThread *threads[MAX_THREADS];
+
+    // Plant, guarded by plant_mutex once there is more than one thread
+    pthread_mutex_t plant_mutex;
+    bool threaded;
+    VescHostPlant plant;
+    VescHostStepFunc step;
+    void *step_arg;
+
+    void (*imu_callback)(float *acc, float *gyro, float *mag, float dt);
+    void (*app_data_handler)(unsigned char *data, unsigned int len);
+    VescHostAppDataFunc app_data_sink;
+    void *app_data_sink_arg;
+
+    eeprom_var eeprom[VESC_HOST_EEPROM_VARS];
+    float cfg_float[CFG_PARAM_IMU_rot_yaw + 1];
+    void *arg;
+} host;
+
+static __thread HostThread *self;
+static __thread VescHostPlant *thread_plant;
+
+vesc_c_if vesc_host_if;
+
+#define PLANT_READ(field)                                                                          \
+    ({                                                                                             \
+        __typeof__(host.plant.field) _v;                                                           \
+        if (thread_plant) {                                                                        \
+            _v = thread_plant->field;                                                              \
+        } else {                                                                                   \
+            if (host.threaded) {                                                                   \
+                pthread_mutex_lock(&host.plant_mutex);                                             \
+            }                                                                                      \
+            _v = host.plant.field;                                                                 \
+            if (host.threaded) {                                                                   \
+                pthread_mutex_unlock(&host.plant_mutex);                                           \
+            }                                                                                      \
+        }                                                                                          \
+        _v;                                                                                        \
+    })
+
+#define PLANT_WRITE(field, value)                                                                  \
+    do {                                                                                           \
+        if (thread_plant) {                                                                        \
+            thread_plant->field = (value);                                                         \
+            break;                                                                                 \
+        }                                                                                          \
+        if (host.threaded) {                                                                       \
+            pthread_mutex_lock(&host.plant_mutex);                                                 \
+        }                                                                                          \
+        host.plant.field = (value);                                                                \
+        if (host.threaded) {                                                                       \
+            pthread_mutex_unlock(&host.plant_mutex);                                               \
+        }                                                                                          \
+    } while (0)
+
+static HostThread *current_thread(void) {
+    return self ? self : &host.harness;
+}
+
+static uint64_t real_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) (ts.tv_sec - host.start.tv_sec) * 1000000 +
+        (ts.tv_nsec - host.start.tv_nsec) / 1000;
+}
+
+static uint64_t now_us(void) {
+    if (host.clock == VESC_HOST_CLOCK_VIRTUAL) {
+        return __atomic_load_n(&host.now_us, __ATOMIC_RELAXED);
+    }
+    return real_time_us();
+}
+
+static void plant_step(uint64_t dt_us) {
+    if (!host.step || dt_us == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&host.plant_mutex);
+    host.step(&host.plant, dt_us * 1e-6f, host.step_arg);
+    pthread_mutex_unlock(&host.plant_mutex);
+}
+
+// Moves the virtual clock to the earliest deadline of the sleeping threads
+// and wakes up every thread whose deadline has passed. Called with
+// sched_mutex held, only when no thread is running.
+static void advance_to_next_deadline(void) {
+    uint64_t next = UINT64_MAX;
+    HostThread *all[MAX_THREADS + 1];
+    int n = 0;
+
+    all[n++] = &host.harness;
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        if (host.threads[i]) {
+            all[n++] = host.threads[i];
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (all[i]->sleeping && all[i]->deadline_us < next) {
+            next = all[i]->deadline_us;
+        }
+    }
+
+    if (next == UINT64_MAX) {
+        return;
+    }
+
+    if (next < host.now_us) {
+        next = host.now_us;
+    }
+
+    if (host.tick_us > 0) {
+        uint64_t ticks = (next + host.tick_us - 1) / host.tick_us;
+        next = ticks * host.tick_us;
+        while (host.now_us < next) {
+            plant_step(host.tick_us);
+            __atomic_store_n(&host.now_us, host.now_us + host.tick_us, __ATOMIC_RELAXED);
+        }
+    } else {
+        plant_step(next - host.now_us);
+        __atomic_store_n(&host.now_us, next, __ATOMIC_RELAXED);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (all[i]->sleeping && all[i]->deadline_us <= host.now_us) {
+            all[i]->sleeping = false;
+            ++host.running;
+        }
+    }
+
+    pthread_cond_broadcast(&host.sched_cond);
+}
+
+// Marks the calling thread as blocked. If it was the last running thread, time
+// has to move on for anyone to make progress. Called with sched_mutex held.
+static void block_begin(void) {
+    --host.running;
+    if (host.running == 0) {
+        advance_to_next_deadline();
+    }
+}
+
+static void virtual_sleep(uint64_t us) {
+    HostThread *t = current_thread();
+
+    pthread_mutex_lock(&host.sched_mutex);
+    t->deadline_us = host.now_us + us;
+    t->sleeping = true;
+    block_begin();
+    while (t->sleeping) {
+        if (host.running == 0) {
+            advance_to_next_deadline();
+        } else {
+            pthread_cond_wait(&host.sched_cond, &host.sched_mutex);
+        }
+    }
+    pthread_mutex_unlock(&host.sched_mutex);
+}
+
+static void host_sleep_us(uint32_t us) {
+    if (host.clock == VESC_HOST_CLOCK_VIRTUAL) {
+        virtual_sleep(us);
+    } else {
+        struct timespec ts = {.tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void host_sleep_ms(uint32_t ms) {
+    host_sleep_us(ms * 1000);
+}
+
+static float host_system_time(void) {
+    return now_us() * 1e-6f;
+}
+
+// The firmware sends every call as its own message, which VESC Tool shows on a
+// line of its own, with or without a trailing newline
+static int host_printf(const char *str, ...) {
+    char buffer[400];
+    va_list args;
+    va_start(args, str);
+    int res = vsnprintf(buffer, sizeof(buffer), str, args);
+    va_end(args);
+
+    size_t len = strlen(buffer);
+    fputs(buffer, stdout);
+    if (len == 0 || buffer[len - 1] != '\n') {
+        fputc('\n', stdout);
+    }
+    return res;
+}
+
+static void *host_malloc(size_t bytes) {
+    return malloc(bytes);
+}
+
+static void host_free(void *ptr) {
+    free(ptr);
+}
+
+static void *thread_entry(void *arg) {
+    HostThread *t = arg;
+    self = t;
+
+    t->fun(t->arg);
+
+    // When a thread is waiting to join this one, it takes over the running slot,
+    // otherwise the clock could move on between this thread exiting and the
+    // joining thread waking up.
+    pthread_mutex_lock(&host.sched_mutex);
+    t->exited = true;
+    if (!t->joined) {
+        block_begin();
+    }
+    pthread_mutex_unlock(&host.sched_mutex);
+    return NULL;
+}
+
+static lib_thread host_spawn(void (*fun)(void *arg), size_t stack_size, char *name, void *arg) {
+    (void) stack_size;
+    (void) name;
+
+    HostThread *t = calloc(1, sizeof(HostThread));
+    if (!t) {
+        return NULL;
+    }
+    t->fun = fun;
+    t->arg = arg;
+
+    pthread_mutex_lock(&host.sched_mutex);
+    int slot = -1;
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        if (!host.threads[i]) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0) {
+        pthread_mutex_unlock(&host.sched_mutex);
+        free(t);
+        return NULL;
+    }
+
+    host.threads[slot] = t;
+    host.threaded = true;
+    ++host.running;
+    pthread_mutex_unlock(&host.sched_mutex);
+
+    if (pthread_create(&t->pthread, NULL, thread_entry, t) != 0) {
+        pthread_mutex_lock(&host.sched_mutex);
+        host.threads[slot] = NULL;
+        --host.running;
+        pthread_mutex_unlock(&host.sched_mutex);
+        free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+static void host_request_terminate(lib_thread thd) {
+    HostThread *t = thd;
+
+    // A sleeping thread is woken up right away instead of finishing its last
+    // sleep, the joining thread is blocked until it exits.
+    pthread_mutex_lock(&host.sched_mutex);
+    t->terminate = true;
+    if (!t->exited) {
+        t->joined = true;
+        if (t->sleeping) {
+            t->sleeping = false;
+            ++host.running;
+            pthread_cond_broadcast(&host.sched_cond);
+        }
+        block_begin();
+    }
+    pthread_mutex_unlock(&host.sched_mutex);
+
+    pthread_join(t->pthread, NULL);
+
+    pthread_mutex_lock(&host.sched_mutex);
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        if (host.threads[i] == t) {
+            host.threads[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&host.sched_mutex);
+
+    free(t);
+}
+
+static bool host_should_terminate(void) {
+    return self && self->terminate;
+}
+
+static void **host_get_arg(uint32_t prog_addr) {
+    (void) prog_addr;
+    return &host.arg;
+}
+
+static lib_mutex host_mutex_create(void) {
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+    if (m) {
+        pthread_mutex_init(m, NULL);
+    }
+    return m;
+}
+
+static void host_mutex_lock(lib_mutex m) {
+    pthread_mutex_lock(m);
+}
+
+static void host_mutex_unlock(lib_mutex m) {
+    pthread_mutex_unlock(m);
+}
+
+static void host_sys_lock(void) {
+    pthread_mutex_lock(&host.plant_mutex);
+}
+
+static void host_sys_unlock(void) {
+    pthread_mutex_unlock(&host.plant_mutex);
+}
+
+static uint32_t host_timer_time_now(void) {
+    return (uint32_t) now_us();
+}
+
+static float host_timer_seconds_elapsed_since(uint32_t time) {
+    return (uint32_t) (host_timer_time_now() - time) * 1e-6f;
+}
+
+// IO
+
+static bool host_io_set_mode(VESC_PIN pin, VESC_PIN_MODE mode) {
+    (void) pin;
+    (void) mode;
+    return true;
+}
+
+static bool host_io_write(VESC_PIN pin, int state) {
+    (void) pin;
+    (void) state;
+    return true;
+}
+
+static bool host_io_read(VESC_PIN pin) {
+    (void) pin;
+    return false;
+}
+
+static float host_io_read_analog(VESC_PIN pin) {
+    switch (pin) {
+    case VESC_PIN_ADC1:
+        return PLANT_READ(adc[0]);
+    case VESC_PIN_ADC2:
+        return PLANT_READ(adc[1]);
+    default:
+        return 0.0f;
+    }
+}
+
+static void host_set_pad_mode(void *gpio, uint32_t pin, uint32_t mode) {
+    (void) gpio;
+    (void) pin;
+    (void) mode;
+}
+
+// Motor
+
+static mc_fault_code host_mc_get_fault(void) {
+    return PLANT_READ(fault);
+}
+
+static const char *host_mc_fault_to_string(mc_fault_code fault) {
+    return fault == FAULT_CODE_NONE ? "FAULT_CODE_NONE" : "FAULT_CODE";
+}
+
+static void host_mc_set_current(float current) {
+    PLANT_WRITE(set_current, current);
+    PLANT_WRITE(set_brake_current, 0.0f);
+    PLANT_WRITE(released, false);
+}
+
+static void host_mc_set_brake_current(float current) {
+    PLANT_WRITE(set_current, 0.0f);
+    PLANT_WRITE(set_brake_current, current);
+    PLANT_WRITE(released, false);
+}
+
+static void host_mc_release_motor(void) {
+    PLANT_WRITE(set_current, 0.0f);
+    PLANT_WRITE(set_brake_current, 0.0f);
+    PLANT_WRITE(released, true);
+}
+
+static void host_mc_set_current_off_delay(float delay_sec) {
+    (void) delay_sec;
+}
+
+static float host_mc_get_duty_cycle_now(void) {
+    return PLANT_READ(duty_cycle);
+}
+
+static float host_mc_get_rpm(void) {
+    return PLANT_READ(erpm);
+}
+
+static float host_mc_get_tot_current(void) {
+    float current = PLANT_READ(current);
+    return current < 0 ? -current : current;
+}
+
+static float host_mc_get_tot_current_directional(void) {
+    return PLANT_READ(current);
+}
+
+static float host_mc_get_tot_current_in(void) {
+    return PLANT_READ(current_in);
+}
+
+static float host_mc_get_input_voltage_filtered(void) {
+    return PLANT_READ(input_voltage);
+}
+
+static float host_mc_get_zero(bool reset) {
+    (void) reset;
+    return 0.0f;
+}
+
+static float host_mc_temp_fet_filtered(void) {
+    return PLANT_READ(temp_fet);
+}
+
+static float host_mc_temp_motor_filtered(void) {
+    return PLANT_READ(temp_motor);
+}
+
+static float host_mc_get_battery_level(float *wh_left) {
+    if (wh_left) {
+        *wh_left = 0.0f;
+    }
+    return PLANT_READ(battery_level);
+}
+
+static float host_mc_get_speed(void) {
+    return PLANT_READ(speed);
+}
+
+static float host_mc_get_distance(void) {
+    return PLANT_READ(distance);
+}
+
+static uint64_t host_mc_get_odometer(void) {
+    return PLANT_READ(odometer);
+}
+
+static void host_mc_set_odometer(uint64_t new_odometer_meters) {
+    PLANT_WRITE(odometer, new_odometer_meters);
+}
+
+static float host_foc_get_id(void) {
+    return PLANT_READ(foc_id);
+}
+
+// Comm
+
+static void host_send_app_data(unsigned char *data, unsigned int len) {
+    if (host.app_data_sink) {
+        host.app_data_sink(data, len, host.app_data_sink_arg);
+    }
+}
+
+static bool host_set_app_data_handler(void (*func)(unsigned char *data, unsigned int len)) {
+    host.app_data_handler = func;
+    return true;
+}
+
+// IMU
+
+static bool host_imu_startup_done(void) {
+    return true;
+}
+
+static float host_imu_get_roll(void) {
+    return PLANT_READ(roll);
+}
+
+static float host_imu_get_pitch(void) {
+    return PLANT_READ(pitch);
+}
+
+static float host_imu_get_yaw(void) {
+    return PLANT_READ(yaw);
+}
+
+// Copies the array at @p offset in the plant, consistently when threaded
+static void copy_plant(float *dst, size_t offset, size_t n) {
+    if (thread_plant) {
+        memcpy(dst, (const char *) thread_plant + offset, n * sizeof(float));
+        return;
+    }
+
+    if (host.threaded) {
+        pthread_mutex_lock(&host.plant_mutex);
+    }
+    memcpy(dst, (const char *) &host.plant + offset, n * sizeof(float));
+    if (host.threaded) {
+        pthread_mutex_unlock(&host.plant_mutex);
+    }
+}
+
+static void host_imu_get_rpy(float *rpy) {
+    float v[3] = {PLANT_READ(roll), PLANT_READ(pitch), PLANT_READ(yaw)};
+    memcpy(rpy, v, sizeof(v));
+}
+
+static void host_imu_get_accel(float *accel) {
+    copy_plant(accel, offsetof(VescHostPlant, accel), 3);
+}
+
+static void host_imu_get_gyro(float *gyro) {
+    copy_plant(gyro, offsetof(VescHostPlant, gyro), 3);
+}
+
+static void host_imu_get_quaternions(float *q) {
+    copy_plant(q, offsetof(VescHostPlant, quaternions), 4);
+}
+
+static void host_imu_set_read_callback(void (*func)(float *acc, float *gyro, float *mag, float dt)) {
+    host.imu_callback = func;
+}
+
+// EEPROM
+
+static bool host_read_eeprom_var(eeprom_var *v, int address) {
+    if (address < 0 || address >= VESC_HOST_EEPROM_VARS) {
+        return false;
+    }
+    *v = host.eeprom[address];
+    return true;
+}
+
+static bool host_store_eeprom_var(eeprom_var *v, int address) {
+    if (address < 0 || address >= VESC_HOST_EEPROM_VARS) {
+        return false;
+    }
+    host.eeprom[address] = *v;
+    return true;
+}
+
+static bool host_store_backup_data(void) {
+    return true;
+}
+
+static void host_timeout_reset(void) {
+}
+
+// Config
+
+static void host_conf_custom_add_config(
+    int (*get_cfg)(uint8_t *data, bool is_default),
+    bool (*set_cfg)(uint8_t *data),
+    int (*get_cfg_xml)(uint8_t **data)
+) {
+    (void) get_cfg;
+    (void) set_cfg;
+    (void) get_cfg_xml;
+}
+
+static void host_conf_custom_clear_configs(void) {
+}
+
+static float host_get_cfg_float(CFG_PARAM p) {
+    if ((unsigned) p > CFG_PARAM_IMU_rot_yaw) {
+        return 0.0f;
+    }
+    return host.cfg_float[p];
+}
+
+static int host_get_cfg_int(CFG_PARAM p) {
+    return (int) host_get_cfg_float(p);
+}
+
+static bool host_set_cfg_float(CFG_PARAM p, float value) {
+    if ((unsigned) p > CFG_PARAM_IMU_rot_yaw) {
+        return false;
+    }
+    host.cfg_float[p] = value;
+    return true;
+}
+
+static bool host_set_cfg_int(CFG_PARAM p, int value) {
+    return host_set_cfg_float(p, value);
+}
+
+static bool host_store_cfg(void) {
+    return true;
+}
+
+// Input devices
+
+static remote_state host_get_remote_state(void) {
+    if (thread_plant) {
+        return thread_plant->remote;
+    }
+    if (host.threaded) {
+        pthread_mutex_lock(&host.plant_mutex);
+    }
+    remote_state remote = host.plant.remote;
+    if (host.threaded) {
+        pthread_mutex_unlock(&host.plant_mutex);
+    }
+    return remote;
+}
+
+static float host_get_ppm(void) {
+    return PLANT_READ(ppm);
+}
+
+static float host_get_ppm_age(void) {
+    return 0.0f;
+}
+
+static bool host_app_is_output_disabled(void) {
+    return false;
+}
+
+// LispBM
+
+static bool host_lbm_add_extension(char *name, extension_fptr func) {
+    (void) name;
+    (void) func;
+    return true;
+}
+
+void vesc_host_init(VescHostClock clock) {
+    memset(&host, 0, sizeof(host));
+    memset(&vesc_host_if, 0, sizeof(vesc_host_if));
+
+    host.clock = clock;
+    clock_gettime(CLOCK_MONOTONIC, &host.start);
+    pthread_mutex_init(&host.sched_mutex, NULL);
+    pthread_cond_init(&host.sched_cond, NULL);
+
+    // Recursive, so that step callbacks can call into code that uses VESC_IF
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&host.plant_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    host.running = 1;
+    host.plant.quaternions[0] = 1.0f;
+    host.plant.battery_level = 1.0f;
+    host.plant.accel[2] = 1.0f;
+
+    vesc_c_if *v = &vesc_host_if;
+
+    v->sleep_ms = host_sleep_ms;
+    v->sleep_us = host_sleep_us;
+    v->system_time = host_system_time;
+    v->printf = host_printf;
+    v->malloc = host_malloc;
+    v->free = host_free;
+    v->spawn = host_spawn;
+    v->request_terminate = host_request_terminate;
+    v->should_terminate = host_should_terminate;
+    v->get_arg = host_get_arg;
+
+    v->set_pad_mode = host_set_pad_mode;
+    v->io_set_mode = host_io_set_mode;
+    v->io_write = host_io_write;
+    v->io_read = host_io_read;
+    v->io_read_analog = host_io_read_analog;
+
+    v->mc_get_fault = host_mc_get_fault;
+    v->mc_fault_to_string = host_mc_fault_to_string;
+    v->mc_set_current = host_mc_set_current;
+    v->mc_set_brake_current = host_mc_set_brake_current;
+    v->mc_release_motor = host_mc_release_motor;
+    v->mc_get_duty_cycle_now = host_mc_get_duty_cycle_now;
+    v->mc_get_rpm = host_mc_get_rpm;
+    v->mc_get_amp_hours = host_mc_get_zero;
+    v->mc_get_amp_hours_charged = host_mc_get_zero;
+    v->mc_get_watt_hours = host_mc_get_zero;
+    v->mc_get_watt_hours_charged = host_mc_get_zero;
+    v->mc_get_tot_current = host_mc_get_tot_current;
+    v->mc_get_tot_current_filtered = host_mc_get_tot_current;
+    v->mc_get_tot_current_directional = host_mc_get_tot_current_directional;
+    v->mc_get_tot_current_directional_filtered = host_mc_get_tot_current_directional;
+    v->mc_get_tot_current_in = host_mc_get_tot_current_in;
+    v->mc_get_tot_current_in_filtered = host_mc_get_tot_current_in;
+    v->mc_get_input_voltage_filtered = host_mc_get_input_voltage_filtered;
+    v->mc_temp_fet_filtered = host_mc_temp_fet_filtered;
+    v->mc_temp_motor_filtered = host_mc_temp_motor_filtered;
+    v->mc_get_battery_level = host_mc_get_battery_level;
+    v->mc_get_speed = host_mc_get_speed;
+    v->mc_get_distance = host_mc_get_distance;
+    v->mc_get_distance_abs = host_mc_get_distance;
+    v->mc_get_odometer = host_mc_get_odometer;
+    v->mc_set_odometer = host_mc_set_odometer;
+    v->mc_set_current_off_delay = host_mc_set_current_off_delay;
+    v->foc_get_id = host_foc_get_id;
+
+    v->send_app_data = host_send_app_data;
+    v->set_app_data_handler = host_set_app_data_handler;
+
+    v->imu_startup_done = host_imu_startup_done;
+    v->imu_get_roll = host_imu_get_roll;
+    v->imu_get_pitch = host_imu_get_pitch;
+    v->imu_get_yaw = host_imu_get_yaw;
+    v->imu_get_rpy = host_imu_get_rpy;
+    v->imu_get_accel = host_imu_get_accel;
+    v->imu_get_gyro = host_imu_get_gyro;
+    v->imu_get_quaternions = host_imu_get_quaternions;
+    v->imu_set_read_callback = host_imu_set_read_callback;
+
+    v->read_eeprom_var = host_read_eeprom_var;
+    v->store_eeprom_var = host_store_eeprom_var;
+    v->store_backup_data = host_store_backup_data;
+    v->timeout_reset = host_timeout_reset;
+
+    v->conf_custom_add_config = host_conf_custom_add_config;
+    v->conf_custom_clear_configs = host_conf_custom_clear_configs;
+    v->get_cfg_float = host_get_cfg_float;
+    v->get_cfg_int = host_get_cfg_int;
+    v->set_cfg_float = host_set_cfg_float;
+    v->set_cfg_int = host_set_cfg_int;
+    v->store_cfg = host_store_cfg;
+
+    v->mutex_create = host_mutex_create;
+    v->mutex_lock = host_mutex_lock;
+    v->mutex_unlock = host_mutex_unlock;
+    v->timer_time_now = host_timer_time_now;
+    v->timer_seconds_elapsed_since = host_timer_seconds_elapsed_since;
+    v->sys_lock = host_sys_lock;
+    v->sys_unlock = host_sys_unlock;
+
+    v->get_remote_state = host_get_remote_state;
+    v->get_ppm = host_get_ppm;
+    v->get_ppm_age = host_get_ppm_age;
+    v->app_is_output_disabled = host_app_is_output_disabled;
+
+    v->lbm_add_extension = host_lbm_add_extension;
+}
+
+void vesc_host_set_step(VescHostStepFunc step, void *arg) {
+    pthread_mutex_lock(&host.plant_mutex);
+    host.step = step;
+    host.step_arg = arg;
+    pthread_mutex_unlock(&host.plant_mutex);
+}
+
+void vesc_host_set_tick(uint32_t tick_us) {
+    pthread_mutex_lock(&host.sched_mutex);
+    host.tick_us = tick_us;
+    pthread_mutex_unlock(&host.sched_mutex);
+}
+
+VescHostPlant *vesc_host_plant_lock(void) {
+    pthread_mutex_lock(&host.plant_mutex);
+    return &host.plant;
+}
+
+void vesc_host_plant_unlock(void) {
+    pthread_mutex_unlock(&host.plant_mutex);
+}
+
+VescHostPlant *vesc_host_plant(void) {
+    return thread_plant ? thread_plant : &host.plant;
+}
+
+void vesc_host_use_thread_plant(VescHostPlant *plant) {
+    thread_plant = plant;
+}
+
+void vesc_host_advance(uint32_t dt_us) {
+    pthread_mutex_lock(&host.sched_mutex);
+    plant_step(dt_us);
+    if (host.clock == VESC_HOST_CLOCK_VIRTUAL) {
+        __atomic_store_n(&host.now_us, host.now_us + dt_us, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&host.sched_mutex);
+}
+
+void vesc_host_run_until(float t) {
+    uint64_t target = (uint64_t) (t * 1e6f);
+    uint64_t now = now_us();
+    if (target > now) {
+        host_sleep_us(target - now);
+    }
+}
+
+void vesc_host_imu_sample(float dt) {
+    if (!host.imu_callback) {
+        return;
+    }
+
+    // The firmware passes the gyro to the callback in rad/s
+    float acc[3], gyro[3], mag[3] = {0};
+    host_imu_get_accel(acc);
+    host_imu_get_gyro(gyro);
+    for (int i = 0; i < 3; ++i) {
+        gyro[i] *= (float) M_PI / 180.0f;
+    }
+    host.imu_callback(acc, gyro, mag, dt);
+}
+
+void vesc_host_app_data_receive(unsigned char *data, unsigned int len) {
+    if (host.app_data_handler) {
+        host.app_data_handler(data, len);
+    }
+}
+
+void vesc_host_set_app_data_sink(VescHostAppDataFunc func, void *arg) {
+    host.app_data_sink = func;
+    host.app_data_sink_arg = arg;
+}
+
+eeprom_var *vesc_host_eeprom(void) {
+    return host.eeprom;
+}
+
+void vesc_host_terminate_all(void) {
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        pthread_mutex_lock(&host.sched_mutex);
+        HostThread *t = host.threads[i];
+        pthread_mutex_unlock(&host.sched_mutex);
+        if (t) {
+            host_request_terminate(t);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host-side implementation of the VESC_IF function table.
+//
+// The motor, IMU and IO getters read from a VescHostPlant, which the harness
+// fills in directly or updates from a step callback. Time is either the real
+// monotonic clock, or a virtual clock that only moves when every thread known
+// to the host (the harness thread plus anything started through
+// VESC_IF->spawn) is sleeping. In the virtual mode code written against
+// sleep_us() runs as fast as the host allows and stays deterministic.
+//
+// Only the subset of the table used by the packages in this tree is
+// implemented, the rest of the pointers are NULL. LispBM extensions are
+// accepted and never called.
+
+#define VESC_HOST_EEPROM_VARS 1024
+
+typedef enum {
+    VESC_HOST_CLOCK_REAL = 0,
+    VESC_HOST_CLOCK_VIRTUAL
+} VescHostClock;
+
+typedef struct {
+    // Motor
+    float erpm;
+    float current;  // directional motor current
+    float current_in;
+    float duty_cycle;
+    float input_voltage;
+    float temp_fet;
+    float temp_motor;
+    float battery_level;
+    float speed;
+    float distance;
+    uint64_t odometer;
+    float foc_id;
+    mc_fault_code fault;
+
+    // Last motor command issued by the code under test
+    float set_current;
+    float set_brake_current;
+    bool released;
+
+    // IMU, angles in radians like VESC_IF->imu_get_pitch(), gyro in deg/s
+    float pitch, roll, yaw;
+    float accel[3];
+    float gyro[3];
+    float quaternions[4];
+
+    // IO
+    float adc[2];
+    float ppm;
+    remote_state remote;
+} VescHostPlant;
+
+/**
+ * Called with the elapsed time whenever the clock advances in the virtual
+ * mode, or by vesc_host_advance() in either mode. The plant is locked for the
+ * duration of the call.
+ */
+typedef void (*VescHostStepFunc)(VescHostPlant *plant, float dt, void *arg);
+
+typedef void (*VescHostAppDataFunc)(unsigned char *data, unsigned int len, void *arg);
+
+/**
+ * Resets the host state (plant, clock, eeprom, registered handlers) and
+ * selects the clock mode. Must be called before any code uses VESC_IF.
+ */
+void vesc_host_init(VescHostClock clock);
+
+void vesc_host_set_step(VescHostStepFunc step, void *arg);
+
+/**
+ * Sets the step of the virtual clock. A sleeping thread wakes up at the first
+ * multiple of the step past its deadline and the step callback is invoked
+ * once per step, which makes the plant integrate at a fixed rate regardless
+ * of how the code under test sleeps. Defaults to 0, which jumps straight to
+ * the next deadline.
+ */
+void vesc_host_set_tick(uint32_t tick_us);
+
+/**
+ * Locks the plant against concurrent updates and returns it. Not needed when
+ * the harness is the only thread.
+ */
+VescHostPlant *vesc_host_plant_lock(void);
+
+void vesc_host_plant_unlock(void);
+
+/**
+ * Returns the plant without locking, for single-threaded harnesses.
+ */
+VescHostPlant *vesc_host_plant(void);
+
+/**
+ * Makes VESC_IF calls from the calling thread read and write @p plant
+ * instead of the shared one, without any locking. Lets independent workers
+ * each drive their own copy of the code under test in parallel. The step
+ * callback and the clock stay shared. Pass NULL to go back to the shared
+ * plant.
+ */
+void vesc_host_use_thread_plant(VescHostPlant *plant);
+
+/**
+ * Advances the virtual clock by @p dt_us and runs the step callback. In the
+ * real clock mode only runs the step callback.
+ */
+void vesc_host_advance(uint32_t dt_us);
+
+/**
+ * Sleeps the harness thread until time @p t (in seconds since init), letting
+ * spawned threads run in the meantime.
+ */
+void vesc_host_run_until(float t);
+
+/**
+ * Invokes the callback registered through VESC_IF->imu_set_read_callback()
+ * with the current plant accelerometer and gyro values, the gyro converted to
+ * rad/s like the firmware does.
+ */
+void vesc_host_imu_sample(float dt);
+
+/**
+ * Delivers @p data to the handler registered through
+ * VESC_IF->set_app_data_handler(), as if it arrived from VESC Tool.
+ */
+void vesc_host_app_data_receive(unsigned char *data, unsigned int len);
+
+/**
+ * Sets the function receiving everything sent through VESC_IF->send_app_data().
+ */
+void vesc_host_set_app_data_sink(VescHostAppDataFunc func, void *arg);
+
+eeprom_var *vesc_host_eeprom(void);
+
+/**
+ * Requests termination of all threads started through VESC_IF->spawn() and
+ * waits for them to exit.
+ */
+void vesc_host_terminate_all(void);
@@ -0,0 +1,115 @@
+#include "loop_timing.h"
+
+#include "buffer.h"
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define CHUNK_HEADER_SIZE 8
+#define STAGE_SIZE (4 * 4 + 4 * LOOP_TIMING_BUCKETS)
+#define DOWNLOAD_BUFFER_SIZE 500
+
+void loop_timing_start_counter(void) {
+#if defined(__arm__)
+    *(volatile uint32_t *) 0xE000EDFC |= 1 << 24;  // CoreDebug->DEMCR |= TRCENA
+    *(volatile uint32_t *) 0xE0001000 |= 1;  // DWT->CTRL |= CYCCNTENA
+#endif
+}
+
+void loop_timing_reset(LoopTiming *lt) {
+    memset(lt, 0, sizeof(LoopTiming));
+    for (int i = 0; i < LOOP_STAGE_COUNT; i++) {
+        lt->stages[i].min = UINT32_MAX;
+    }
+
+    loop_timing_start_counter();
+}
+
+void loop_timing_add(LoopTiming *lt, LoopStage stage, uint32_t ticks) {
+    LoopStageTiming *s = &lt->stages[stage];
+
+    ++s->count;
+    s->sum += ticks;
+    if (ticks < s->min) {
+        s->min = ticks;
+    }
+    if (ticks > s->max) {
+        s->max = ticks;
+    }
+
+    int bucket = ticks ? 31 - __builtin_clz(ticks) : 0;
+    if (bucket >= LOOP_TIMING_BUCKETS) {
+        bucket = LOOP_TIMING_BUCKETS - 1;
+    }
+    ++s->histogram[bucket];
+}
+
+float loop_timing_mean(const LoopStageTiming *stage) {
+    return stage->count ? (float) stage->sum / stage->count : 0;
+}
+
+// The sum is read while the loop adds to it, which takes two loads on the
+// ESC. It only grows until a reset, so the words belong together when the high
+// one reads the same before and after the low one.
+static uint64_t read_sum(const LoopStageTiming *stage) {
+    const volatile uint32_t *words = (const volatile uint32_t *) &stage->sum;
+    uint32_t high, low;
+    do {
+        high = words[1];
+        low = words[0];
+    } while (words[1] != high);
+    return (uint64_t) high << 32 | low;
+}
+
+int32_t loop_timing_read_chunk(
+    const LoopTiming *lt, uint8_t first_stage, uint8_t *buffer, int32_t size
+) {
+    if (size < CHUNK_HEADER_SIZE) {
+        return 0;
+    }
+
+    int32_t ind = 0;
+    buffer_append_uint32(buffer, LOOP_TIMING_TICKS_PER_US, &ind);
+    buffer[ind++] = LOOP_STAGE_COUNT;
+    buffer[ind++] = LOOP_TIMING_BUCKETS;
+    buffer[ind++] = first_stage;
+    int32_t count_ind = ind++;
+
+    uint8_t n = 0;
+    for (uint8_t i = first_stage; i < LOOP_STAGE_COUNT && ind + STAGE_SIZE <= size; ++i, ++n) {
+        const LoopStageTiming *s = &lt->stages[i];
+        uint32_t count = s->count;
+
+        buffer_append_uint32(buffer, count, &ind);
+        buffer_append_uint32(buffer, count ? s->min : 0, &ind);
+        buffer_append_uint32(buffer, s->max, &ind);
+        buffer_append_float32_auto(buffer, count ? (float) read_sum(s) / count : 0, &ind);
+        for (int b = 0; b < LOOP_TIMING_BUCKETS; b++) {
+            buffer_append_uint32(buffer, s->histogram[b], &ind);
+        }
+    }
+
+    buffer[count_ind] = n;
+    return ind;
+}
+
+void loop_timing_cmd_download(
+    LoopTiming *lt, uint8_t magic, uint8_t command, unsigned char *cfg, int len
+) {
+    uint8_t first_stage = len >= 1 ? cfg[0] : 0;
+    bool reset = len >= 2 && cfg[1];
+
+    uint8_t buffer[DOWNLOAD_BUFFER_SIZE];
+    int32_t ind = 0;
+    buffer[ind++] = magic;
+    buffer[ind++] = command;
+    ind += loop_timing_read_chunk(lt, first_stage, buffer + ind, sizeof(buffer) - ind);
+
+    VESC_IF->send_app_data(buffer, ind);
+
+    if (reset) {
+        __atomic_store_n(&lt->reset_pending, true, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-stage timing of the control loop: min/mean/max and a log2 histogram of
+// every stage, in ticks of the cycle counter (DWT CYCCNT on the ESC,
+// nanoseconds from clock_gettime() on the host).
+//
+// Compiled in only with LOOP_TIMING defined, otherwise the LOOP_TIMING_*
+// macros the loop is instrumented with are empty.
+
+#if !defined(__arm__)
+#include <time.h>
+#endif
+
+#ifndef LOOP_TIMING_TICKS_PER_US
+#if defined(__arm__)
+#define LOOP_TIMING_TICKS_PER_US 168  // STM32F4 core clock
+#else
+#define LOOP_TIMING_TICKS_PER_US 1000
+#endif
+#endif
+
+// Bucket i of the histogram counts durations of [2^i, 2^(i + 1)) ticks, the
+// first one also 0 and the last one everything longer.
+#define LOOP_TIMING_BUCKETS 20
+
+typedef enum {
+    LOOP_STAGE_IMU = 0,
+    LOOP_STAGE_MOTOR_DATA,
+    LOOP_STAGE_TRACTION,
+    LOOP_STAGE_SURGE,
+    LOOP_STAGE_PID,
+    LOOP_STAGE_OUTPUT,
+    LOOP_STAGE_TOTAL,  // whole iteration, from LOOP_TIMING_BEGIN to LOOP_TIMING_END
+    LOOP_STAGE_COUNT
+} LoopStage;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t histogram[LOOP_TIMING_BUCKETS];
+} LoopStageTiming;
+
+// Only the loop writes the statistics, the command handler asks for a reset
+// through reset_pending, which the loop adopts at the beginning of its next
+// iteration.
+typedef struct {
+    LoopStageTiming stages[LOOP_STAGE_COUNT];
+    uint32_t iteration_start;
+    uint32_t stage_start;
+    volatile bool reset_pending;
+} LoopTiming;
+
+static inline uint32_t loop_timing_now(void) {
+#if defined(__arm__)
+    return *(volatile uint32_t *) 0xE0001004;  // DWT->CYCCNT
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+/**
+ * Starts the DWT cycle counter loop_timing_now() reads on the ESC. Nothing to
+ * do on the host.
+ */
+void loop_timing_start_counter(void);
+
+/**
+ * Clears the statistics and starts the cycle counter.
+ */
+void loop_timing_reset(LoopTiming *lt);
+
+void loop_timing_add(LoopTiming *lt, LoopStage stage, uint32_t ticks);
+
+static inline void loop_timing_begin(LoopTiming *lt) {
+    if (__atomic_load_n(&lt->reset_pending, __ATOMIC_ACQUIRE)) {
+        loop_timing_reset(lt);
+    }
+    lt->iteration_start = loop_timing_now();
+    lt->stage_start = lt->iteration_start;
+}
+
+// Closes @p stage, which started at the previous mark or at the beginning of
+// the iteration, so consecutive stages cost one counter read each.
+static inline void loop_timing_mark(LoopTiming *lt, LoopStage stage) {
+    uint32_t now = loop_timing_now();
+    loop_timing_add(lt, stage, now - lt->stage_start);
+    lt->stage_start = now;
+}
+
+static inline void loop_timing_end(LoopTiming *lt) {
+    uint32_t now = loop_timing_now();
+    loop_timing_add(lt, LOOP_STAGE_TOTAL, now - lt->iteration_start);
+    lt->stage_start = now;
+}
+
+#ifdef LOOP_TIMING
+#define LOOP_TIMING_BEGIN(lt) loop_timing_begin(lt)
+#define LOOP_TIMING_MARK(lt, stage) loop_timing_mark(lt, stage)
+#define LOOP_TIMING_END(lt) loop_timing_end(lt)
+#else
+#define LOOP_TIMING_BEGIN(lt) ((void) (lt))
+#define LOOP_TIMING_MARK(lt, stage) ((void) (lt))
+#define LOOP_TIMING_END(lt) ((void) (lt))
+#endif
+
+float loop_timing_mean(const LoopStageTiming *stage);
+
+/**
+ * Serializes stages starting from @p first_stage into @p buffer, as many as
+ * fit into @p size bytes.
+ *
+ * Layout: ticks per microsecond (uint32), number of stages (uint8), number of
+ * histogram buckets (uint8), index of the first stage in this chunk (uint8),
+ * number of stages in this chunk (uint8), then for each stage: count, min and
+ * max (uint32), mean (float32_auto) and the histogram (uint32 each).
+ *
+ * @return Number of bytes written.
+ */
+int32_t loop_timing_read_chunk(
+    const LoopTiming *lt, uint8_t first_stage, uint8_t *buffer, int32_t size
+);
+
+/**
+ * Handles a download request: @p cfg holds the first stage to send (uint8)
+ * and optionally a flag (uint8) to reset the statistics after reading them,
+ * which the loop does at the beginning of its next iteration.
+ * Replies over app data with @p magic and @p command followed by a chunk from
+ * loop_timing_read_chunk(). The client asks again starting after the last
+ * stage it received until it has all of them.
+ */
+void loop_timing_cmd_download(
+    LoopTiming *lt, uint8_t magic, uint8_t command, unsigned char *cfg, int len
+);
@@ -26,21 +26,13 @@
 void motor_data_reset(MotorData *m) {
     m->erpm_sign_soft = 0;
     m->acceleration = 0;
-    m->accel_idx = 0;
-    for (int i = 0; i < ACCEL_ARRAY_SIZE; i++) {
-        m->accel_history[i] = 0;
-    }
+    WINDOW_INIT(&m->accel_history, m->accel_buffer, ACCEL_ARRAY_SIZE);
+    WINDOW_INIT_EXTREMA(&m->erpm_history, m->erpm_buffer, m->erpm_extrema, ERPM_ARRAY_SIZE);
 
-    m->erpm_idx = 0;
-    for (int i = 0; i < ERPM_ARRAY_SIZE; i++) {
-        m->erpm_history[i] = 0;
-    }
-    
     m->current_avg = 0;
-    m->current_idx = 0;
-    for (int i = 0; i < CURRENT_ARRAY_SIZE; i++) {
-        m->current_history[i] = 0;
-    }
+    WINDOW_INIT_EXTREMA(
+        &m->current_history, m->current_buffer, m->current_extrema, CURRENT_ARRAY_SIZE
+    );
 
     biquad_reset(&m->atr_current_biquad);
 }
@@ -73,22 +65,13 @@ void motor_data_update(MotorData *m) {
     }
 
     //Averaging/tracking for acceleration, erpm, and current
-    float current_acceleration = m->erpm - m->last_erpm;
-    m->acceleration += (current_acceleration - m->accel_history[m->accel_idx]) / ACCEL_ARRAY_SIZE;
-    m->accel_history[m->accel_idx] = current_acceleration;
-    m->last_accel_idx = m->accel_idx;
-    m->accel_idx = (m->accel_idx + 1) % ACCEL_ARRAY_SIZE;
+    window_push(&m->accel_history, m->erpm - m->last_erpm);
+    m->acceleration = window_mean(&m->accel_history);
+
+    window_push(&m->erpm_history, m->erpm);
+
+    window_push(&m->current_history, m->atr_filtered_current);
+    m->current_avg = window_mean(&m->current_history);
 
-    m->erpm_history[m->erpm_idx] = m->erpm;
-    m->erpm_idx = (m->erpm_idx + 1) % ERPM_ARRAY_SIZE;
-    m->last_erpm_idx = m->erpm_idx - ACCEL_ARRAY_SIZE; // Identify ERPM at the start of the acceleration array
-	if (m->last_erpm_idx < 0) {
-		m->last_erpm_idx += ERPM_ARRAY_SIZE;
-	}
-    
-    m->current_avg += (m->atr_filtered_current - m->current_history[m->current_idx]) / CURRENT_ARRAY_SIZE;
-    m->current_history[m->current_idx] = m->atr_filtered_current;
-    m->current_idx = (m->current_idx + 1) % CURRENT_ARRAY_SIZE;
-    
     m->last_erpm = m->erpm;
 }
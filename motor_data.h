@@ -18,6 +18,7 @@
 #pragma once
 
 #include "biquad.h"
+#include "window.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -41,17 +42,18 @@ typedef struct {
 
     // an average calculated over last ACCEL_ARRAY_SIZE values
     float acceleration;
-    float accel_history[ACCEL_ARRAY_SIZE];
-    uint8_t accel_idx;
-    uint8_t last_accel_idx;
-	
-    float erpm_history[ERPM_ARRAY_SIZE];
-    int erpm_idx;
-    int last_erpm_idx;
+    Window accel_history;
+    float accel_buffer[WINDOW_CAPACITY(ACCEL_ARRAY_SIZE)];
+
+    // min/max over the windows available through window_min() / window_max()
+    Window erpm_history;
+    float erpm_buffer[WINDOW_CAPACITY(ERPM_ARRAY_SIZE)];
+    uint8_t erpm_extrema[WINDOW_EXTREMA_CAPACITY(ERPM_ARRAY_SIZE)];
 
     float current_avg;
-    float current_history[CURRENT_ARRAY_SIZE];
-    int8_t current_idx;
+    Window current_history;
+    float current_buffer[WINDOW_CAPACITY(CURRENT_ARRAY_SIZE)];
+    uint8_t current_extrema[WINDOW_EXTREMA_CAPACITY(CURRENT_ARRAY_SIZE)];
 
     bool atr_filter_enabled;
     Biquad atr_current_biquad;
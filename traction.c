@@ -2,42 +2,39 @@
 #include <math.h>
 #include "utils.h"
 
-void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeData *rt, config *config, TractionDebug *traction_dbg){
-	float erpmfactor = fmaxf(1, lerp(0, config->wheelslip_scaleerpm, config->wheelslip_scaleaccel, 1, m->abs_erpm));
+void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeData *rt, TractionDebug *traction_dbg){
+	float erpmfactor = fmaxf(1, traction->erpmfactor_base + traction->erpmfactor_slope * m->abs_erpm);
 	bool start_condition1 = false;
+	float oldest_accel = window_oldest(&m->accel_history);
+	float accel_start_erpm = window_get(&m->erpm_history, ACCEL_ARRAY_SIZE - 1);	// ERPM at the start of the acceleration window
 	
 	// Conditons to end traction control
 	if (state->wheelslip) {
 		if (rt->current_time - traction->timeron > .3) {		// Time out at 300ms
-			traction_dbg->debug4 = 300;
-			deactivate_traction(traction, state, rt, traction_dbg);
+			deactivate_traction(m, traction, state, rt, traction_dbg, TRACTION_EXIT_TIMEOUT);
 		} else {
 			//This section determines if the wheel is acted on by outside forces by detecting acceleration direction change
 			if (traction->highaccelon) { 
-				if (sign(traction->accelstartval) != sign(m->accel_history[m->accel_idx])) { 
+				if (sign(traction->accelstartval) != sign(oldest_accel)) { 
 				// First we identify that the wheel has deccelerated due to traciton control, switching the sign
 					traction->highaccelon = false;				
 					traction_dbg->debug1 = rt->current_time - traction->timeron;
 				} else if (rt->current_time - traction->timeron > .21) {	// Time out at 210ms if wheel does not deccelerate
-					traction_dbg->debug4 = 210;
-					deactivate_traction(traction, state, rt, traction_dbg);
+					deactivate_traction(m, traction, state, rt, traction_dbg, TRACTION_EXIT_NO_DECEL);
 				}
-			} else if (sign(m->accel_history[m->accel_idx])!= sign(m->accel_history[m->last_accel_idx])) { 
+			} else if (sign(oldest_accel)!= sign(window_newest(&m->accel_history))) { 
 			// Next we check to see if accel direction changes again from outside forces 
-				traction_dbg->debug4 = 1; //m->accel_history[m->last_accel_idx];
-				deactivate_traction(traction, state, rt, traction_dbg);
+				deactivate_traction(m, traction, state, rt, traction_dbg, TRACTION_EXIT_ACCEL_DIRECTION);
 			}
 			
 			//This section determines if the wheel is acted on by outside forces by detecting acceleration magnitude
 			if (state->wheelslip) {		
 				if (sign(traction->accelstartval) * m->acceleration < traction->slowed_accel) {	
 				// First we identify that the wheel has deccelerated due to traciton control
-					traction_dbg->debug4 = 2;
-					deactivate_traction(traction, state, rt, traction_dbg);
+					deactivate_traction(m, traction, state, rt, traction_dbg, TRACTION_EXIT_ACCEL_SLOWED);
 				} else if ((rt->current_time - traction->timeron > .22) && 
 				   traction->highaccelon) {					// Time out at 220ms if wheel does not deccelerate
-					traction_dbg->debug4 = 220;
-					deactivate_traction(traction, state, rt, traction_dbg);
+					deactivate_traction(m, traction, state, rt, traction_dbg, TRACTION_EXIT_NO_DECEL_MAGNITUDE);
 				}
 			}
 
@@ -45,22 +42,21 @@ void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeD
 			if (traction->reverse_wheelslip && 
 			    m->erpm_sign == m->erpm_sign_soft && 
 			    state->wheelslip) {
-				traction_dbg->debug4 = 3;
-				deactivate_traction(traction, state, rt, traction_dbg);
+				deactivate_traction(m, traction, state, rt, traction_dbg, TRACTION_EXIT_REVERSE_RECOVERED);
 			}
 		}
 	}	
 	
-	if (m->erpm_sign == sign(m->erpm_history[m->last_erpm_idx])) { 	// We check sign to make sure erpm is increasing or has changed direction. 
-		if (m->abs_erpm > fabsf(m->erpm_history[m->last_erpm_idx])) {
+	if (m->erpm_sign == sign(accel_start_erpm)) { 	// We check sign to make sure erpm is increasing or has changed direction. 
+		if (m->abs_erpm > fabsf(accel_start_erpm)) {
 			start_condition1 = (sign(m->current) * m->acceleration > traction->start_accel * erpmfactor) &&	// The wheel has broken free indicated by abnormally high acceleration in the direction of motor current
-				(sign(m->current) == sign(m->accel_history[m->accel_idx])) &&				// a more precise condition than the first for current direction and erpm - last erpm
+				(sign(m->current) == sign(oldest_accel)) &&				// a more precise condition than the first for current direction and erpm - last erpm
 		   		(!state->braking_pos);									// Do not apply for braking 
 		} 				
-	} else if (sign(m->erpm_sign_soft) != sign(m->accel_history[m->accel_idx])) {	// The wheel has changed direction and if these are the same sign we do not want traciton conrol because we likely just landed with high wheel spin
+	} else if (sign(m->erpm_sign_soft) != sign(oldest_accel)) {	// The wheel has changed direction and if these are the same sign we do not want traciton conrol because we likely just landed with high wheel spin
 		traction->reverse_wheelslip = true;
 		start_condition1 = (sign(m->current) * m->acceleration > traction->start_accel * erpmfactor) &&	// The wheel has broken free indicated by abnormally high acceleration in the direction of motor current
-			(sign(m->current) == sign(m->accel_history[m->accel_idx])) &&				// a more precise condition than the first for current direction and erpm - last erpm
+			(sign(m->current) == sign(oldest_accel)) &&				// a more precise condition than the first for current direction and erpm - last erpm
 	   		(!state->braking_pos);									// Do not apply for braking 
 	}
 	
@@ -77,7 +73,8 @@ void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeD
 		traction_dbg->debug2 = erpmfactor;
 		traction_dbg->debug6 = m->acceleration / traction_dbg->freq_factor;
 		traction_dbg->debug9 = m->erpm;
-		traction_dbg->debug3 = m->erpm_history[m->last_erpm_idx];
+		traction_dbg->debug3 = accel_start_erpm;
+		traction_dbg->debug7 = window_peak_to_peak(&m->erpm_history);	// ERPM swing over the erpm window
 		traction_dbg->debug1 = 0;
 		traction_dbg->debug4 = 0;
 		traction_dbg->debug8 = 0;
@@ -86,6 +83,10 @@ void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeD
 			traction_dbg->debug5 = 0;
 		}
 		traction_dbg->debug5 += 1;
+
+		if (traction_dbg->recorder) {
+			traction_recorder_record(traction_dbg->recorder, m, rt->current_time, TRACTION_EVENT_START, TRACTION_EXIT_NONE, erpmfactor);
+		}
 	}
 }
 
@@ -94,15 +95,27 @@ void reset_traction(TractionData *traction, State *state) {
 	traction->reverse_wheelslip = false;
 }
 
-void deactivate_traction(TractionData *traction, State *state, RuntimeData *rt, TractionDebug *traction_dbg) {
+void deactivate_traction(MotorData *m, TractionData *traction, State *state, RuntimeData *rt, TractionDebug *traction_dbg, TractionExitReason reason) {
 	state->wheelslip = false;
 	traction->timeroff = rt->current_time;
 	traction->reverse_wheelslip = false;
+	traction_dbg->debug4 = reason;
 	traction_dbg->debug8 = traction->timeroff - traction->timeron;
+
+	if (traction_dbg->recorder) {
+		traction_recorder_record(traction_dbg->recorder, m, rt->current_time, TRACTION_EVENT_END, reason, traction_dbg->debug8);
+	}
 }
 
 void configure_traction(TractionData *traction, config *config, TractionDebug *traction_dbg){
 	traction->start_accel = 1000.0 * config->wheelslip_accelstart / config->hertz; //convert from erpm/ms to erpm/cycle
 	traction->slowed_accel = 1000.0 * config->wheelslip_accelend / config->hertz;
+	// erpmfactor = lerp(0, scaleerpm, scaleaccel, 1, abs_erpm), as base + slope * abs_erpm
+	traction->erpmfactor_base = config->wheelslip_scaleaccel;
+	if (config->wheelslip_scaleerpm == 0) {
+		traction->erpmfactor_slope = 0;
+	} else {
+		traction->erpmfactor_slope = (1.0 - config->wheelslip_scaleaccel) / config->wheelslip_scaleerpm;
+	}
 	traction_dbg->freq_factor = 1000.0 / config->hertz;
 }
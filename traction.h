@@ -2,6 +2,7 @@
 #include "motor_data.h"
 #include "state.h"
 #include "datatypes.h"
+#include "traction_recorder.h"
 
 typedef struct {
 	float timeron;       	 	//Timer from the start of wheelslip
@@ -13,6 +14,8 @@ typedef struct {
 	bool reverse_wheelslip; 	//Wheelslip in the braking position
 	float start_accel;		//acceleration that triggers wheelslip
 	float slowed_accel;		//Trigger that shows traction control is working
+	float erpmfactor_base;		//Start acceleration scale at 0 erpm
+	float erpmfactor_slope;		//Change of the start acceleration scale per erpm
 } TractionData;
 
 typedef struct {
@@ -27,9 +30,11 @@ typedef struct {
 	float debug9;
 	float aggregate_timer;
 	float freq_factor;
+	TractionRecorder *recorder;	//Optional flight recorder of activations and exits, NULL to disable
 } TractionDebug;
 
-void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeData *rt, config *config, TractionDebug *traction_dbg);
+void check_traction(MotorData *m, TractionData *traction, State *state, RuntimeData *rt, TractionDebug *traction_dbg);
 void reset_traction(TractionData *traction, State *state);
-void deactivate_traction(TractionData *traction, State *state, RuntimeData *rt, TractionDebug *traction_dbg);
+void deactivate_traction(MotorData *m, TractionData *traction, State *state, RuntimeData *rt, TractionDebug *traction_dbg, TractionExitReason reason);
+// Precomputes all the per-cycle constants from the config, check_traction() doesn't read it
 void configure_traction(TractionData *traction, config *config, TractionDebug *traction_dbg);
@@ -0,0 +1,129 @@
+#include "traction_recorder.h"
+
+#include "buffer.h"
+
+#include "vesc_c_if.h"
+
+#include <string.h>
+
+_Static_assert(
+    (TRACTION_RECORDER_EVENTS & (TRACTION_RECORDER_EVENTS - 1)) == 0,
+    "TRACTION_RECORDER_EVENTS has to be a power of two"
+);
+
+#define CHUNK_HEADER_SIZE 9
+#define EVENT_SIZE (4 + 1 + 2 + 4 * (2 + 3 * TRACTION_RECORDER_SAMPLES))
+#define DOWNLOAD_BUFFER_SIZE 500
+
+void traction_recorder_reset(TractionRecorder *rec) {
+    memset(rec, 0, sizeof(TractionRecorder));
+}
+
+void traction_recorder_record(
+    TractionRecorder *rec,
+    const MotorData *m,
+    float time,
+    TractionEventType type,
+    TractionExitReason reason,
+    float value
+) {
+    TractionEvent *e = &rec->events[rec->count & (TRACTION_RECORDER_EVENTS - 1)];
+
+    // The new seq goes in before the rest of the event is overwritten, so that
+    // a download copying the slot meanwhile sees it changed
+    __atomic_store_n(&e->seq, rec->count, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    e->time = time;
+    e->type = type;
+    e->reason = reason;
+    e->value = value;
+
+    for (int i = 0; i < TRACTION_RECORDER_SAMPLES; i++) {
+        uint8_t age = TRACTION_RECORDER_SAMPLES - 1 - i;
+        e->accel[i] = window_get(&m->accel_history, age);
+        e->erpm[i] = window_get(&m->erpm_history, age);
+        e->current[i] = window_get(&m->current_history, age);
+    }
+
+    __atomic_store_n(&rec->count, rec->count + 1, __ATOMIC_RELEASE);
+}
+
+// Copies the event @p seq, false if it isn't in the ring or was overwritten
+// while being copied
+static bool copy_event(const TractionRecorder *rec, uint32_t seq, TractionEvent *out) {
+    const TractionEvent *e = &rec->events[seq & (TRACTION_RECORDER_EVENTS - 1)];
+    if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != seq) {
+        return false;
+    }
+
+    memcpy(out, e, sizeof(TractionEvent));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&e->seq, __ATOMIC_RELAXED) == seq;
+}
+
+int32_t traction_recorder_read_chunk(
+    const TractionRecorder *rec, uint32_t from_seq, uint8_t *buffer, int32_t size
+) {
+    if (size < CHUNK_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint32_t count = __atomic_load_n(&rec->count, __ATOMIC_ACQUIRE);
+    uint32_t oldest = count > TRACTION_RECORDER_EVENTS ? count - TRACTION_RECORDER_EVENTS : 0;
+    if (from_seq < oldest) {
+        from_seq = oldest;
+    }
+
+    int32_t ind = 0;
+    buffer_append_uint32(buffer, count, &ind);
+    buffer_append_uint32(buffer, oldest, &ind);
+    int32_t count_ind = ind++;
+
+    uint8_t n = 0;
+    TractionEvent event;
+    const TractionEvent *e = &event;
+    for (uint32_t seq = from_seq; seq < count && ind + EVENT_SIZE <= size; ++seq) {
+        // The loop keeps recording, an event it overwrote is lost to the download
+        if (!copy_event(rec, seq, &event)) {
+            continue;
+        }
+
+        ++n;
+        buffer_append_uint32(buffer, e->seq, &ind);
+        buffer[ind++] = e->type;
+        buffer_append_uint16(buffer, e->reason, &ind);
+        buffer_append_float32_auto(buffer, e->time, &ind);
+        buffer_append_float32_auto(buffer, e->value, &ind);
+        for (int i = 0; i < TRACTION_RECORDER_SAMPLES; i++) {
+            buffer_append_float32_auto(buffer, e->accel[i], &ind);
+        }
+        for (int i = 0; i < TRACTION_RECORDER_SAMPLES; i++) {
+            buffer_append_float32_auto(buffer, e->erpm[i], &ind);
+        }
+        for (int i = 0; i < TRACTION_RECORDER_SAMPLES; i++) {
+            buffer_append_float32_auto(buffer, e->current[i], &ind);
+        }
+    }
+
+    buffer[count_ind] = n;
+    return ind;
+}
+
+void traction_recorder_cmd_download(
+    const TractionRecorder *rec, uint8_t magic, uint8_t command, unsigned char *cfg, int len
+) {
+    uint32_t from_seq = 0;
+    if (len >= 4) {
+        int32_t ind = 0;
+        from_seq = buffer_get_uint32(cfg, &ind);
+    }
+
+    uint8_t buffer[DOWNLOAD_BUFFER_SIZE];
+    int32_t ind = 0;
+    buffer[ind++] = magic;
+    buffer[ind++] = command;
+    ind += traction_recorder_read_chunk(rec, from_seq, buffer + ind, sizeof(buffer) - ind);
+
+    VESC_IF->send_app_data(buffer, ind);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "motor_data.h"
+
+#include <stdint.h>
+
+// Number of events kept, older ones get overwritten. Has to be a power of two.
+#ifndef TRACTION_RECORDER_EVENTS
+#define TRACTION_RECORDER_EVENTS 8
+#endif
+
+// Number of samples of each signal captured before the event
+#define TRACTION_RECORDER_SAMPLES ACCEL_ARRAY_SIZE
+
+typedef enum {
+    TRACTION_EVENT_START = 0,
+    TRACTION_EVENT_END = 1
+} TractionEventType;
+
+// Why traction control ended, the values are the ones historically reported
+// in TractionDebug.debug4.
+typedef enum {
+    TRACTION_EXIT_NONE = 0,
+    TRACTION_EXIT_ACCEL_DIRECTION = 1,  // acceleration changed direction again
+    TRACTION_EXIT_ACCEL_SLOWED = 2,  // acceleration dropped below wheelslip_accelend
+    TRACTION_EXIT_REVERSE_RECOVERED = 3,  // wheel travels forward again after reverse wheelslip
+    TRACTION_EXIT_NO_DECEL = 210,  // wheel didn't decelerate within 210ms
+    TRACTION_EXIT_NO_DECEL_MAGNITUDE = 220,  // acceleration magnitude didn't drop within 220ms
+    TRACTION_EXIT_TIMEOUT = 300  // traction control time limit of 300ms
+} TractionExitReason;
+
+typedef struct {
+    uint32_t seq;
+    float time;
+    uint8_t type;  // TractionEventType
+    uint16_t reason;  // TractionExitReason, TRACTION_EXIT_NONE for start events
+    // erpm factor the start condition was scaled by for start events,
+    // traction control duration for end events
+    float value;
+
+    // oldest sample first
+    float accel[TRACTION_RECORDER_SAMPLES];
+    float erpm[TRACTION_RECORDER_SAMPLES];
+    float current[TRACTION_RECORDER_SAMPLES];
+} TractionEvent;
+
+/**
+ * Flight recorder of traction control activations and exits, keeping the
+ * motor data history leading up to each of them in a preallocated ring.
+ */
+typedef struct {
+    TractionEvent events[TRACTION_RECORDER_EVENTS];
+    // total number of recorded events, the sequence number of the next one
+    uint32_t count;
+} TractionRecorder;
+
+void traction_recorder_reset(TractionRecorder *rec);
+
+void traction_recorder_record(
+    TractionRecorder *rec,
+    const MotorData *m,
+    float time,
+    TractionEventType type,
+    TractionExitReason reason,
+    float value
+);
+
+/**
+ * Serializes events starting from sequence number @p from_seq into @p buffer,
+ * as many as fit into @p size bytes. If @p from_seq was already overwritten,
+ * starts from the oldest event still held. Safe to call while the loop records,
+ * events it overwrites while they are being copied are left out.
+ *
+ * Layout: total count (uint32), oldest held seq (uint32), number of events in
+ * this chunk (uint8), then for each event: seq (uint32), type (uint8), reason
+ * (uint16), time, value and the accel, erpm and current samples (float32_auto
+ * each).
+ *
+ * @return Number of bytes written.
+ */
+int32_t traction_recorder_read_chunk(
+    const TractionRecorder *rec, uint32_t from_seq, uint8_t *buffer, int32_t size
+);
+
+/**
+ * Handles a chunked download request: @p cfg holds the sequence number to
+ * start from (uint32). Replies over app data with @p magic and @p command
+ * followed by a chunk from traction_recorder_read_chunk(). The client asks for
+ * the next chunk starting after the last seq it received, until a chunk
+ * comes back empty.
+ */
+void traction_recorder_cmd_download(
+    const TractionRecorder *rec, uint8_t magic, uint8_t command, unsigned char *cfg, int len
+);
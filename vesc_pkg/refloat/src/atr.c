@@ -22,6 +22,50 @@
 
 #include <math.h>
 
+// hard-code to 8A for now (shouldn't really be changed much anyways)
+#define TORQUE_OFFSET 8.0f
+
+// The accel_diff EMA {previous, new} coefficients above 0, 250, 1000 and 2000 erpm
+static const float accel_diff_ema[4][2] = {
+    {0.0f, 0.0f},
+    {0.98f, 0.02f},
+    {0.95f, 0.05f},
+    {0.9f, 0.1f},
+};
+
+static float knot_current(int k) {
+    return (k - (ATR_CURVE_KNOTS - 1) / 2) * ATR_CURVE_STEP;
+}
+
+// Expected acceleration is proportional to current, above 25A by a primitive
+// linear approximation of non-linear torque-accel relationship
+static float model_acc(float current, float accel_factor) {
+    float abs_torque = fabsf(current);
+    if (abs_torque < 25) {
+        return current / accel_factor;
+    }
+
+    int torque_sign = sign(current);
+    float acc = torque_sign * 25 / accel_factor;
+    return acc + torque_sign * (abs_torque - 25) / (accel_factor * 1.3f);
+}
+
+static void curve_compile(AtrCurve *curve, float accel_factor) {
+    for (int k = 0; k < ATR_CURVE_KNOTS; ++k) {
+        curve->acc[k] = model_acc(knot_current(k), accel_factor);
+    }
+    for (int k = 0; k < ATR_CURVE_KNOTS - 1; ++k) {
+        curve->slope[k] = (curve->acc[k + 1] - curve->acc[k]) / ATR_CURVE_STEP;
+    }
+    curve->offset_acc = TORQUE_OFFSET / accel_factor;
+}
+
+static float curve_lookup(const AtrCurve *curve, float current) {
+    float x = current * (1.0f / ATR_CURVE_STEP) + (ATR_CURVE_KNOTS - 1) / 2;
+    int k = fminf(fmaxf(x, 0.0f), ATR_CURVE_KNOTS - 2);
+    return curve->acc[k] + (current - knot_current(k)) * curve->slope[k];
+}
+
 void atr_reset(ATR *atr) {
     atr->accel_diff = 0;
     atr->speed_boost = 0;
@@ -48,32 +92,24 @@ void atr_configure(ATR *atr, const RefloatConfig *config) {
         // incorporate negative sign into braketilt factor instead of adding it each balance loop
         atr->braketilt_factor = -(0.5f + (20 - config->braketilt_strength) / 5.0f);
     }
+
+    curve_compile(&atr->curves[0], config->atr_amps_accel_ratio);
+    curve_compile(&atr->curves[1], config->atr_amps_decel_ratio);
 }
 
 static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *config) {
     float abs_torque = fabsf(motor->atr_filtered_current);
-    float torque_offset = 8;  // hard-code to 8A for now (shouldn't really be changed much anyways)
     float atr_threshold = motor->braking ? config->atr_threshold_down : config->atr_threshold_up;
-    float accel_factor =
-        motor->braking ? config->atr_amps_decel_ratio : config->atr_amps_accel_ratio;
-    float accel_factor2 = accel_factor * 1.3;
 
     // compare measured acceleration to expected acceleration
     float measured_acc = fmaxf(motor->acceleration, -5);
     measured_acc = fminf(measured_acc, 5);
 
-    // expected acceleration is proportional to current (minus an offset, required to
+    // expected acceleration of the current (minus an offset, required to
     // balance/maintain speed)
-    float expected_acc;
-    if (abs_torque < 25) {
-        expected_acc =
-            (motor->atr_filtered_current - motor->erpm_sign * torque_offset) / accel_factor;
-    } else {
-        // primitive linear approximation of non-linear torque-accel relationship
-        int torque_sign = sign(motor->atr_filtered_current);
-        expected_acc = (torque_sign * 25 - motor->erpm_sign * torque_offset) / accel_factor;
-        expected_acc += torque_sign * (abs_torque - 25) / accel_factor2;
-    }
+    const AtrCurve *curve = &atr->curves[motor->braking];
+    float expected_acc = curve_lookup(curve, motor->atr_filtered_current) -
+        motor->erpm_sign * curve->offset_acc;
 
     bool forward = motor->erpm > 0;
     if (motor->abs_erpm < 250 && abs_torque > 30) {
@@ -81,15 +117,9 @@ static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *co
     }
 
     float new_accel_diff = expected_acc - measured_acc;
-    if (motor->abs_erpm > 2000) {
-        atr->accel_diff = 0.9f * atr->accel_diff + 0.1f * new_accel_diff;
-    } else if (motor->abs_erpm > 1000) {
-        atr->accel_diff = 0.95f * atr->accel_diff + 0.05f * new_accel_diff;
-    } else if (motor->abs_erpm > 250) {
-        atr->accel_diff = 0.98f * atr->accel_diff + 0.02f * new_accel_diff;
-    } else {
-        atr->accel_diff = 0;
-    }
+    const float *ema = accel_diff_ema
+        [(motor->abs_erpm > 250) + (motor->abs_erpm > 1000) + (motor->abs_erpm > 2000)];
+    atr->accel_diff = ema[0] * atr->accel_diff + ema[1] * new_accel_diff;
 
     // atr->accel_diff | > 0  | <= 0
     // -------------+------+-------
@@ -21,11 +21,30 @@
 #include "conf/datatypes.h"
 #include "motor_data.h"
 
+// Knots of the expected acceleration curve, ATR_CURVE_STEP amps apart and
+// centered on 0 A
+#define ATR_CURVE_KNOTS 13
+#define ATR_CURVE_STEP 25.0f
+
+/**
+ * Expected acceleration over motor current, compiled in atr_configure() from
+ * the torque-to-acceleration model, though the knots could as well come from a
+ * measured torque curve. Linear between the knots, the end segments extend
+ * beyond them.
+ */
+typedef struct {
+    float acc[ATR_CURVE_KNOTS];
+    float slope[ATR_CURVE_KNOTS - 1];  // per amp, from knot k to k + 1
+    float offset_acc;  // the acceleration of the current needed to maintain speed
+} AtrCurve;
+
 // includes braketilt as well, at least for now
 typedef struct {
     float on_step_size;
     float off_step_size;
 
+    AtrCurve curves[2];  // accelerating, braking
+
     float accel_diff;
     float speed_boost;
 
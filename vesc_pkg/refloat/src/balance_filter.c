@@ -49,6 +49,59 @@ static float calculate_acc_confidence(float new_acc_mag, BalanceFilterData *data
     return confidence > 0 ? confidence : 0;
 }
 
+// atan on [-1, 1], max error about 1e-5 rad
+static inline float atan_poly(float z) {
+    float z2 = z * z;
+    return z *
+        (0.99986605f +
+         z2 * (-0.33029950f + z2 * (0.18014100f + z2 * (-0.08513300f + z2 * 0.02083510f))));
+}
+
+static float fast_atan2f(float y, float x) {
+    float abs_y = fabsf(y);
+    float abs_x = fabsf(x);
+    if (abs_x == 0 && abs_y == 0) {
+        return 0;
+    }
+
+    float res;
+    if (abs_y <= abs_x) {
+        res = atan_poly(abs_y / abs_x);
+    } else {
+        res = M_PI / 2 - atan_poly(abs_x / abs_y);
+    }
+
+    if (x < 0) {
+        res = M_PI - res;
+    }
+    return y < 0 ? -res : res;
+}
+
+static void extract_angles(BalanceFilterData *data) {
+    const float q0 = data->q0;
+    const float q1 = data->q1;
+    const float q2 = data->q2;
+    const float q3 = data->q3;
+
+    float roll_y = q0 * q1 + q2 * q3;
+    float roll_x = 0.5 - (q1 * q1 + q2 * q2);
+    float yaw_y = q0 * q3 + q1 * q2;
+    float yaw_x = 0.5 - (q2 * q2 + q3 * q3);
+    float sin_pitch = -2.0 * (q1 * q3 - q0 * q2);
+    sin_pitch = sin_pitch < -1 ? -1 : sin_pitch > 1 ? 1 : sin_pitch;
+
+    if (data->fast_trig) {
+        data->roll = -fast_atan2f(roll_y, roll_x);
+        // (1 - x) is exact close to the poles, unlike 1 - x * x
+        data->pitch = fast_atan2f(sin_pitch, sqrtf((1 - sin_pitch) * (1 + sin_pitch)));
+        data->yaw = -fast_atan2f(yaw_y, yaw_x);
+    } else {
+        data->roll = -atan2f(roll_y, roll_x);
+        data->pitch = asinf(sin_pitch);
+        data->yaw = -atan2f(yaw_y, yaw_x);
+    }
+}
+
 void balance_filter_init(BalanceFilterData *data) {
     // Init with internal filter orientation, otherwise the AHRS would need a while to stabilise
     float quat[4];
@@ -58,6 +111,8 @@ void balance_filter_init(BalanceFilterData *data) {
     data->q2 = quat[2];
     data->q3 = quat[3];
     data->acc_mag = 1.0;
+    data->fast_trig = BALANCE_FILTER_FAST_TRIG;
+    extract_angles(data);
 }
 
 void balance_filter_configure(BalanceFilterData *data, const RefloatConfig *config) {
@@ -131,34 +186,6 @@ void balance_filter_update(BalanceFilterData *data, float *gyro_xyz, float *acce
     data->q1 *= recip_norm;
     data->q2 *= recip_norm;
     data->q3 *= recip_norm;
-}
-
-float balance_filter_get_roll(BalanceFilterData *data) {
-    const float q0 = data->q0;
-    const float q1 = data->q1;
-    const float q2 = data->q2;
-    const float q3 = data->q3;
-
-    return -atan2f(q0 * q1 + q2 * q3, 0.5 - (q1 * q1 + q2 * q2));
-}
-
-float balance_filter_get_pitch(BalanceFilterData *data) {
-    float sin = -2.0 * (data->q1 * data->q3 - data->q0 * data->q2);
-
-    if (sin < -1) {
-        return -M_PI / 2;
-    } else if (sin > 1) {
-        return M_PI / 2;
-    }
-
-    return asinf(sin);
-}
-
-float balance_filter_get_yaw(BalanceFilterData *data) {
-    const float q0 = data->q0;
-    const float q1 = data->q1;
-    const float q2 = data->q2;
-    const float q3 = data->q3;
 
-    return -atan2f(q0 * q3 + q1 * q2, 0.5 - (q2 * q2 + q3 * q3));
+    extract_angles(data);
 }
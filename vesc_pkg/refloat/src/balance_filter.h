@@ -20,6 +20,15 @@
 
 #include "conf/datatypes.h"
 
+#include <stdbool.h>
+
+// Extract the angles with polynomial approximations of atan2 and asin instead
+// of libm, max error about 1e-5 rad (host/test_balance_filter.c). Define as 0
+// for libm.
+#ifndef BALANCE_FILTER_FAST_TRIG
+#define BALANCE_FILTER_FAST_TRIG 1
+#endif
+
 typedef struct {
     float q0;
     float q1;
@@ -27,6 +36,12 @@ typedef struct {
     float q3;
     float acc_mag;
 
+    // Euler angles of the quaternion, extracted once per update
+    float roll;
+    float pitch;
+    float yaw;
+    bool fast_trig;
+
     // parameters
     float acc_confidence_decay;
     float kp_pitch;
@@ -40,8 +55,16 @@ void balance_filter_configure(BalanceFilterData *data, const RefloatConfig *conf
 
 void balance_filter_update(BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt);
 
-float balance_filter_get_roll(BalanceFilterData *data);
-float balance_filter_get_pitch(BalanceFilterData *data);
-float balance_filter_get_yaw(BalanceFilterData *data);
+static inline float balance_filter_get_roll(const BalanceFilterData *data) {
+    return data->roll;
+}
+
+static inline float balance_filter_get_pitch(const BalanceFilterData *data) {
+    return data->pitch;
+}
+
+static inline float balance_filter_get_yaw(const BalanceFilterData *data) {
+    return data->yaw;
+}
 
 #endif
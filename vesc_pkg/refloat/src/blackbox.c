@@ -0,0 +1,262 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "blackbox.h"
+
+#include "conf/buffer.h"
+#include "utils.h"
+
+#include "vesc_c_if.h"
+
+#include <string.h>
+
+// Well within an app data packet and the stack of the command handler
+#define BLACKBOX_CHUNK_SIZE 256
+
+void blackbox_init(Blackbox *bb) {
+    memset(bb, 0, sizeof(Blackbox));
+}
+
+void blackbox_free(Blackbox *bb) {
+    bb->status = BLACKBOX_OFF;
+    if (bb->ring) {
+        VESC_IF->free(bb->ring);
+        bb->ring = NULL;
+    }
+}
+
+static uint8_t signal_count(uint8_t signals) {
+    uint8_t count = 0;
+    for (int i = 0; i < BLACKBOX_SIGNAL_COUNT; ++i) {
+        count += (signals >> i) & 1;
+    }
+    return count;
+}
+
+static void arm(Blackbox *bb, const BlackboxConfig *config) {
+    bb->config = *config;
+    bb->stride = 1 + signal_count(config->signals);
+    bb->capacity = BLACKBOX_WORDS / bb->stride;
+    if (bb->config.post_samples >= bb->capacity) {
+        bb->config.post_samples = bb->capacity - 1;
+    }
+
+    bb->head = 0;
+    bb->count = 0;
+    bb->trigger_count = 0;
+    bb->trigger = 0;
+    bb->last_time = VESC_IF->timer_time_now();
+    bb->status = config->signals ? BLACKBOX_RECORDING : BLACKBOX_OFF;
+}
+
+static void fire(Blackbox *bb, BlackboxTrigger trigger) {
+    bb->trigger = trigger;
+    bb->trigger_count = bb->count;
+    bb->remaining = bb->config.post_samples;
+    bb->status = BLACKBOX_TRIGGERED;
+}
+
+static void check_triggers(Blackbox *bb, const State *state) {
+    bool running = state->state == STATE_RUNNING;
+    bool stopped = bb->was_running && !running;
+    bool wheelslip = state->wheelslip && !bb->was_wheelslip;
+    bb->was_running = running;
+    bb->was_wheelslip = state->wheelslip;
+
+    uint8_t triggers = bb->config.triggers;
+    bool fault = false;
+    if (triggers & (1 << BLACKBOX_TRIGGER_FAULT)) {
+        bool is_fault = VESC_IF->mc_get_fault() != FAULT_CODE_NONE;
+        fault = is_fault && !bb->was_fault;
+        bb->was_fault = is_fault;
+    }
+
+    if (bb->status != BLACKBOX_RECORDING) {
+        return;
+    }
+
+    if (bb->trigger_pending) {
+        bb->trigger_pending = false;
+        fire(bb, BLACKBOX_TRIGGER_MANUAL);
+    } else if (stopped && state->stop_condition == STOP_PITCH &&
+               (triggers & (1 << BLACKBOX_TRIGGER_STOP_PITCH))) {
+        fire(bb, BLACKBOX_TRIGGER_STOP_PITCH);
+    } else if (stopped && (triggers & (1 << BLACKBOX_TRIGGER_STOP))) {
+        fire(bb, BLACKBOX_TRIGGER_STOP);
+    } else if (wheelslip && (triggers & (1 << BLACKBOX_TRIGGER_WHEELSLIP))) {
+        fire(bb, BLACKBOX_TRIGGER_WHEELSLIP);
+    } else if (fault) {
+        fire(bb, BLACKBOX_TRIGGER_FAULT);
+    }
+}
+
+void blackbox_record(Blackbox *bb, const BlackboxSample *sample, const State *state) {
+    if (__atomic_load_n(&bb->request_pending, __ATOMIC_ACQUIRE)) {
+        arm(bb, &bb->request);
+        bb->request_pending = false;
+    }
+
+    if (bb->status == BLACKBOX_OFF || bb->status == BLACKBOX_FROZEN) {
+        // A trigger request without a recording has nothing to freeze
+        bb->trigger_pending = false;
+        return;
+    }
+
+    uint32_t *slot = &bb->ring[bb->head * bb->stride];
+    uint32_t now = VESC_IF->timer_time_now();
+    float dt_us = VESC_IF->timer_seconds_elapsed_since(bb->last_time) * 1e6f;
+    bb->last_time = now;
+    *slot++ = dt_us;
+
+    for (int i = 0; i < BLACKBOX_STATE; ++i) {
+        if (bb->config.signals & (1 << i)) {
+            memcpy(slot++, &sample->values[i], sizeof(uint32_t));
+        }
+    }
+    if (bb->config.signals & (1 << BLACKBOX_STATE)) {
+        *slot = sample->state << 16 | sample->flags << 8 | sample->sat;
+    }
+
+    if (++bb->head == bb->capacity) {
+        bb->head = 0;
+    }
+    ++bb->count;
+
+    check_triggers(bb, state);
+
+    if (bb->status == BLACKBOX_TRIGGERED) {
+        if (bb->remaining == 0) {
+            // Release the samples to the command handler
+            __atomic_store_n(&bb->status, BLACKBOX_FROZEN, __ATOMIC_RELEASE);
+        } else {
+            --bb->remaining;
+        }
+    }
+}
+
+static uint16_t held_samples(const Blackbox *bb) {
+    return bb->count < bb->capacity ? bb->count : bb->capacity;
+}
+
+static int32_t append_sample(const Blackbox *bb, uint16_t index, uint8_t *buffer, int32_t ind) {
+    uint16_t oldest = bb->count < bb->capacity ? 0 : bb->head;
+    uint32_t position = oldest + index;
+    if (position >= bb->capacity) {
+        position -= bb->capacity;
+    }
+    const uint32_t *slot = &bb->ring[position * bb->stride];
+
+    uint32_t dt_us = *slot++;
+    buffer_append_uint16(buffer, dt_us < UINT16_MAX ? dt_us : UINT16_MAX, &ind);
+
+    for (int i = 0; i < BLACKBOX_STATE; ++i) {
+        if (bb->config.signals & (1 << i)) {
+            float value;
+            memcpy(&value, slot++, sizeof(float));
+            buffer_append_float32_auto(buffer, value, &ind);
+        }
+    }
+    if (bb->config.signals & (1 << BLACKBOX_STATE)) {
+        buffer[ind++] = *slot >> 16;
+        buffer[ind++] = *slot >> 8;
+        buffer[ind++] = *slot;
+    }
+
+    return ind;
+}
+
+void blackbox_cmd(Blackbox *bb, uint8_t magic, uint8_t command, uint8_t *cfg, int len) {
+    if (len < 1) {
+        log_error("Command data length incorrect: %u", len);
+        return;
+    }
+
+    int32_t ind = 0;
+    uint8_t subcommand = cfg[ind++];
+    switch (subcommand) {
+    case BLACKBOX_CMD_CONFIGURE: {
+        if (len < 5) {
+            log_error("Command data length incorrect: %u", len);
+            return;
+        }
+
+        BlackboxConfig *request = &bb->request;
+        request->signals = cfg[ind++] & ((1 << BLACKBOX_SIGNAL_COUNT) - 1);
+        request->triggers = cfg[ind++] & ((1 << BLACKBOX_TRIGGER_COUNT) - 1);
+        request->post_samples = buffer_get_uint16(cfg, &ind);
+
+        if (request->signals && !bb->ring) {
+            bb->ring = VESC_IF->malloc(BLACKBOX_WORDS * sizeof(uint32_t));
+            if (!bb->ring) {
+                log_error("Failed to allocate the blackbox: Out of memory.");
+                request->signals = 0;
+            }
+        }
+
+        // Also keeps status reads from seeing the previous recording
+        bb->status = BLACKBOX_OFF;
+        __atomic_store_n(&bb->request_pending, true, __ATOMIC_RELEASE);
+        break;
+    }
+    case BLACKBOX_CMD_TRIGGER:
+        bb->trigger_pending = true;
+        break;
+    case BLACKBOX_CMD_STATUS:
+    case BLACKBOX_CMD_READ:
+        break;
+    default:
+        log_error("Unknown blackbox command: %u", subcommand);
+        return;
+    }
+
+    BlackboxStatus status = __atomic_load_n(&bb->status, __ATOMIC_ACQUIRE);
+    bool frozen = status == BLACKBOX_FROZEN;
+
+    uint8_t buffer[BLACKBOX_CHUNK_SIZE];
+    int32_t send_ind = 0;
+    buffer[send_ind++] = magic;
+    buffer[send_ind++] = command;
+    buffer[send_ind++] = subcommand;
+    buffer[send_ind++] = status;
+    buffer[send_ind++] = frozen ? bb->trigger : 0;
+    buffer[send_ind++] = bb->config.signals;
+    buffer[send_ind++] = bb->config.triggers;
+    uint16_t held = 0;
+    uint16_t trigger_index = 0;
+    if (frozen) {
+        held = held_samples(bb);
+        trigger_index = held - 1 - (bb->count - bb->trigger_count);
+    }
+    buffer_append_uint16(buffer, held, &send_ind);
+    buffer_append_uint16(buffer, trigger_index, &send_ind);
+
+    if (subcommand == BLACKBOX_CMD_READ) {
+        uint16_t from = len >= 3 ? buffer_get_uint16(cfg, &ind) : 0;
+        buffer_append_uint16(buffer, from, &send_ind);
+        int32_t count_ind = send_ind++;
+
+        // time and the state bytes on top of the 4 byte signals
+        int32_t sample_size = 2 + 4 * (bb->stride - 1) +
+            ((bb->config.signals & (1 << BLACKBOX_STATE)) ? -1 : 0);
+        uint8_t count = 0;
+        while (from + count < held && send_ind + sample_size <= BLACKBOX_CHUNK_SIZE) {
+            send_ind = append_sample(bb, from + count, buffer, send_ind);
+            ++count;
+        }
+        buffer[count_ind] = count;
+    }
+
+    VESC_IF->send_app_data(buffer, send_ind);
+}
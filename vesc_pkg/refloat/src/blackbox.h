@@ -0,0 +1,145 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "state.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Size of the sample ring in 32-bit words, allocated when first armed. A
+// sample takes a word for its time plus one per recorded signal.
+#ifndef BLACKBOX_WORDS
+#define BLACKBOX_WORDS 2048
+#endif
+
+// Signals that can be recorded, the bit index in the signal mask
+typedef enum {
+    BLACKBOX_PITCH = 0,
+    BLACKBOX_BALANCE_PITCH,
+    BLACKBOX_SETPOINT,
+    BLACKBOX_PID_VALUE,
+    BLACKBOX_MOTOR_CURRENT,
+    BLACKBOX_ERPM,
+    BLACKBOX_STATE,  // 3 bytes, packed as TELEMETRY_STATE
+    BLACKBOX_SIGNAL_COUNT
+} BlackboxSignal;
+
+// Conditions that freeze the recording, the bit index in the trigger mask
+typedef enum {
+    BLACKBOX_TRIGGER_MANUAL = 0,  // always enabled, by BLACKBOX_CMD_TRIGGER
+    BLACKBOX_TRIGGER_STOP_PITCH,  // disengaged on STOP_PITCH
+    BLACKBOX_TRIGGER_STOP,  // disengaged on any stop condition
+    BLACKBOX_TRIGGER_WHEELSLIP,  // wheelslip detected
+    BLACKBOX_TRIGGER_FAULT,  // motor controller fault
+    BLACKBOX_TRIGGER_COUNT
+} BlackboxTrigger;
+
+typedef enum {
+    BLACKBOX_OFF = 0,
+    BLACKBOX_RECORDING,
+    BLACKBOX_TRIGGERED,  // recording the samples after the trigger
+    BLACKBOX_FROZEN,  // holds the samples around the trigger until re-armed
+} BlackboxStatus;
+
+typedef struct {
+    uint8_t signals;  // mask of BlackboxSignal
+    uint8_t triggers;  // mask of BlackboxTrigger
+    uint16_t post_samples;  // recorded after the trigger
+} BlackboxConfig;
+
+// One loop iteration's worth of the signals
+typedef struct {
+    float values[BLACKBOX_STATE];
+    uint8_t state, flags, sat;
+} BlackboxSample;
+
+/**
+ * Records the selected signals every loop iteration into a preallocated ring
+ * until a trigger fires, then keeps recording for post_samples more and
+ * freezes until re-armed, so that the ring holds what led to the event and
+ * what followed at the full loop rate.
+ *
+ * Only the loop writes into the ring. The command handler asks for changes
+ * through the request fields, which the loop adopts on its next iteration,
+ * and only reads the ring once frozen.
+ */
+typedef struct {
+    uint32_t *ring;
+    BlackboxConfig config;
+    uint8_t stride;  // words per sample
+    uint16_t capacity;  // samples
+    uint16_t head;  // next sample to write
+    volatile BlackboxStatus status;
+
+    uint32_t count;  // samples recorded since arming
+    uint32_t trigger_count;  // count when the trigger fired
+    uint16_t remaining;  // samples still to record after the trigger
+    volatile uint8_t trigger;  // BlackboxTrigger that fired
+    uint32_t last_time;
+
+    bool was_running;
+    bool was_wheelslip;
+    bool was_fault;
+
+    BlackboxConfig request;
+    volatile bool request_pending;
+    volatile bool trigger_pending;
+} Blackbox;
+
+void blackbox_init(Blackbox *bb);
+
+void blackbox_free(Blackbox *bb);
+
+static inline bool blackbox_active(const Blackbox *bb) {
+    return bb->status == BLACKBOX_RECORDING || bb->status == BLACKBOX_TRIGGERED ||
+        bb->request_pending || bb->trigger_pending;
+}
+
+/**
+ * Records a sample and checks the triggers against @p state. To be called from
+ * the loop, every iteration while blackbox_active().
+ */
+void blackbox_record(Blackbox *bb, const BlackboxSample *sample, const State *state);
+
+typedef enum {
+    BLACKBOX_CMD_CONFIGURE = 0,
+    BLACKBOX_CMD_STATUS = 1,
+    BLACKBOX_CMD_TRIGGER = 2,
+    BLACKBOX_CMD_READ = 3,
+} BlackboxCommand;
+
+/**
+ * Blackbox command, the first byte is the subcommand:
+ *
+ * BLACKBOX_CMD_CONFIGURE: signal mask (uint8), trigger mask (uint8) and the
+ * number of samples to record after the trigger (uint16). Starts a new
+ * recording, an empty signal mask turns the blackbox off.
+ * BLACKBOX_CMD_STATUS: no arguments.
+ * BLACKBOX_CMD_TRIGGER: freezes the recording as if a trigger fired.
+ * BLACKBOX_CMD_READ: index of the first sample (uint16), 0 being the oldest
+ * held one. Only returns samples once frozen.
+ *
+ * Response, to all of them: subcommand (uint8), status (uint8), the trigger
+ * that fired (uint8), signal mask (uint8), trigger mask (uint8), number of
+ * samples held (uint16) and the index of the trigger sample among them
+ * (uint16). BLACKBOX_CMD_READ continues with the index of the first sample
+ * (uint16), the number of samples in this chunk (uint8), then for every
+ * sample: microseconds since the previous one (uint16, saturated) and the
+ * selected signals in the order of BlackboxSignal, float32_auto each but
+ * BLACKBOX_STATE.
+ */
+void blackbox_cmd(Blackbox *bb, uint8_t magic, uint8_t command, uint8_t *cfg, int len);
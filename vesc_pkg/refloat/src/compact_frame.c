@@ -0,0 +1,134 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "compact_frame.h"
+
+#include <math.h>
+#include <string.h>
+
+// Keeps the difference of two fields within int32
+#define FIXED_LIMIT 1e9f
+
+void buffer_append_varint(uint8_t *buffer, uint32_t number, int32_t *index) {
+    while (number >= 0x80) {
+        buffer[(*index)++] = (number & 0x7F) | 0x80;
+        number >>= 7;
+    }
+    buffer[(*index)++] = number;
+}
+
+bool buffer_get_varint(const uint8_t *buffer, int32_t size, uint32_t *number, int32_t *index) {
+    uint32_t res = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*index >= size) {
+            return false;
+        }
+
+        uint8_t byte = buffer[(*index)++];
+        res |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *number = res;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int32_t to_fixed(float value, float scale) {
+    float fixed = value * scale;
+    if (!(fixed > -FIXED_LIMIT)) {
+        // also NaN
+        return -FIXED_LIMIT;
+    } else if (fixed > FIXED_LIMIT) {
+        return FIXED_LIMIT;
+    }
+    return lrintf(fixed);
+}
+
+void compact_frame_encoder_init(CompactFrameEncoder *e, uint8_t keyframe_interval) {
+    memset(e, 0, sizeof(CompactFrameEncoder));
+    e->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+}
+
+void compact_frame_encoder_reset(CompactFrameEncoder *e) {
+    e->field_count = 0;
+}
+
+int32_t compact_frame_encode(
+    CompactFrameEncoder *e, const float *values, const float *scales, uint8_t count, uint8_t *buffer
+) {
+    if (count > COMPACT_FRAME_MAX_FIELDS) {
+        count = COMPACT_FRAME_MAX_FIELDS;
+    }
+
+    bool keyframe = count != e->field_count || e->since_keyframe + 1 >= e->keyframe_interval;
+    e->since_keyframe = keyframe ? 0 : e->since_keyframe + 1;
+    e->field_count = count;
+
+    int32_t ind = 0;
+    buffer[ind++] = COMPACT_FRAME_VERSION << 4 | (keyframe ? COMPACT_FRAME_KEYFRAME : 0);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        int32_t fixed = to_fixed(values[i], scales[i]);
+        int32_t diff = keyframe ? fixed : fixed - e->previous[i];
+        buffer_append_varint(buffer, zigzag_encode(diff), &ind);
+        e->previous[i] = fixed;
+    }
+
+    return ind;
+}
+
+void compact_frame_decoder_reset(CompactFrameDecoder *d) {
+    d->field_count = 0;
+}
+
+CompactFrameResult compact_frame_decode(
+    CompactFrameDecoder *d,
+    const uint8_t *buffer,
+    int32_t size,
+    const float *scales,
+    uint8_t count,
+    float *values
+) {
+    if (size < 1 || count > COMPACT_FRAME_MAX_FIELDS || buffer[0] >> 4 != COMPACT_FRAME_VERSION) {
+        return COMPACT_FRAME_INVALID;
+    }
+
+    bool keyframe = buffer[0] & COMPACT_FRAME_KEYFRAME;
+    if (!keyframe && d->field_count != count) {
+        return COMPACT_FRAME_NEED_KEYFRAME;
+    }
+
+    int32_t fixed[COMPACT_FRAME_MAX_FIELDS];
+    int32_t ind = 1;
+    for (uint8_t i = 0; i < count; ++i) {
+        uint32_t varint;
+        if (!buffer_get_varint(buffer, size, &varint, &ind)) {
+            return COMPACT_FRAME_INVALID;
+        }
+
+        int32_t diff = zigzag_decode(varint);
+        // Wraps around instead of overflowing on garbage
+        fixed[i] = keyframe ? diff : (int32_t) ((uint32_t) d->previous[i] + (uint32_t) diff);
+    }
+
+    for (uint8_t i = 0; i < count; ++i) {
+        d->previous[i] = fixed[i];
+        values[i] = fixed[i] / scales[i];
+    }
+    d->field_count = count;
+
+    return COMPACT_FRAME_OK;
+}
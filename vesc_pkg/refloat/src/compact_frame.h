@@ -0,0 +1,109 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Compact encoding of a stream of frames of numeric fields. Every field is
+// sent as a fixed-point integer (the value times the field's scale), as a
+// zig-zag varint of its difference to the previous frame, so that slowly
+// changing fields take a single byte. Every keyframe_interval frames, and
+// whenever the encoder is reset, a keyframe carries the values themselves for
+// decoders to (re)synchronize on.
+//
+// Frame layout: header (uint8: version << 4 | flags), then a varint for each
+// field.
+
+#define COMPACT_FRAME_VERSION 1
+#define COMPACT_FRAME_MAX_FIELDS 32
+
+// Header flags
+#define COMPACT_FRAME_KEYFRAME 0x1
+
+// Worst case size of a frame of @p fields fields
+#define COMPACT_FRAME_MAX_SIZE(fields) (1 + 5 * (fields))
+
+typedef struct {
+    uint8_t keyframe_interval;
+    uint8_t since_keyframe;
+    uint8_t field_count;  // of the previous frame, 0 when there's none
+    int32_t previous[COMPACT_FRAME_MAX_FIELDS];
+} CompactFrameEncoder;
+
+typedef struct {
+    uint8_t field_count;  // of the previous frame, 0 when there's none
+    int32_t previous[COMPACT_FRAME_MAX_FIELDS];
+} CompactFrameDecoder;
+
+typedef enum {
+    COMPACT_FRAME_OK = 0,
+    COMPACT_FRAME_NEED_KEYFRAME,  // a delta frame without the frame it's based on
+    COMPACT_FRAME_INVALID,  // unknown version, truncated or too many fields
+} CompactFrameResult;
+
+void buffer_append_varint(uint8_t *buffer, uint32_t number, int32_t *index);
+
+/**
+ * Reads a varint from @p buffer of @p size bytes.
+ *
+ * @return false if the varint is truncated or longer than 5 bytes.
+ */
+bool buffer_get_varint(const uint8_t *buffer, int32_t size, uint32_t *number, int32_t *index);
+
+static inline uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value) {
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+void compact_frame_encoder_init(CompactFrameEncoder *e, uint8_t keyframe_interval);
+
+/**
+ * Makes the next frame a keyframe, for a new client to start from.
+ */
+void compact_frame_encoder_reset(CompactFrameEncoder *e);
+
+/**
+ * Encodes @p count fields from @p values with @p scales into @p buffer, which
+ * needs COMPACT_FRAME_MAX_SIZE(count) bytes. A change of the field count
+ * forces a keyframe.
+ *
+ * @return Number of bytes written.
+ */
+int32_t compact_frame_encode(
+    CompactFrameEncoder *e, const float *values, const float *scales, uint8_t count, uint8_t *buffer
+);
+
+/**
+ * Makes the decoder wait for a keyframe, to be called when frames were lost.
+ */
+void compact_frame_decoder_reset(CompactFrameDecoder *d);
+
+/**
+ * Decodes a frame of @p count fields from @p buffer of @p size bytes into
+ * @p values. On anything but COMPACT_FRAME_OK, @p values are left untouched.
+ */
+CompactFrameResult compact_frame_decode(
+    CompactFrameDecoder *d,
+    const uint8_t *buffer,
+    int32_t size,
+    const float *scales,
+    uint8_t count,
+    float *values
+);
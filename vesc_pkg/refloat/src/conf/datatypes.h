@@ -160,10 +160,15 @@ typedef struct {
     float kp2_brake;
     uint16_t kp_brake_erpm;
     uint16_t hertz;
+    bool loop_imu_sync;
     float fault_pitch;
     float fault_roll;
     float fault_adc1;
     float fault_adc2;
+    float fault_adc_hysteresis;
+    uint16_t fault_adc_filter;
+    uint16_t fault_delay_adc_engage;
+    uint16_t fault_delay_adc_release;
     uint16_t fault_delay_pitch;
     uint16_t fault_delay_roll;
     uint16_t fault_delay_switch_half;
@@ -0,0 +1,158 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "config_store.h"
+
+#include "vesc_c_if.h"
+
+#include "utils/utils.h"
+
+#include <string.h>
+
+enum {
+    VAR_MAGIC = 0,
+    VAR_SIGNATURE,
+    VAR_SIZE,
+    VAR_CRC,
+    VAR_IMAGE,
+};
+
+// The previous format had the image right after the signature
+#define VAR_LEGACY_IMAGE 1
+
+static uint32_t image_words(uint32_t size) {
+    return (size + 3) / 4;
+}
+
+// Word @p i of the image, zero-padded past its end
+static uint32_t image_word(const void *image, uint32_t size, uint32_t i) {
+    uint32_t word = 0;
+    uint32_t offset = i * 4;
+    memcpy(&word, (const uint8_t *) image + offset, size - offset < 4 ? size - offset : 4);
+    return word;
+}
+
+static bool read_image(void *image, uint32_t size, int address) {
+    for (uint32_t i = 0; i < image_words(size); ++i) {
+        eeprom_var v;
+        if (!VESC_IF->read_eeprom_var(&v, address + i)) {
+            return false;
+        }
+
+        uint32_t offset = i * 4;
+        memcpy((uint8_t *) image + offset, &v.as_u32, size - offset < 4 ? size - offset : 4);
+    }
+    return true;
+}
+
+ConfigStoreResult config_store_read(
+    void *image, uint32_t size, uint32_t signature, ConfigStoreHeader *header
+) {
+    eeprom_var v;
+    if (!VESC_IF->read_eeprom_var(&v, VAR_MAGIC)) {
+        return CONFIG_STORE_CORRUPT;
+    }
+
+    if (v.as_u32 == signature) {
+        return read_image(image, size, VAR_LEGACY_IMAGE) ? CONFIG_STORE_OK : CONFIG_STORE_CORRUPT;
+    } else if (v.as_u32 == 0 || v.as_u32 == UINT32_MAX) {
+        return CONFIG_STORE_EMPTY;
+    } else if (v.as_u32 != CONFIG_STORE_MAGIC) {
+        // Presumably a legacy image of another layout, there's no telling
+        // without a CRC
+        header->signature = v.as_u32;
+        header->size = 0;
+        header->crc = 0;
+        return CONFIG_STORE_OTHER_LAYOUT;
+    }
+
+    uint32_t fields[VAR_IMAGE];
+    for (int i = VAR_SIGNATURE; i < VAR_IMAGE; ++i) {
+        if (!VESC_IF->read_eeprom_var(&v, i)) {
+            return CONFIG_STORE_CORRUPT;
+        }
+        fields[i] = v.as_u32;
+    }
+    header->signature = fields[VAR_SIGNATURE];
+    header->size = fields[VAR_SIZE];
+    header->crc = fields[VAR_CRC];
+
+    if (header->signature != signature) {
+        return CONFIG_STORE_OTHER_LAYOUT;
+    }
+
+    if (header->size != size || !read_image(image, size, VAR_IMAGE) ||
+        utils_crc32c(image, size) != header->crc) {
+        return CONFIG_STORE_CORRUPT;
+    }
+
+    return CONFIG_STORE_OK;
+}
+
+ConfigStoreResult config_store_read_layout(
+    void *image, uint32_t size, const ConfigStoreHeader *header
+) {
+    if (header->size == 0 || header->size != size || !read_image(image, size, VAR_IMAGE) ||
+        utils_crc32c(image, size) != header->crc) {
+        return CONFIG_STORE_CORRUPT;
+    }
+
+    return CONFIG_STORE_OK;
+}
+
+// Stores @p value unless the variable already holds it, counting the writes
+static bool store_changed(uint32_t value, int address, int32_t *written) {
+    eeprom_var v;
+    if (VESC_IF->read_eeprom_var(&v, address) && v.as_u32 == value) {
+        return true;
+    }
+
+    v.as_u32 = value;
+    ++*written;
+    return VESC_IF->store_eeprom_var(&v, address);
+}
+
+int32_t config_store_write(const void *image, uint32_t size, uint32_t signature) {
+    int32_t written = 0;
+
+    // The image overlaps a legacy one, which has no CRC to catch an
+    // interrupted write, invalidate it first
+    eeprom_var v;
+    if (VESC_IF->read_eeprom_var(&v, VAR_MAGIC) && v.as_u32 != CONFIG_STORE_MAGIC &&
+        !store_changed(0, VAR_MAGIC, &written)) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < image_words(size); ++i) {
+        if (!store_changed(image_word(image, size, i), VAR_IMAGE + i, &written)) {
+            return -1;
+        }
+    }
+
+    // utils_crc32c doesn't take a const pointer, but only reads
+    uint32_t header[VAR_IMAGE] = {
+        [VAR_MAGIC] = CONFIG_STORE_MAGIC,
+        [VAR_SIGNATURE] = signature,
+        [VAR_SIZE] = size,
+        [VAR_CRC] = utils_crc32c((uint8_t *) image, size),
+    };
+    for (int i = VAR_IMAGE - 1; i >= VAR_MAGIC; --i) {
+        if (!store_changed(header[i], i, &written)) {
+            return -1;
+        }
+    }
+
+    return written;
+}
@@ -0,0 +1,75 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+// Persistence of the config image in the custom EEPROM variables.
+//
+// Layout: magic (uint32, "RFC" and the format version in the low byte), the
+// config layout signature, the image size in bytes and the CRC32C of the
+// image, then the image itself, one variable per 32-bit word.
+//
+// The previous format, the signature followed directly by the image without a
+// CRC, is still read.
+
+#define CONFIG_STORE_FORMAT 1
+#define CONFIG_STORE_MAGIC (0x52464300 | CONFIG_STORE_FORMAT)
+
+typedef struct {
+    uint32_t signature;
+    uint32_t size;
+    uint32_t crc;
+} ConfigStoreHeader;
+
+typedef enum {
+    CONFIG_STORE_OK = 0,
+    CONFIG_STORE_EMPTY,  // nothing stored
+    CONFIG_STORE_CORRUPT,  // failed to read, or the CRC doesn't match
+    // Of a different config layout, intact unless in the previous format
+    CONFIG_STORE_OTHER_LAYOUT,
+} ConfigStoreResult;
+
+/**
+ * Reads the image of @p size bytes and layout @p signature into @p image. On
+ * anything but CONFIG_STORE_OK, @p image may have been partially overwritten.
+ *
+ * @param header Filled in with the stored header on CONFIG_STORE_OTHER_LAYOUT,
+ *               to tell which layout to migrate from. An image in the previous
+ *               format only has a signature, its size and CRC are 0.
+ */
+ConfigStoreResult config_store_read(
+    void *image, uint32_t size, uint32_t signature, ConfigStoreHeader *header
+);
+
+/**
+ * Reads an image of another layout, as described by @p header from
+ * config_store_read(), for migrating it. @p size is the size of that layout,
+ * which has to match the stored one. Images in the previous format have no
+ * size to check them by and are reported as CONFIG_STORE_CORRUPT.
+ */
+ConfigStoreResult config_store_read_layout(
+    void *image, uint32_t size, const ConfigStoreHeader *header
+);
+
+/**
+ * Stores the image, writing only the variables that differ from what's
+ * already stored. The header goes last, so that an interrupted write fails the
+ * CRC check instead of loading a mix of two configs.
+ *
+ * @return Number of variables written, -1 if writing failed.
+ */
+int32_t config_store_write(const void *image, uint32_t size, uint32_t signature);
@@ -19,35 +19,131 @@
 
 #include "vesc_c_if.h"
 
-void footpad_sensor_update(FootpadSensor *fs, const RefloatConfig *config) {
-    fs->adc1 = VESC_IF->io_read_analog(VESC_PIN_ADC1);
-    // Returns -1.0 if the pin is missing on the hardware
-    fs->adc2 = VESC_IF->io_read_analog(VESC_PIN_ADC2);
-    if (fs->adc2 < 0.0) {
-        fs->adc2 = 0.0;
+#include <math.h>
+
+static float median3(const float *w) {
+    float lo = fminf(w[0], w[1]);
+    float hi = fmaxf(w[0], w[1]);
+    return fmaxf(lo, fminf(hi, w[2]));
+}
+
+static void channel_configure(FootpadChannel *ch, float threshold, float hysteresis) {
+    ch->threshold_on = threshold;
+    ch->threshold_off = fmaxf(threshold - hysteresis, 0.0f);
+}
+
+static void channel_filter(FootpadChannel *ch, float reading, float alpha) {
+    ch->window[ch->window_pos] = reading;
+    ch->window_pos = ch->window_pos == 2 ? 0 : ch->window_pos + 1;
+    ch->value += alpha * (median3(ch->window) - ch->value);
+}
+
+static void channel_debounce(FootpadChannel *ch, const FootpadSensor *fs, float time) {
+    bool pressed = ch->value > (ch->pressed ? ch->threshold_off : ch->threshold_on);
+    if (pressed == ch->pressed) {
+        ch->pending = false;
+        return;
+    }
+
+    if (!ch->pending) {
+        ch->pending = true;
+        ch->pending_time = time;
+    }
+
+    float delay = pressed ? fs->engage_delay : fs->release_delay;
+    if (time - ch->pending_time >= delay) {
+        ch->pressed = pressed;
+        ch->pending = false;
+        ch->change_time = time;
     }
+}
+
+static void channel_prime(FootpadChannel *ch, float reading, float time) {
+    ch->window[0] = ch->window[1] = ch->window[2] = reading;
+    ch->window_pos = 0;
+    ch->value = reading;
+    ch->pressed = reading > ch->threshold_on;
+    ch->pending = false;
+    ch->change_time = time;
+}
+
+void footpad_sensor_init(FootpadSensor *fs) {
+    fs->adc1 = 0.0f;
+    fs->adc2 = 0.0f;
+    fs->state = FS_NONE;
+    fs->primed = false;
+    fs->alpha = 1.0f;
+    fs->engage_delay = 0.0f;
+    fs->release_delay = 0.0f;
+    channel_configure(&fs->channels[0], 0.0f, 0.0f);
+    channel_configure(&fs->channels[1], 0.0f, 0.0f);
+}
+
+void footpad_sensor_configure(FootpadSensor *fs, const RefloatConfig *config) {
+    channel_configure(&fs->channels[0], config->fault_adc1, config->fault_adc_hysteresis);
+    channel_configure(&fs->channels[1], config->fault_adc2, config->fault_adc_hysteresis);
+
+    fs->alpha = 1.0f;
+    if (config->fault_adc_filter > 0) {
+        fs->alpha = 1.0f - expf(-1000.0f / (config->fault_adc_filter * config->hertz));
+    }
+
+    fs->engage_delay = config->fault_delay_adc_engage / 1000.0f;
+    fs->release_delay = config->fault_delay_adc_release / 1000.0f;
+}
+
+static float read_adc(VESC_PIN pin) {
+    float sum = 0.0f;
+    for (int i = 0; i < FOOTPAD_SENSOR_OVERSAMPLING; ++i) {
+        // Returns -1.0 if the pin is missing on the hardware
+        sum += fmaxf(VESC_IF->io_read_analog(pin), 0.0f);
+    }
+    return sum / FOOTPAD_SENSOR_OVERSAMPLING;
+}
+
+void footpad_sensor_update(FootpadSensor *fs, float time) {
+    footpad_sensor_filter(fs, read_adc(VESC_PIN_ADC1), read_adc(VESC_PIN_ADC2), time);
+}
+
+void footpad_sensor_filter(FootpadSensor *fs, float adc1, float adc2, float time) {
+    FootpadChannel *ch1 = &fs->channels[0];
+    FootpadChannel *ch2 = &fs->channels[1];
+
+    if (fs->primed) {
+        channel_filter(ch1, adc1, fs->alpha);
+        channel_filter(ch2, adc2, fs->alpha);
+        channel_debounce(ch1, fs, time);
+        channel_debounce(ch2, fs, time);
+    } else {
+        channel_prime(ch1, adc1, time);
+        channel_prime(ch2, adc2, time);
+        fs->primed = true;
+    }
+
+    fs->adc1 = ch1->value;
+    fs->adc2 = ch2->value;
 
     fs->state = FS_NONE;
 
-    if (config->fault_adc1 == 0 && config->fault_adc2 == 0) {  // No sensors
+    if (ch1->threshold_on == 0 && ch2->threshold_on == 0) {  // No sensors
         fs->state = FS_BOTH;
-    } else if (config->fault_adc2 == 0) {  // Single sensor on ADC1
-        if (fs->adc1 > config->fault_adc1) {
+    } else if (ch2->threshold_on == 0) {  // Single sensor on ADC1
+        if (ch1->pressed) {
             fs->state = FS_BOTH;
         }
-    } else if (config->fault_adc1 == 0) {  // Single sensor on ADC2
-        if (fs->adc2 > config->fault_adc2) {
+    } else if (ch1->threshold_on == 0) {  // Single sensor on ADC2
+        if (ch2->pressed) {
             fs->state = FS_BOTH;
         }
     } else {  // Double sensor
-        if (fs->adc1 > config->fault_adc1) {
-            if (fs->adc2 > config->fault_adc2) {
+        if (ch1->pressed) {
+            if (ch2->pressed) {
                 fs->state = FS_BOTH;
             } else {
                 fs->state = FS_LEFT;
             }
         } else {
-            if (fs->adc2 > config->fault_adc2) {
+            if (ch2->pressed) {
                 fs->state = FS_RIGHT;
             }
         }
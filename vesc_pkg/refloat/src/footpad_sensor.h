@@ -19,6 +19,15 @@
 
 #include "conf/datatypes.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
+// ADC reads averaged per loop iteration. The ADCs are sampled by DMA, reads in
+// quick succession mostly return the same conversion.
+#ifndef FOOTPAD_SENSOR_OVERSAMPLING
+#define FOOTPAD_SENSOR_OVERSAMPLING 1
+#endif
+
 typedef enum {
     FS_NONE = 0,
     FS_LEFT = 1,
@@ -27,10 +36,50 @@ typedef enum {
 } FootpadSensorState;
 
 typedef struct {
-    float adc1, adc2;
+    float window[3];  // the last three readings, for the median
+    uint8_t window_pos;
+    float value;  // median, then EMA filtered
+
+    float threshold_on;  // 0 for a disabled sensor
+    float threshold_off;
+
+    bool pressed;  // the debounced state
+    bool pending;  // value has been across the threshold since pending_time
+    float pending_time;
+    float change_time;  // of the last debounced transition
+} FootpadChannel;
+
+/**
+ * Filters the footpad sensor voltages and debounces their state. Per channel,
+ * the median of the last three readings goes through an EMA, then through a
+ * hysteresis band below the switch voltage. A change of the result has to
+ * hold for the engage or release delay before it changes the state.
+ */
+typedef struct {
+    float adc1, adc2;  // filtered
     FootpadSensorState state;
+
+    FootpadChannel channels[2];
+    bool primed;
+    float alpha;
+    float engage_delay;
+    float release_delay;
 } FootpadSensor;
 
-void footpad_sensor_update(FootpadSensor *fs, const RefloatConfig *config);
+void footpad_sensor_init(FootpadSensor *fs);
+
+void footpad_sensor_configure(FootpadSensor *fs, const RefloatConfig *config);
+
+/**
+ * Reads the ADCs and runs footpad_sensor_filter() on them.
+ */
+void footpad_sensor_update(FootpadSensor *fs, float time);
+
+/**
+ * Updates the state from a reading of @p adc1 and @p adc2 (V) at @p time (s),
+ * once per loop iteration. Doesn't touch the hardware, so it can run on
+ * recorded readings.
+ */
+void footpad_sensor_filter(FootpadSensor *fs, float adc1, float adc2, float time);
 
 int footpad_sensor_state_to_switch_compat(FootpadSensorState v);
@@ -0,0 +1,231 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "imu_sync.h"
+
+#include "conf/buffer.h"
+#include "utils.h"
+
+#include "vesc_c_if.h"
+
+#include <math.h>
+#include <string.h>
+
+// The thread sleeps until this long before the expected sample and then polls
+// once per system tick (100us on the VESC), which bounds the latency.
+#define IMU_SYNC_GUARD_US 100
+#define IMU_SYNC_POLL_US 50
+
+// Samples to measure the IMU rate over, and how far n sample periods can be
+// from the loop time for the loop to still run at 1/n of the IMU rate
+#define IMU_SYNC_RATE_SAMPLES 200
+#define IMU_SYNC_RATE_TOLERANCE 0.02f
+
+// Number of samples completely signalled so far
+static inline uint32_t samples(const ImuSync *s) {
+    return __atomic_load_n(&s->imu_seq, __ATOMIC_ACQUIRE) >> 1;
+}
+
+/**
+ * Reads the time of the latest sample consistently with its number, retrying
+ * while the callback is writing them. Sleeps on an odd sequence, in case the
+ * loop preempted the callback halfway through.
+ */
+static uint32_t read_sample(const ImuSync *s, uint32_t *time) {
+    while (true) {
+        uint32_t seq = __atomic_load_n(&s->imu_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            VESC_IF->sleep_us(1);
+            continue;
+        }
+
+        *time = s->imu_time;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq == __atomic_load_n(&s->imu_seq, __ATOMIC_RELAXED)) {
+            return seq >> 1;
+        }
+    }
+}
+
+void imu_sync_init(ImuSync *s) {
+    memset(s, 0, sizeof(ImuSync));
+    imu_sync_reset_stats(s);
+}
+
+void imu_sync_configure(ImuSync *s, bool synchronized, float hertz) {
+    s->synchronized = synchronized;
+    s->loop_time_us = 1e6 / hertz;
+    s->loop_time_s = 1.0f / hertz;
+    s->consumed_seq = samples(s);
+    s->rate_checked = false;
+    s->rate_mismatch = false;
+    s->rate_seq = 0;
+    imu_sync_reset_stats(s);
+}
+
+void imu_sync_signal(ImuSync *s, float dt) {
+    // Single writer: an odd imu_seq tells the loop the time and dt are being
+    // written, the release orders it before them and them before the even one
+    uint32_t seq = s->imu_seq;
+    __atomic_store_n(&s->imu_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->imu_time = VESC_IF->timer_time_now();
+    s->imu_dt = dt;
+    __atomic_store_n(&s->imu_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void imu_sync_reset_stats(ImuSync *s) {
+    s->iterations = 0;
+    s->timeouts = 0;
+    s->skipped = 0;
+    s->period_min = INFINITY;
+    s->period_max = 0;
+    s->period_sum = 0;
+    s->latency_max = 0;
+    s->latency_sum = 0;
+    s->iteration_time = 0;
+}
+
+static uint32_t decimation(const ImuSync *s, float dt) {
+    if (dt <= 0) {
+        return 1;
+    }
+
+    uint32_t n = lroundf(s->loop_time_s / dt);
+    return n > 0 ? n : 1;
+}
+
+// Measures the IMU rate from the samples the loop ran on, the sample period
+// the callback passes jitters too much to tell 800Hz from 832Hz
+static void check_rate(ImuSync *s) {
+    if (s->rate_checked || !s->synchronized || s->consumed_seq == 0) {
+        return;
+    }
+
+    if (s->rate_seq == 0) {
+        s->rate_seq = s->consumed_seq;
+        s->rate_time = s->consumed_time;
+        return;
+    }
+
+    uint32_t count = s->consumed_seq - s->rate_seq;
+    if (count < IMU_SYNC_RATE_SAMPLES) {
+        return;
+    }
+
+    float dt = (VESC_IF->timer_seconds_elapsed_since(s->rate_time) -
+                VESC_IF->timer_seconds_elapsed_since(s->consumed_time)) /
+        count;
+    uint32_t n = decimation(s, dt);
+    s->rate_checked = true;
+    s->rate_mismatch = fabsf(n * dt - s->loop_time_s) > IMU_SYNC_RATE_TOLERANCE * s->loop_time_s;
+    if (s->rate_mismatch) {
+        log_error(
+            "Loop Hertz %d is not the IMU rate %d or a fraction of it, not synchronizing.",
+            (int) lroundf(1 / s->loop_time_s),
+            (int) lroundf(1 / dt)
+        );
+    }
+}
+
+void imu_sync_iteration_start(ImuSync *s) {
+    if (__atomic_load_n(&s->reset_pending, __ATOMIC_ACQUIRE)) {
+        imu_sync_reset_stats(s);
+        s->reset_pending = false;
+    }
+
+    uint32_t sample_time;
+    uint32_t seq = read_sample(s, &sample_time);
+
+    uint32_t now = VESC_IF->timer_time_now();
+
+    if (s->iterations > 0) {
+        float period = VESC_IF->timer_seconds_elapsed_since(s->iteration_time);
+        s->period_sum += period;
+        s->period_min = fminf(s->period_min, period);
+        s->period_max = fmaxf(s->period_max, period);
+    }
+    s->iteration_time = now;
+
+    if (seq != 0) {
+        float latency = VESC_IF->timer_seconds_elapsed_since(sample_time);
+        s->latency_sum += latency;
+        s->latency_max = fmaxf(s->latency_max, latency);
+    }
+
+    s->consumed_seq = seq;
+    s->consumed_time = sample_time;
+    ++s->iterations;
+
+    check_rate(s);
+}
+
+void imu_sync_wait(ImuSync *s) {
+    // Until the first sample comes in there's nothing to synchronize to
+    if (!s->synchronized || s->rate_mismatch || samples(s) == 0) {
+        VESC_IF->sleep_us(s->loop_time_us);
+        return;
+    }
+
+    uint32_t n = decimation(s, s->imu_dt);
+    uint32_t target = s->consumed_seq + n;
+
+    // Sleep through most of the wait, until shortly before the sample is due
+    float due = n * s->imu_dt - VESC_IF->timer_seconds_elapsed_since(s->consumed_time);
+    int32_t sleep_us = due * 1e6f - IMU_SYNC_GUARD_US;
+    if (sleep_us > 0 && (uint32_t) sleep_us < 2 * s->loop_time_us) {
+        VESC_IF->sleep_us(sleep_us);
+    }
+
+    while ((int32_t) (samples(s) - target) < 0) {
+        if (VESC_IF->timer_seconds_elapsed_since(s->iteration_time) > 2 * s->loop_time_s) {
+            ++s->timeouts;
+            return;
+        }
+        VESC_IF->sleep_us(IMU_SYNC_POLL_US);
+    }
+
+    uint32_t missed = samples(s) - target;
+    s->skipped += missed;
+}
+
+void imu_sync_cmd_stats(ImuSync *s, uint8_t magic, uint8_t command, uint8_t *cfg, int len) {
+    uint8_t buffer[40];
+    int32_t ind = 0;
+
+    uint32_t periods = s->iterations > 1 ? s->iterations - 1 : 0;
+    float imu_dt = s->imu_dt;
+
+    buffer[ind++] = magic;
+    buffer[ind++] = command;
+    buffer[ind++] = s->synchronized && !s->rate_mismatch;
+    buffer_append_uint32(buffer, s->iterations, &ind);
+    buffer_append_uint32(buffer, s->timeouts, &ind);
+    buffer_append_uint32(buffer, s->skipped, &ind);
+    buffer_append_float32_auto(buffer, imu_dt > 0 ? 1.0f / imu_dt : 0, &ind);
+    buffer_append_float32_auto(buffer, periods ? 1e6f * s->period_sum / periods : 0, &ind);
+    buffer_append_float32_auto(buffer, periods ? 1e6f * s->period_min : 0, &ind);
+    buffer_append_float32_auto(buffer, 1e6f * s->period_max, &ind);
+    buffer_append_float32_auto(
+        buffer, s->iterations ? 1e6f * s->latency_sum / s->iterations : 0, &ind
+    );
+    buffer_append_float32_auto(buffer, 1e6f * s->latency_max, &ind);
+
+    VESC_IF->send_app_data(buffer, ind);
+
+    if (len >= 1 && cfg[0]) {
+        __atomic_store_n(&s->reset_pending, true, __ATOMIC_RELEASE);
+    }
+}
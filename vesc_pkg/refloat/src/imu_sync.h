@@ -0,0 +1,101 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Paces the control loop, either by sleeping for the loop time or, in the
+ * synchronized mode, by waiting for fresh samples signalled from the IMU read
+ * callback. In both modes measures the loop period and the age of the IMU
+ * sample each iteration runs on, for the jitter report.
+ */
+typedef struct {
+    bool synchronized;
+    uint32_t loop_time_us;
+    float loop_time_s;
+
+    // The IMU rate measured over the first samples after configuring, the
+    // loop falls back to sleeping if it isn't a multiple of the loop frequency
+    bool rate_checked;
+    bool rate_mismatch;
+    uint32_t rate_seq;
+    uint32_t rate_time;
+
+    // Written by the IMU callback only. imu_seq is a sequence lock over the
+    // sample time and dt: odd while the callback writes them, advanced by two
+    // per sample, so half of it counts the samples.
+    volatile uint32_t imu_seq;
+    volatile uint32_t imu_time;
+    volatile float imu_dt;
+
+    // Loop side, consumed_seq counts samples
+    uint32_t consumed_seq;
+    uint32_t consumed_time;
+    uint32_t iteration_time;
+
+    // Jitter report
+    uint32_t iterations;
+    uint32_t timeouts;  // synchronized iterations that ran without a fresh IMU sample
+    uint32_t skipped;  // IMU samples no iteration ran on beyond the decimation
+    float period_min, period_max, period_sum;
+    float latency_max, latency_sum;
+    // Set by the command handler, the loop resets the report at the start of
+    // its next iteration
+    volatile bool reset_pending;
+} ImuSync;
+
+void imu_sync_init(ImuSync *s);
+
+/**
+ * The synchronized mode needs @p hertz to be the IMU rate or an integer
+ * fraction of it. Once the IMU rate is measured, the loop logs an error and
+ * falls back to sleeping for the loop time if it isn't.
+ */
+void imu_sync_configure(ImuSync *s, bool synchronized, float hertz);
+
+/**
+ * To be called from the IMU read callback, after the sample was consumed.
+ */
+void imu_sync_signal(ImuSync *s, float dt);
+
+/**
+ * To be called at the start of every loop iteration, updates the jitter
+ * statistics and resets them if requested.
+ */
+void imu_sync_iteration_start(ImuSync *s);
+
+/**
+ * Waits for the next iteration: the loop time in the sleeping mode, the next
+ * IMU sample (or every n-th one when the loop frequency is 1/n of the IMU
+ * rate) in the synchronized mode. If no sample comes in within two loop
+ * times, returns anyway so the loop keeps running without the IMU.
+ */
+void imu_sync_wait(ImuSync *s);
+
+void imu_sync_reset_stats(ImuSync *s);
+
+/**
+ * Command reporting the loop jitter statistics.
+ *
+ * Request: optional flag (uint8) to reset the statistics after reading them.
+ * Response: synchronized (uint8, 0 also after falling back on a mismatched
+ * IMU rate), iterations, timeouts, skipped IMU samples
+ * (uint32), IMU rate in Hz, mean, min and max loop period, mean and max IMU
+ * sample age at iteration start, all times in microseconds (float32_auto).
+ */
+void imu_sync_cmd_stats(ImuSync *s, uint8_t magic, uint8_t command, uint8_t *cfg, int len);
@@ -0,0 +1,113 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "led_anim.h"
+
+#include <math.h>
+
+// Keyframes of the rising half of the progress, (1 - cos(t * pi)) / 2 by the
+// Bhaskara approximation, which is 2.5 * t^2 / (t^2 + 1) up to t = 0.5 and
+// symmetric around it, in Q15
+#define PROGRESS_KEYFRAME_BITS 6
+#define PROGRESS_KEYFRAMES (1 << PROGRESS_KEYFRAME_BITS)
+#define PROGRESS_SHIFT (15 - PROGRESS_KEYFRAME_BITS)
+
+#define T(k) ((k) / (float) PROGRESS_KEYFRAMES)
+#define U(k) (1.0f - T(k))
+#define B(t) (2.5f * (t) * (t) / ((t) * (t) + 1.0f))
+#define P(k)                                                                                       \
+    (uint16_t) (32768.0f * ((k) <= PROGRESS_KEYFRAMES / 2 ? B(T(k)) : 1.0f - B(U(k))) + 0.5f)
+#define P4(k) P(k), P(k + 1), P(k + 2), P(k + 3)
+#define P16(k) P4(k), P4(k + 4), P4(k + 8), P4(k + 12)
+
+static const uint16_t progress_keyframes[PROGRESS_KEYFRAMES + 1] = {
+    P16(0), P16(16), P16(32), P16(48), P(64)
+};
+
+// Q8 position of a length or coordinate in LEDs
+static int32_t to_position(float leds) {
+    return lroundf(leds * LED_ANIM_ONE);
+}
+
+static int32_t reciprocal(int32_t size) {
+    return (LED_ANIM_ONE * 65536 + size / 2) / size;
+}
+
+void led_anim_compile(LedAnimStrip *strip, uint8_t length) {
+    strip->length = length * LED_ANIM_ONE;
+
+    strip->feather = to_position(length / 4.0f);
+    if (strip->feather < 1) {
+        strip->feather = 1;
+    }
+    strip->feather_recip = reciprocal(strip->feather);
+
+    strip->tail = (length / 3 + 1) * LED_ANIM_ONE;
+    strip->tail_recip = reciprocal(strip->tail);
+}
+
+uint32_t led_anim_phase(float time) {
+    if (time < 0.0f) {
+        return (LED_ANIM_PERIOD - led_anim_phase(-time)) % LED_ANIM_PERIOD;
+    }
+    return (uint64_t) (time * (LED_ANIM_PERIOD / 2.0f)) % LED_ANIM_PERIOD;
+}
+
+// The progress in Q15
+static uint32_t progress(uint32_t phase) {
+    // The falling half mirrors the rising one
+    uint32_t t = phase < LED_ANIM_PERIOD / 2 ? phase : LED_ANIM_PERIOD - phase;
+
+    uint32_t k = t >> PROGRESS_SHIFT;
+    uint32_t frac = t & ((1 << PROGRESS_SHIFT) - 1);
+    uint32_t p = progress_keyframes[k];
+    if (frac) {
+        p += ((progress_keyframes[k + 1] - p) * frac) >> PROGRESS_SHIFT;
+    }
+    return p;
+}
+
+uint32_t led_anim_progress(uint32_t phase) {
+    return (progress(phase) + 64) >> 7;
+}
+
+void led_anim_pulse_begin(
+    LedAnimPulse *pulse, const LedAnimStrip *strip, float time, float center
+) {
+    uint32_t p = progress(led_anim_phase(time));
+
+    float length = strip->length / (float) LED_ANIM_ONE / 2.0f - center;
+    pulse->offset = (to_position(length) * (int32_t) (32768 - p)) >> 15;
+
+    pulse->fade = LED_ANIM_ONE;
+    float ratio = center / length;
+    if (time < ratio) {
+        pulse->fade = to_position(time / ratio);
+    }
+}
+
+void led_anim_knight_rider_begin(LedAnimKnightRider *kr, const LedAnimStrip *strip, float time) {
+    float length = strip->length / (float) LED_ANIM_ONE;
+
+    time *= 0.7f;
+    kr->backlight = time > 0.3f ? to_position(0.08f) : 0;
+
+    // 0 to 2 s in the period, fmodf(time - 1.0f, 2.0f) is negative during the first second
+    float t1 = led_anim_phase(time) * (2.0f / LED_ANIM_PERIOD);
+    float t2 = time < 1.0f ? time - 1.0f : led_anim_phase(time - 1.0f) * (2.0f / LED_ANIM_PERIOD);
+
+    kr->x1 = to_position(length * t1 - 0.5f * length - 1.0f);
+    kr->x2 = to_position(1.5f * length - length * t2);
+}
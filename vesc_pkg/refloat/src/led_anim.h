@@ -0,0 +1,135 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+// Weights, brightness and blends in fixed point, 0 to LED_ANIM_ONE
+#define LED_ANIM_ONE 256
+
+// Animation phase, one period of 2 s
+#define LED_ANIM_PERIOD 65536
+
+/**
+ * What the animations need of a strip, compiled when the LEDs are configured
+ * so that the per-pixel work is integer multiplies and shifts. Positions and
+ * lengths are in 1/256 of an LED, the reciprocals turn a distance into a
+ * weight: weight = distance * recip >> 16.
+ */
+typedef struct {
+    int32_t length;
+    int32_t feather;  // the edge of the pulse, length / 4
+    int32_t feather_recip;
+    int32_t tail;  // the tail of the knight rider, length / 3 + 1 LEDs
+    int32_t tail_recip;
+} LedAnimStrip;
+
+typedef struct {
+    int32_t offset;
+    uint32_t fade;
+} LedAnimPulse;
+
+typedef struct {
+    int32_t x1;
+    int32_t x2;
+    uint32_t backlight;
+} LedAnimKnightRider;
+
+void led_anim_compile(LedAnimStrip *strip, uint8_t length);
+
+/**
+ * Returns the phase of @p time (s) in its 2 s period, from 0 to
+ * LED_ANIM_PERIOD - 1.
+ */
+uint32_t led_anim_phase(float time);
+
+/**
+ * Returns a cosine wave oscillating from 0 to LED_ANIM_ONE and back, starting
+ * at 0, with a period of 2 s, interpolated from a keyframe table.
+ */
+uint32_t led_anim_progress(uint32_t phase);
+
+// Per-frame setup of a pulse growing from @p center (LEDs) on each end to the middle
+void led_anim_pulse_begin(
+    LedAnimPulse *pulse, const LedAnimStrip *strip, float time, float center
+);
+
+// Per-frame setup of two beams crossing the strip back and forth
+void led_anim_knight_rider_begin(LedAnimKnightRider *kr, const LedAnimStrip *strip, float time);
+
+static inline uint32_t led_anim_weight(int32_t distance, int32_t size, int32_t recip) {
+    if (distance <= 0) {
+        return 0;
+    } else if (distance >= size) {
+        return LED_ANIM_ONE;
+    }
+    return (uint32_t) (distance * recip) >> 16;
+}
+
+// The weight of color1 over color2 of LED @p i in the pulse
+static inline uint32_t led_anim_pulse_weight(
+    const LedAnimPulse *pulse, const LedAnimStrip *strip, uint8_t i
+) {
+    int32_t pos = i * LED_ANIM_ONE;
+    int32_t dist1 = pos - pulse->offset + LED_ANIM_ONE;
+    int32_t dist2 = strip->length - pulse->offset - pos;
+    int32_t dist = dist1 < dist2 ? dist1 : dist2;
+    return led_anim_weight(dist, strip->feather, strip->feather_recip) * pulse->fade >> 8;
+}
+
+// The weight of color1 over color2 of LED @p i in the knight rider
+static inline uint32_t led_anim_knight_rider_weight(
+    const LedAnimKnightRider *kr, const LedAnimStrip *strip, uint8_t i
+) {
+    int32_t pos = i * LED_ANIM_ONE;
+
+    uint32_t k1 = kr->backlight;
+    int32_t dist1 = kr->x1 - pos;
+    if (dist1 >= 0) {
+        if (dist1 <= strip->tail) {
+            k1 = led_anim_weight(strip->tail - dist1, strip->tail, strip->tail_recip);
+        }
+    } else if (dist1 > -LED_ANIM_ONE) {
+        k1 = kr->x1 & (LED_ANIM_ONE - 1);
+    }
+
+    uint32_t k2 = kr->backlight;
+    int32_t dist2 = pos - kr->x2;
+    if (dist2 >= 0) {
+        if (dist2 <= strip->tail) {
+            k2 = led_anim_weight(strip->tail - dist2, strip->tail, strip->tail_recip);
+        }
+    } else if (dist2 > -LED_ANIM_ONE) {
+        k2 = LED_ANIM_ONE - (kr->x2 & (LED_ANIM_ONE - 1));
+    }
+
+    return k1 > k2 ? k1 : k2;
+}
+
+// color1 * (1 - weight) + color2 * weight per channel, two channels per multiply
+static inline uint32_t led_anim_blend(uint32_t color1, uint32_t color2, uint32_t weight) {
+    uint32_t weight1 = LED_ANIM_ONE - weight;
+    uint32_t rb = ((color1 & 0x00FF00FF) * weight1 + (color2 & 0x00FF00FF) * weight) >> 8;
+    uint32_t wg = ((color1 >> 8) & 0x00FF00FF) * weight1 + ((color2 >> 8) & 0x00FF00FF) * weight;
+    return (rb & 0x00FF00FF) | (wg & 0xFF00FF00);
+}
+
+// Every channel times @p brightness, rounded
+static inline uint32_t led_anim_scale(uint32_t color, uint32_t brightness) {
+    uint32_t rb = ((color & 0x00FF00FF) * brightness + 0x00800080) >> 8;
+    uint32_t wg = ((color >> 8) & 0x00FF00FF) * brightness + 0x00800080;
+    return (rb & 0x00FF00FF) | (wg & 0xFF00FF00);
+}
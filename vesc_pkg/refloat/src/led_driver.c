@@ -21,18 +21,19 @@
 #include "st_types.h"
 
 #include "utils.h"
+#include "ws2812.h"
 
 #include "vesc_c_if.h"
 
 #include <math.h>
 #include <string.h>
 
-#define WS2812_CLK_HZ 800000
-#define TIM_PERIOD ((168000000 / 2 / WS2812_CLK_HZ) - 1)
-#define WS2812_ZERO (TIM_PERIOD * 0.3)
-#define WS2812_ONE (TIM_PERIOD * 0.7)
 #define BITBUFFER_PAD 1000
 
+// How long to poll for the DMA to switch memory targets, in frames on the strip
+#define SWAP_TIMEOUT_FRAMES 2
+#define SWAP_POLL_US 100
+
 static DMA_Stream_TypeDef *get_dma_stream(LedPin pin) {
     if (pin == LED_PIN_B6) {
         return DMA1_Stream0;
@@ -41,7 +42,7 @@ static DMA_Stream_TypeDef *get_dma_stream(LedPin pin) {
     }
 }
 
-static void init_dma(LedPin pin, uint16_t *buffer, uint32_t length) {
+static void init_dma(LedPin pin, uint16_t *buffer, uint32_t length, bool double_buffer) {
     TIM_TypeDef *tim = TIM4;
     uint32_t dma_ch = DMA_Channel_2;
     DMA_Stream_TypeDef *dma_stream = get_dma_stream(pin);
@@ -88,12 +89,18 @@ static void init_dma(LedPin pin, uint16_t *buffer, uint32_t length) {
 
     DMA_Init(dma_stream, &DMA_InitStructure);
 
+    if (double_buffer) {
+        // Both memory targets start on the same bitbuffer, paint retargets them
+        DMA_DoubleBufferModeConfig(dma_stream, (uint32_t) buffer, DMA_Memory_0);
+        DMA_DoubleBufferModeCmd(dma_stream, ENABLE);
+    }
+
     RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
 
     TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
     TIM_TimeBaseStructure.TIM_Prescaler = 0;
     TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
-    TIM_TimeBaseStructure.TIM_Period = TIM_PERIOD;
+    TIM_TimeBaseStructure.TIM_Period = WS2812_TIM_PERIOD;
     TIM_TimeBaseStructure.TIM_ClockDivision = 0;
     TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
 
@@ -130,73 +137,148 @@ static void deinit_dma(LedPin pin) {
 bool led_driver_init(
     LedDriver *driver, LedPin pin, LedType type, LedColorOrder color_order, uint8_t led_nr
 ) {
+    driver->bitbuffers[0] = NULL;
+    driver->bitbuffers[1] = NULL;
+    driver->back = 0;
+    driver->bitbuffer_length = 0;
+
     if (type != LED_TYPE_RGB && type != LED_TYPE_RGBW) {
-        driver->bitbuffer = NULL;
-        driver->bitbuffer_length = 0;
         return false;
     }
 
     driver->bit_nr = type == LED_TYPE_RGBW ? 32 : 24;
     driver->bitbuffer_length = driver->bit_nr * led_nr + BITBUFFER_PAD;
-    driver->bitbuffer = VESC_IF->malloc(sizeof(uint16_t) * driver->bitbuffer_length);
     driver->pin = pin;
     driver->color_order = color_order;
 
-    if (!driver->bitbuffer) {
-        log_error("Failed to init LED driver, out of memory.");
-        return false;
+    uint32_t size = sizeof(uint16_t) * driver->bitbuffer_length;
+    driver->bitbuffers[0] = VESC_IF->malloc(2 * size);
+    if (driver->bitbuffers[0]) {
+        driver->bitbuffers[1] = driver->bitbuffers[0] + driver->bitbuffer_length;
+        driver->back = 1;
+    } else {
+        driver->bitbuffers[0] = VESC_IF->malloc(size);
+        if (!driver->bitbuffers[0]) {
+            driver->bitbuffer_length = 0;
+            log_error("Failed to init LED driver, out of memory.");
+            return false;
+        }
+        log_msg("Not enough memory for LED double buffering, frames may tear.");
     }
 
-    for (uint32_t i = 0; i < driver->bit_nr * led_nr; ++i) {
-        driver->bitbuffer[i] = WS2812_ZERO;
+    for (int b = 0; b < 2 && driver->bitbuffers[b]; ++b) {
+        uint16_t *bitbuffer = driver->bitbuffers[b];
+        for (uint32_t i = 0; i < driver->bit_nr * led_nr; ++i) {
+            bitbuffer[i] = WS2812_ZERO;
+        }
+
+        memset(bitbuffer + driver->bit_nr * led_nr, 0, sizeof(uint16_t) * BITBUFFER_PAD);
     }
 
-    memset(driver->bitbuffer + driver->bit_nr * led_nr, 0, sizeof(uint16_t) * BITBUFFER_PAD);
-    init_dma(pin, driver->bitbuffer, driver->bitbuffer_length);
+    init_dma(pin, driver->bitbuffers[0], driver->bitbuffer_length, driver->bitbuffers[1] != NULL);
     return true;
 }
 
-inline static uint8_t cgamma(uint8_t c) {
-    return (c * c + c) / 256;
+static uint32_t get_dma_flags(LedPin pin) {
+    if (pin == LED_PIN_B6) {
+        return DMA_FLAG_FEIF0 | DMA_FLAG_DMEIF0 | DMA_FLAG_TEIF0 | DMA_FLAG_HTIF0 | DMA_FLAG_TCIF0;
+    } else {
+        return DMA_FLAG_FEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_TCIF3;
+    }
 }
 
-void led_driver_paint(LedDriver *driver, uint32_t *data, uint32_t length) {
-    if (!driver->bitbuffer) {
-        return;
-    }
+static uint32_t get_dma_error_flag(LedPin pin) {
+    return pin == LED_PIN_B6 ? DMA_FLAG_TEIF0 : DMA_FLAG_TEIF3;
+}
 
-    for (uint32_t i = 0; i < length; ++i) {
-        uint32_t color = data[i];
-        uint8_t w = cgamma((color >> 24) & 0xFF);
-        uint8_t r = cgamma((color >> 16) & 0xFF);
-        uint8_t g = cgamma((color >> 8) & 0xFF);
-        uint8_t b = cgamma(color & 0xFF);
-
-        if (driver->color_order == LED_COLOR_GRB) {
-            color = (g << 16) | (r << 8) | b;
-        } else {
-            color = (r << 16) | (g << 8) | b;
+/**
+ * Waits for the DMA to switch memory targets at the end of a frame and
+ * returns the target it left in @p idle. The DMA only comes back to it after a
+ * whole frame, which leaves the time to retarget it.
+ *
+ * @return False if the DMA didn't switch within @p polls.
+ */
+static bool wait_target_switch(DMA_Stream_TypeDef *stream, uint32_t polls, uint32_t *idle) {
+    uint32_t current = DMA_GetCurrentMemoryTarget(stream);
+    while (DMA_GetCurrentMemoryTarget(stream) == current) {
+        if (polls == 0) {
+            return false;
         }
+        VESC_IF->sleep_us(SWAP_POLL_US);
+        --polls;
+    }
 
-        if (driver->bit_nr == 32) {
-            color <<= 8;
-            color |= w;
-        }
+    *idle = current ? DMA_Memory_1 : DMA_Memory_0;
+    return true;
+}
 
-        for (int8_t bit = driver->bit_nr - 1; bit >= 0; --bit) {
-            driver->bitbuffer[bit + i * driver->bit_nr] = color & 0x1 ? WS2812_ONE : WS2812_ZERO;
-            color >>= 1;
+// Writing the target the DMA is on disables the stream with a transfer error,
+// which happens if the thread was held up for a frame between seeing the
+// switch and retargeting. Restarts the stream from the start of a frame, with
+// both targets at @p buffer.
+static void restart_dma(LedDriver *driver, DMA_Stream_TypeDef *stream, uint16_t *buffer) {
+    DMA_Cmd(stream, DISABLE);
+    while (DMA_GetCmdStatus(stream) == ENABLE) {
+    }
+
+    DMA_ClearFlag(stream, get_dma_flags(driver->pin));
+    DMA_MemoryTargetConfig(stream, (uint32_t) buffer, DMA_Memory_0);
+    DMA_MemoryTargetConfig(stream, (uint32_t) buffer, DMA_Memory_1);
+    DMA_SetCurrDataCounter(stream, driver->bitbuffer_length);
+    DMA_Cmd(stream, ENABLE);
+}
+
+// The DMA alternates between its two memory targets at the end of every
+// frame, including the reset gap. Both targets point at the front bitbuffer
+// and are moved to the back one a frame at a time, each right after the DMA
+// switched away from it, so the strip only ever gets whole frames and never
+// sees the front one again after the swap.
+static void swap(LedDriver *driver) {
+    DMA_Stream_TypeDef *stream = get_dma_stream(driver->pin);
+    uint16_t *back = driver->bitbuffers[driver->back];
+
+    uint32_t frame_us = driver->bitbuffer_length * 1000000ull / WS2812_CLK_HZ;
+    uint32_t polls = SWAP_TIMEOUT_FRAMES * frame_us / SWAP_POLL_US + 1;
+
+    bool switched = true;
+    for (int i = 0; i < 2 && switched; ++i) {
+        uint32_t idle;
+        switched = wait_target_switch(stream, polls, &idle);
+        if (switched) {
+            DMA_MemoryTargetConfig(stream, (uint32_t) back, idle);
         }
     }
+
+    // A stream that stopped switching was disabled by an error too
+    if (!switched || DMA_GetFlagStatus(stream, get_dma_error_flag(driver->pin)) == SET) {
+        restart_dma(driver, stream, back);
+    }
+
+    driver->back ^= 1;
+}
+
+void led_driver_paint(LedDriver *driver, uint32_t *data, uint32_t length) {
+    if (!driver->bitbuffers[driver->back]) {
+        return;
+    }
+
+    ws2812_encode(
+        driver->bitbuffers[driver->back], data, length, driver->bit_nr, driver->color_order
+    );
+
+    if (driver->bitbuffers[1]) {
+        swap(driver);
+    }
 }
 
 void led_driver_destroy(LedDriver *driver) {
-    if (driver->bitbuffer) {
+    if (driver->bitbuffers[0]) {
         // only touch the timer/DMA if we inited it - something else could be using it
         deinit_dma(driver->pin);
 
-        VESC_IF->free(driver->bitbuffer);
-        driver->bitbuffer = NULL;
+        VESC_IF->free(driver->bitbuffers[0]);
+        driver->bitbuffers[0] = NULL;
+        driver->bitbuffers[1] = NULL;
     }
     driver->bitbuffer_length = 0;
 }
@@ -25,7 +25,9 @@
 
 typedef struct {
     uint8_t bit_nr;  // 24 for RGB, 32 for RGBW
-    uint16_t *bitbuffer;
+    // Both in one allocation, the second is NULL if there wasn't memory for it
+    uint16_t *bitbuffers[2];
+    uint8_t back;  // index of the bitbuffer to paint, the other one is on the strip
     uint32_t bitbuffer_length;
     LedPin pin;
     LedColorOrder color_order;
@@ -35,6 +37,12 @@ bool led_driver_init(
     LedDriver *driver, LedPin pin, LedType type, LedColorOrder color_order, uint8_t led_nr
 );
 
+/**
+ * Paints @p data into the back bitbuffer while the front one keeps being
+ * transmitted, then swaps them in the reset gap at the end of the frame on the
+ * strip, which can take up to two frames. Without the memory for two
+ * bitbuffers, paints the only one in place.
+ */
 void led_driver_paint(LedDriver *driver, uint32_t *data, uint32_t length);
 
 void led_driver_destroy(LedDriver *driver);
@@ -17,7 +17,9 @@
 
 #include "leds.h"
 
+#include "conf/buffer.h"
 #include "conf/datatypes.h"
+#include "led_anim.h"
 #include "led_driver.h"
 #include "utils.h"
 
@@ -34,12 +36,7 @@
 // Status Bar change rate
 #define SB_RATE (5.0f / LEDS_REFRESH_RATE)
 
-#define R(c) ((uint8_t) ((c) >> 16))
-#define G(c) ((uint8_t) ((c) >> 8))
-#define B(c) ((uint8_t) (c))
-#define W(c) ((uint8_t) ((c) >> 24))
 #define RGB(r, g, b) ((r) << 16 | (g) << 8 | (b))
-#define RGBW(r, g, b, w) ((w) << 24 | (r) << 16 | (g) << 8 | (b))
 
 static const uint32_t colors[] = {
     0x00000000,  // BLACK
@@ -82,21 +79,14 @@ static const uint32_t colors[] = {
 #define RED_BAR_COLOR 0x00FF3828
 #define BATTERY10_BAR_COLOR 0x00FF5038
 
-static uint32_t color_blend(uint32_t color1, uint32_t color2, float blend) {
-    if (blend <= 0.0f) {
-        return color1;
-    } else if (blend >= 1.0f) {
-        return color2;
+// A brightness or a blend in [0, 1] in fixed point, 0 to LED_ANIM_ONE
+static uint32_t to_fixed(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    } else if (value >= 1.0f) {
+        return LED_ANIM_ONE;
     }
-
-    float blend1 = 1.0f - blend;
-
-    uint8_t r = R(color1) * blend1 + R(color2) * blend;
-    uint8_t g = G(color1) * blend1 + G(color2) * blend;
-    uint8_t b = B(color1) * blend1 + B(color2) * blend;
-    uint8_t w = W(color1) * blend1 + W(color2) * blend;
-
-    return RGBW(r, g, b, w);
+    return value * LED_ANIM_ONE + 0.5f;
 }
 
 // Borrowed from WLED
@@ -132,10 +122,16 @@ static void full_animation_reset(Leds *leds, float current_time) {
     leds->status_on_front_idle_time = current_time;
 }
 
-static void led_set_color(
-    Leds *leds, const LedStrip *strip, uint8_t i, uint32_t color, float brightness, float blend
+// Brightness (including the on/off fade) and blend in fixed point
+static void led_set(
+    Leds *leds,
+    const LedStrip *strip,
+    uint8_t i,
+    uint32_t color,
+    uint32_t brightness,
+    uint32_t blend
 ) {
-    if (blend <= 0.0f) {
+    if (blend == 0) {
         return;
     }
 
@@ -149,115 +145,65 @@ static void led_set_color(
         return;
     }
 
-    float br = brightness * leds->on_off_fade;
-
-    uint8_t r = R(color) * br + 0.5f;
-    uint8_t g = G(color) * br + 0.5f;
-    uint8_t b = B(color) * br + 0.5f;
-    uint8_t w = W(color) * br + 0.5f;
-
-    if (blend < 1.0f) {
-        uint32_t orig_color = leds->led_data[led];
-        float orig_blend = 1.0f - blend;
-
-        r = r * blend + R(orig_color) * orig_blend;
-        g = g * blend + G(orig_color) * orig_blend;
-        b = b * blend + B(orig_color) * orig_blend;
-        w = w * blend + W(orig_color) * orig_blend;
+    color = led_anim_scale(color, brightness);
+    if (blend < LED_ANIM_ONE) {
+        color = led_anim_blend(leds->led_data[led], color, blend);
     }
 
-    leds->led_data[led] = RGBW(r, g, b, w);
+    leds->led_data[led] = color;
+}
+
+static void led_set_color(
+    Leds *leds, const LedStrip *strip, uint8_t i, uint32_t color, float brightness, float blend
+) {
+    led_set(leds, strip, i, color, to_fixed(brightness * leds->on_off_fade), to_fixed(blend));
 }
 
 static void strip_set_color(
     Leds *leds, const LedStrip *strip, uint32_t color, float brightness, float blend
 ) {
+    uint32_t br = to_fixed(brightness * leds->on_off_fade);
+    uint32_t bl = to_fixed(blend);
     for (uint8_t i = 0; i < strip->length; ++i) {
-        led_set_color(leds, strip, i, color, brightness, blend);
+        led_set(leds, strip, i, color, br, bl);
     }
 }
 
-// Returns a cosine wave oscilataing from 0 to 1, starting at 0, with a period of 2s.
-static float cosine_progress(float time) {
-    uint32_t rounded = lroundf(time);
-    float x = (time - rounded) * M_PI;
-    // Bhaskara cosine approximation, optimized to return: (1 - cos(x)) / 2
-    float cos = 10 * x * x / (4 * x * x + 4 * M_PI * M_PI);
-    if (rounded % 2 == 1) {
-        cos = 1 - cos;
-    }
-    return cos;
-}
-
 static void anim_fade(Leds *leds, const LedStrip *strip, const LedBar *bar, float time) {
-    float p = cosine_progress(time);
-    uint32_t color = color_blend(colors[bar->color2], colors[bar->color1], p);
+    uint32_t p = led_anim_progress(led_anim_phase(time));
+    uint32_t color = led_anim_blend(colors[bar->color2], colors[bar->color1], p);
     strip_set_color(leds, strip, color, strip->brightness, 1.0f);
 }
 
 static void anim_strobe(Leds *leds, const LedStrip *strip, const LedBar *bar, float time) {
-    uint32_t color = fmodf(time, 2.0f) >= 1.0f ? colors[bar->color2] : colors[bar->color1];
+    bool second = led_anim_phase(time) >= LED_ANIM_PERIOD / 2;
+    uint32_t color = second ? colors[bar->color2] : colors[bar->color1];
     strip_set_color(leds, strip, color, strip->brightness, 1.0f);
 }
 
 static void anim_pulse(
     Leds *leds, const LedStrip *strip, const LedBar *bar, float time, float center
 ) {
-    float p = cosine_progress(time);
-
-    float length = strip->length / 2.0f - center;
-    float offset = length * (1.0f - p);
-    float feather = strip->length / 4.0f;
-
-    float fade = 1.0f;
-    float ratio = center / length;
-    if (time < ratio) {
-        fade = time / ratio;
-    }
+    LedAnimPulse pulse;
+    led_anim_pulse_begin(&pulse, &strip->anim, time, center);
 
+    uint32_t br = to_fixed(strip->brightness * leds->on_off_fade);
     for (uint8_t i = 0; i < strip->length; ++i) {
-        float dist1 = i - offset + 1.0f;
-        float dist2 = strip->length - offset - i;
-        float k1 = clampf(dist1 / feather, 0.0f, 1.0f);
-        float k2 = clampf(dist2 / feather, 0.0f, 1.0f);
-
-        uint32_t color =
-            color_blend(colors[bar->color2], colors[bar->color1], fminf(k1, k2) * fade);
-        led_set_color(leds, strip, i, color, strip->brightness, 1.0f);
+        uint32_t k = led_anim_pulse_weight(&pulse, &strip->anim, i);
+        uint32_t color = led_anim_blend(colors[bar->color2], colors[bar->color1], k);
+        led_set(leds, strip, i, color, br, LED_ANIM_ONE);
     }
 }
 
 static void anim_knight_rider(Leds *leds, const LedStrip *strip, const LedBar *bar, float time) {
-    const uint8_t tail = strip->length / 3 + 1;
-
-    time *= 0.7f;
-    float backlight = time > 0.3f ? 0.08f : 0.0f;
-    float x1 = strip->length * fmodf(time, 2.0f) - 0.5f * strip->length - 1.0f;
-    float x2 = 1.5f * strip->length - strip->length * fmodf(time - 1.0f, 2.0f);
+    LedAnimKnightRider kr;
+    led_anim_knight_rider_begin(&kr, &strip->anim, time);
 
+    uint32_t br = to_fixed(strip->brightness * leds->on_off_fade);
     for (uint8_t i = 0; i < strip->length; ++i) {
-        float k1 = backlight;
-        float dist1 = fabsf(x1 - i);
-        if (i <= x1) {
-            if (dist1 <= tail) {
-                k1 = (tail - dist1) / tail;
-            }
-        } else if (i < x1 + 1) {
-            k1 = x1 - floorf(x1);
-        }
-
-        float k2 = backlight;
-        float dist2 = fabsf(x2 - i);
-        if (i >= x2) {
-            if (dist2 <= tail) {
-                k2 = (tail - dist2) / tail;
-            }
-        } else if (i > x2 - 1) {
-            k2 = 1 - x2 + floorf(x2);
-        }
-
-        uint32_t color = color_blend(colors[bar->color2], colors[bar->color1], fmaxf(k1, k2));
-        led_set_color(leds, strip, i, color, strip->brightness, 1.0f);
+        uint32_t k = led_anim_knight_rider_weight(&kr, &strip->anim, i);
+        uint32_t color = led_anim_blend(colors[bar->color2], colors[bar->color1], k);
+        led_set(leds, strip, i, color, br, LED_ANIM_ONE);
     }
 }
 
@@ -372,8 +318,15 @@ static void anim_disabled(Leds *leds, const LedStrip *strip, float time) {
     anim_pulse(leds, strip, &disabled_bar, time / 2.0f, strip->length / 3.0f);
 }
 
-static void status_animate(
-    Leds *leds, const LedStrip *strip, float current_time, float blend, float idle_blend
+// Updates the status bar state and fills the inputs it's going to be rendered
+// from, leaving the ones that don't show at zero
+static void status_update(
+    Leds *leds,
+    const LedStrip *strip,
+    float current_time,
+    float blend,
+    float idle_blend,
+    LedStripInputs *in
 ) {
     if (fabsf(VESC_IF->mc_get_rpm()) > 0.5f) {
         leds->status_idle_time = current_time;
@@ -390,6 +343,32 @@ static void status_animate(
         rate_limitf(&leds->status_duty_blend, 0.0f, SB_RATE);
     }
 
+    in->status_blend = blend;
+    in->idle_blend = idle_blend;
+    if (idle_blend > 0.0f && strip == &leds->status_strip) {
+        in->bar = &leds->cfg->status_idle;
+    }
+
+    if (idle_blend < 1.0f) {
+        in->duty_blend = leds->status_duty_blend;
+        if (in->duty_blend < 1.0f) {
+            // Rounded to 0.1 %, so that the voltage noise doesn't repaint an idle board
+            in->battery = roundf(VESC_IF->mc_get_battery_level(NULL) * 1000.0f) / 1000.0f;
+        }
+        if (in->duty_blend > 0.0f) {
+            in->duty = duty;
+        }
+        in->left_sensor = leds->left_sensor;
+        in->right_sensor = leds->right_sensor;
+    }
+}
+
+static void status_animate(
+    Leds *leds, const LedStrip *strip, float current_time, const LedStripInputs *in
+) {
+    float blend = in->status_blend;
+    float idle_blend = in->idle_blend;
+
     if (idle_blend > 0.0f) {
         if (strip == &leds->front_strip) {
             strip_set_color(leds, strip, 0x00000000, strip->brightness, blend);
@@ -405,20 +384,23 @@ static void status_animate(
 
     if (idle_blend < 1.0f) {
         bool reverse = strip == &leds->front_strip;
-        if (leds->status_duty_blend < 1.0f) {
-            float battery = VESC_IF->mc_get_battery_level(NULL);
+        if (in->duty_blend < 1.0f) {
             anim_progress_bar(
-                leds, strip, battery, BATTERY_COLOR, false, reverse, fminf(blend, 1.0f - idle_blend)
+                leds,
+                strip,
+                in->battery,
+                BATTERY_COLOR,
+                false,
+                reverse,
+                fminf(blend, 1.0f - idle_blend)
             );
         }
 
-        if (leds->status_duty_blend > 0.0f) {
-            anim_progress_bar(
-                leds, strip, duty, DUTY_COLOR, true, reverse, leds->status_duty_blend
-            );
+        if (in->duty_blend > 0.0f) {
+            anim_progress_bar(leds, strip, in->duty, DUTY_COLOR, true, reverse, in->duty_blend);
         }
 
-        if (leds->left_sensor > 0.0f || leds->right_sensor > 0.0f) {
+        if (in->left_sensor > 0.0f || in->right_sensor > 0.0f) {
             anim_fs_state(leds, strip, reverse, blend);
         }
     }
@@ -463,7 +445,8 @@ static void trans_fade_out_in(
         float brightness = strip->brightness + (to_bar->brightness - strip->brightness) * prog;
         strip_set_color(leds, strip, 0x00000000, brightness, prog);
     } else {
-        uint32_t to_color = color_blend(0x00000000, colors[led_bar_to_color(to_bar)], progress);
+        uint32_t to_color =
+            led_anim_blend(0x00000000, colors[led_bar_to_color(to_bar)], to_fixed(progress));
         float brightness = strip->brightness + (to_bar->brightness - strip->brightness) * progress;
         strip_set_color(leds, strip, to_color, brightness, 1.0f);
     }
@@ -481,7 +464,8 @@ static void trans_cipher(
     int8_t prog = progress * strip->length;
 
     uint32_t to_color = colors[led_bar_to_color(to_bar)];
-    float mid_brightness = (strip->brightness + to_bar->brightness) / 2.0f;
+    uint32_t mid_br = to_fixed((strip->brightness + to_bar->brightness) / 2.0f * leds->on_off_fade);
+    uint32_t to_br = to_fixed(to_bar->brightness * leds->on_off_fade);
 
     for (int8_t i = 1 - strip->length; i <= prog; ++i) {
         if (i <= 0) {
@@ -495,7 +479,7 @@ static void trans_cipher(
                 color = 0x00000000;
             } else {
                 if (mono) {
-                    color = color_blend(colors[from_bar->color1], to_color, r / 256.0f);
+                    color = led_anim_blend(colors[from_bar->color1], to_color, r);
                 } else {
                     // random fade to white
                     uint8_t wf = rnd(j + target_j + 23) % 128 + 80;
@@ -503,11 +487,9 @@ static void trans_cipher(
                 }
             }
 
-            led_set_color(leds, strip, target_j, color, mid_brightness, 1.0f);
+            led_set(leds, strip, target_j, color, mid_br, LED_ANIM_ONE);
         } else {
-            led_set_color(
-                leds, strip, data->map[i - 1 + strip->length], to_color, to_bar->brightness, 1.0f
-            );
+            led_set(leds, strip, data->map[i - 1 + strip->length], to_color, to_br, LED_ANIM_ONE);
         }
     }
 }
@@ -586,6 +568,52 @@ static const LedBar *target_bar(const Leds *leds, bool flip) {
     }
 }
 
+static bool bar_animated(const LedBar *bar) {
+    return bar->mode != LED_MODE_SOLID;
+}
+
+static LedStripInputs bar_inputs(const Leds *leds, const LedStrip *strip, const LedBar *bar) {
+    return (LedStripInputs) {
+        .bar = bar,
+        .brightness = strip->brightness,
+        .on_off_fade = leds->on_off_fade,
+    };
+}
+
+static bool inputs_equal(const LedStripInputs *a, const LedStripInputs *b) {
+    return a->bar == b->bar && a->brightness == b->brightness &&
+        a->on_off_fade == b->on_off_fade && a->status_blend == b->status_blend &&
+        a->idle_blend == b->idle_blend && a->battery == b->battery && a->duty == b->duty &&
+        a->duty_blend == b->duty_blend && a->left_sensor == b->left_sensor &&
+        a->right_sensor == b->right_sensor;
+}
+
+// Returns whether the strip needs rendering, because it changes with time or
+// its inputs differ from the last render, and keeps the inputs for the next one
+static bool strip_dirty(Leds *leds, LedStrip *strip, const LedStripInputs *in, bool animated) {
+    bool dirty = animated || !strip->rendered.valid || !inputs_equal(in, &strip->rendered);
+    strip->rendered = *in;
+    strip->rendered.valid = !animated;
+
+    if (dirty) {
+        ++leds->strips_rendered;
+    } else {
+        ++leds->strips_skipped;
+    }
+    return dirty;
+}
+
+static void strips_invalidate(Leds *leds) {
+    leds->status_strip.rendered.valid = false;
+    leds->front_strip.rendered.valid = false;
+    leds->rear_strip.rendered.valid = false;
+}
+
+static void front_rear_animate(Leds *leds, float time) {
+    led_strip_animate(leds, &leds->front_strip, leds->front_bar, time);
+    led_strip_animate(leds, &leds->rear_strip, leds->rear_bar, time);
+}
+
 bool leds_init(Leds *leds, CfgHwLeds *hw_cfg, const CfgLeds *cfg, FootpadSensorState fs_state) {
     leds->status_strip.start = 0;
     leds->status_strip.length = hw_cfg->status.count;
@@ -646,6 +674,13 @@ bool leds_init(Leds *leds, CfgHwLeds *hw_cfg, const CfgLeds *cfg, FootpadSensorS
     leds->rear_dir_target = &cfg->rear;
     leds->rear_time_target = &cfg->rear;
 
+    strips_invalidate(leds);
+    leds->reconfigured = false;
+    leds->frames_rendered = 0;
+    leds->frames_skipped = 0;
+    leds->strips_rendered = 0;
+    leds->strips_skipped = 0;
+
     leds->led_count = leds->rear_strip.start + leds->rear_strip.length;
 
     bool driver_init = true;
@@ -686,6 +721,10 @@ bool leds_init(Leds *leds, CfgHwLeds *hw_cfg, const CfgLeds *cfg, FootpadSensorS
 }
 
 void leds_configure(Leds *leds, const CfgLeds *cfg) {
+    led_anim_compile(&leds->status_strip.anim, leds->status_strip.length);
+    led_anim_compile(&leds->front_strip.anim, leds->front_strip.length);
+    led_anim_compile(&leds->rear_strip.anim, leds->rear_strip.length);
+
     leds->duty_threshold = fmaxf(cfg->status.duty_threshold, 0.15);
 
     leds->headlights_trans.transition = cfg->headlights_transition;
@@ -694,6 +733,8 @@ void leds_configure(Leds *leds, const CfgLeds *cfg) {
     float current_time = VESC_IF->system_time();
     leds->status_idle_time = current_time;
     leds->status_on_front_idle_time = current_time;
+
+    leds->reconfigured = true;
 }
 
 void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
@@ -701,6 +742,11 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
         return;
     }
 
+    if (leds->reconfigured) {
+        leds->reconfigured = false;
+        strips_invalidate(leds);
+    }
+
     float current_time = VESC_IF->system_time();
     leds->last_updated = current_time;
     RunState old_state = leds->state.state;
@@ -802,7 +848,9 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
         anim_disabled(leds, &leds->front_strip, current_time);
         anim_disabled(leds, &leds->rear_strip, current_time);
         anim_disabled(leds, &leds->status_strip, current_time);
+        strips_invalidate(leds);
         led_driver_paint(&leds->led_driver, leds->led_data, leds->led_count);
+        ++leds->frames_rendered;
         return;
     }
 
@@ -832,12 +880,12 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
         }
     }
 
-    led_strip_animate(
-        leds, &leds->front_strip, leds->front_bar, current_time - leds->animation_start
-    );
-    led_strip_animate(
-        leds, &leds->rear_strip, leds->rear_bar, current_time - leds->animation_start
-    );
+    // The front and rear bars are rendered as they are now, right before the
+    // first transition over them, or at the end if they changed
+    float animation_time = current_time - leds->animation_start;
+    LedStripInputs front_in = bar_inputs(leds, &leds->front_strip, leds->front_bar);
+    LedStripInputs rear_in = bar_inputs(leds, &leds->rear_strip, leds->rear_bar);
+    bool transitioning = false;
 
     // headlights transition from off to on or vice versa
     bool headlights_should = headlights_should_be_on(leds);
@@ -891,6 +939,11 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
             leds->rear_dir_target = target_bar(leds, false);
         }
 
+        if (!transitioning) {
+            transitioning = true;
+            front_rear_animate(leds, animation_time);
+        }
+
         if (leds->direction_forward) {
             // transitioning to forward on the front strip
             led_strip_transition(
@@ -940,6 +993,11 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
 
     // headlights transition
     if (leds->headlights_time > 0.0f) {
+        if (!transitioning) {
+            transitioning = true;
+            front_rear_animate(leds, animation_time);
+        }
+
         led_strip_transition(
             leds,
             &leds->headlights_trans,
@@ -968,6 +1026,7 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
         }
     }
 
+    bool dirty = false;
     if (leds->status_strip.length > 0) {
         float idle_timeout = leds->cfg->status.idle_timeout;
         if (idle_timeout > 0.0f && current_time - leds->status_idle_time > idle_timeout) {
@@ -979,10 +1038,21 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
             rate_limitf(&leds->status_idle_blend, 0.0f, BR_RATE);
         }
 
-        status_animate(leds, &leds->status_strip, current_time, 1.0f, leds->status_idle_blend);
+        LedStripInputs status_in = bar_inputs(leds, &leds->status_strip, NULL);
+        status_update(
+            leds, &leds->status_strip, current_time, 1.0f, leds->status_idle_blend, &status_in
+        );
+
+        bool animated = status_in.bar && bar_animated(status_in.bar);
+        if (strip_dirty(leds, &leds->status_strip, &status_in, animated)) {
+            status_animate(leds, &leds->status_strip, current_time, &status_in);
+            dirty = true;
+        }
     }
 
-    if (leds->cfg->status_on_front_when_lifted && leds->status_on_front_blend > 0.0f) {
+    bool front_status =
+        leds->cfg->status_on_front_when_lifted && leds->status_on_front_blend > 0.0f;
+    if (front_status) {
         if (leds->cfg->lights_off_when_lifted &&
             current_time - leds->status_on_front_idle_time > 3.0f) {
             rate_limitf(&leds->status_on_front_idle_blend, 1.0f, BR_RATE);
@@ -990,16 +1060,41 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
             rate_limitf(&leds->status_on_front_idle_blend, 0.0f, BR_RATE);
         }
 
-        status_animate(
+        status_update(
             leds,
             &leds->front_strip,
             current_time,
             leds->status_on_front_blend,
-            leds->status_on_front_idle_blend
+            leds->status_on_front_idle_blend,
+            &front_in
         );
     }
 
-    led_driver_paint(&leds->led_driver, leds->led_data, leds->led_count);
+    bool animated = transitioning || bar_animated(front_in.bar);
+    if (strip_dirty(leds, &leds->front_strip, &front_in, animated)) {
+        if (!transitioning) {
+            led_strip_animate(leds, &leds->front_strip, front_in.bar, animation_time);
+        }
+        if (front_status) {
+            status_animate(leds, &leds->front_strip, current_time, &front_in);
+        }
+        dirty = true;
+    }
+
+    animated = transitioning || bar_animated(rear_in.bar);
+    if (strip_dirty(leds, &leds->rear_strip, &rear_in, animated)) {
+        if (!transitioning) {
+            led_strip_animate(leds, &leds->rear_strip, rear_in.bar, animation_time);
+        }
+        dirty = true;
+    }
+
+    if (dirty) {
+        led_driver_paint(&leds->led_driver, leds->led_data, leds->led_count);
+        ++leds->frames_rendered;
+    } else {
+        ++leds->frames_skipped;
+    }
 }
 
 void leds_destroy(Leds *leds) {
@@ -1011,3 +1106,24 @@ void leds_destroy(Leds *leds) {
     }
     leds->led_count = 0;
 }
+
+void leds_cmd_stats(Leds *leds, uint8_t magic, uint8_t command, uint8_t *cfg, int len) {
+    uint8_t buffer[18];
+    int32_t ind = 0;
+
+    buffer[ind++] = magic;
+    buffer[ind++] = command;
+    buffer_append_uint32(buffer, leds->frames_rendered, &ind);
+    buffer_append_uint32(buffer, leds->frames_skipped, &ind);
+    buffer_append_uint32(buffer, leds->strips_rendered, &ind);
+    buffer_append_uint32(buffer, leds->strips_skipped, &ind);
+
+    VESC_IF->send_app_data(buffer, ind);
+
+    if (len >= 1 && cfg[0]) {
+        leds->frames_rendered = 0;
+        leds->frames_skipped = 0;
+        leds->strips_rendered = 0;
+        leds->strips_skipped = 0;
+    }
+}
@@ -19,6 +19,7 @@
 
 #include "conf/datatypes.h"
 #include "footpad_sensor.h"
+#include "led_anim.h"
 #include "led_driver.h"
 #include "state.h"
 
@@ -39,12 +40,31 @@ typedef struct {
     float split;
 } TransitionState;
 
+// What a strip was rendered from, a static strip with the same inputs is
+// identical to its last render and isn't rendered again
+typedef struct {
+    bool valid;
+    const LedBar *bar;
+    float brightness;
+    float on_off_fade;
+    // The status bar, on the status strip or on the front one
+    float status_blend;
+    float idle_blend;
+    float battery;
+    float duty;
+    float duty_blend;
+    float left_sensor;
+    float right_sensor;
+} LedStripInputs;
+
 typedef struct {
     uint8_t start;
     uint8_t length;
     bool reverse;
     float brightness;
     TransitionData trans_data;
+    LedStripInputs rendered;
+    LedAnimStrip anim;
 } LedStrip;
 
 typedef struct {
@@ -94,6 +114,14 @@ typedef struct {
     uint32_t *led_data;
     uint8_t led_count;
     LedDriver led_driver;
+
+    // Set by leds_configure, the bars may have changed under the same pointers
+    bool reconfigured;
+
+    uint32_t frames_rendered;
+    uint32_t frames_skipped;  // nothing changed, not painted
+    uint32_t strips_rendered;
+    uint32_t strips_skipped;
 } Leds;
 
 bool leds_init(Leds *leds, CfgHwLeds *hw_cfg, const CfgLeds *cfg, FootpadSensorState fs_state);
@@ -103,3 +131,13 @@ void leds_configure(Leds *leds, const CfgLeds *cfg);
 void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state);
 
 void leds_destroy(Leds *leds);
+
+/**
+ * Command reporting how many LED frames and strips were rendered and how many
+ * were skipped because nothing on them changed.
+ *
+ * Request: optional flag (uint8) to reset the counters after reading them.
+ * Response: frames rendered, frames skipped, strips rendered, strips skipped
+ * (uint32).
+ */
+void leds_cmd_stats(Leds *leds, uint8_t magic, uint8_t command, uint8_t *cfg, int len);
@@ -22,12 +22,18 @@
 #include "vesc_c_if.h"
 
 #include "atr.h"
+#include "blackbox.h"
 #include "charging.h"
+#include "config_store.h"
 #include "footpad_sensor.h"
+#include "imu_sync.h"
 #include "lcm.h"
 #include "leds.h"
+#include "loop_timing.h"
 #include "motor_data.h"
+#include "setpoint_pipeline.h"
 #include "state.h"
+#include "telemetry.h"
 #include "torque_tilt.h"
 #include "utils.h"
 
@@ -40,6 +46,7 @@
 #include "konami.h"
 
 #include <math.h>
+#include <stddef.h>
 #include <string.h>
 
 HEADER
@@ -58,6 +65,17 @@ typedef enum {
     BEEP_ERROR = 10
 } BeepReason;
 
+// A runtime tune: the complete config plus the current limits and the mode
+// the tune commands set outside of it.
+typedef struct {
+    RefloatConfig conf;
+    float mc_current_max, mc_current_min;
+    Mode mode;
+    // A config written from VESC Tool, everything is configured from scratch
+    // and the current limits come from the motor config
+    bool full;
+} Tune;
+
 static const FootpadSensorState flywheel_konami_sequence[] = {
     FS_LEFT, FS_NONE, FS_RIGHT, FS_NONE, FS_LEFT, FS_NONE, FS_RIGHT
 };
@@ -73,6 +91,14 @@ typedef struct {
 
     RefloatConfig float_conf;
 
+    // Runtime tuning: the tune commands and set_cfg() build a complete config
+    // in the shadow and publish it by setting tune_pending, the loop adopts it at the top of
+    // its next iteration and clears tune_pending. The shadow is only written
+    // while nothing is pending and only read while it is, so tune_pending is
+    // the only field shared between the threads (accessed atomically).
+    Tune tune_shadow;
+    Tune *tune_pending;
+
     // Firmware version, passed in from Lisp
     int fw_version_major, fw_version_minor, fw_version_beta;
 
@@ -95,7 +121,6 @@ typedef struct {
     Charging charging;
 
     // Config values
-    uint32_t loop_time_us;
     unsigned int start_counter_clicks, start_counter_clicks_max;
     float startup_pitch_trickmargin, startup_pitch_tolerance;
     float startup_step_size;
@@ -113,6 +138,21 @@ typedef struct {
     // IMU data for the balancing filter
     BalanceFilterData balance_filter;
 
+    // Loop pacing, optionally synchronized to the IMU samples
+    ImuSync imu_sync;
+
+    // Setpoint modifiers enabled by the config
+    SetpointPipeline setpoint_pipeline;
+
+    // Subscription telemetry, pushed from a thread of its own
+    Telemetry telemetry;
+
+    // Ring of the last loop iterations, frozen on a trigger
+    Blackbox blackbox;
+
+    // Per-stage cost of the loop, only collected when built with LOOP_TIMING
+    LoopTiming loop_timing;
+
     // Runtime values read from elsewhere
     float pitch, roll;
     float balance_pitch;
@@ -190,7 +230,10 @@ typedef struct {
 static void brake(data *d);
 static void set_current(data *d, float current);
 static void flywheel_stop(data *d);
-static void cmd_flywheel_toggle(data *d, unsigned char *cfg, int len);
+static void read_cfg_from_eeprom(RefloatConfig *config);
+static bool flywheel_start(data *d, int command);
+static void flywheel_configure(RefloatConfig *conf, unsigned char *cfg, int len);
+static void compile_setpoint_pipeline(data *d);
 
 const VESC_PIN beeper_pin = VESC_PIN_PPM;
 
@@ -256,22 +299,14 @@ static void reconfigure(data *d) {
     balance_filter_configure(&d->balance_filter, &d->float_conf);
     torque_tilt_configure(&d->torque_tilt, &d->float_conf);
     atr_configure(&d->atr, &d->float_conf);
+    compile_setpoint_pipeline(d);
 }
 
-static void configure(data *d) {
-    state_init(&d->state, d->float_conf.disabled);
-
-    lcm_configure(&d->lcm, &d->float_conf.leds);
-
-    // This timer is used to determine how long the board has been disengaged / idle
-    d->disengage_timer = d->current_time;
-
-    // Loop time in microseconds
-    d->loop_time_us = 1e6 / d->float_conf.hertz;
-
-    // Loop time in seconds times 20 for a nice long grace period
-    d->motor_timeout_s = 20.0f / d->float_conf.hertz;
-
+/**
+ * Derives the values computed from the parts of the config the runtime tune
+ * commands can change.
+ */
+static void configure_tunables(data *d) {
     d->startup_step_size = d->float_conf.startup_speed / d->float_conf.hertz;
     d->tiltback_duty_step_size = d->float_conf.tiltback_duty_speed / d->float_conf.hertz;
     d->tiltback_hv_step_size = d->float_conf.tiltback_hv_speed / d->float_conf.hertz;
@@ -286,12 +321,52 @@ static void configure(data *d) {
     d->surge_angle3 = d->float_conf.surge_angle * 3;
     d->surge_enable = d->surge_angle > 0;
 
+    // Feature: Dirty Landings
+    d->startup_pitch_trickmargin = d->float_conf.startup_dirtylandings_enabled ? 10 : 0;
+
+    // Feature: Turntilt
+    d->yaw_aggregate_target = fmaxf(50, d->float_conf.turntilt_yaw_aggregate);
+    d->turntilt_boost_per_erpm = (float) d->float_conf.turntilt_erpm_boost / 100.0 /
+        (float) d->float_conf.turntilt_erpm_boost_end;
+
+    // Variable nose angle adjustment / tiltback (setting is per 1000erpm, convert to per erpm)
+    d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
+    if (d->tiltback_variable > 0) {
+        d->tiltback_variable_max_erpm =
+            fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
+    } else {
+        d->tiltback_variable_max_erpm = 100000;
+    }
+
+    // Feature: Flywheel, full variable tiltback right away
+    if (d->state.mode == MODE_FLYWHEEL) {
+        d->tiltback_variable_max_erpm = 0;
+    }
+
+    d->beeper_enabled = d->float_conf.is_beeper_enabled;
+
+    reconfigure(d);
+}
+
+static void configure(data *d) {
+    state_init(&d->state, d->float_conf.disabled);
+
+    lcm_configure(&d->lcm, &d->float_conf.leds);
+
+    footpad_sensor_configure(&d->footpad_sensor, &d->float_conf);
+
+    // This timer is used to determine how long the board has been disengaged / idle
+    d->disengage_timer = d->current_time;
+
+    imu_sync_configure(&d->imu_sync, d->float_conf.loop_imu_sync, d->float_conf.hertz);
+
+    // Loop time in seconds times 20 for a nice long grace period
+    d->motor_timeout_s = 20.0f / d->float_conf.hertz;
+
     // Feature: Stealthy start vs normal start (noticeable click when engaging) - 0-20A
     d->start_counter_clicks_max = 3;
     // Feature: Soft Start
     d->softstart_ramp_step_size = (float) 100 / d->float_conf.hertz;
-    // Feature: Dirty Landings
-    d->startup_pitch_trickmargin = d->float_conf.startup_dirtylandings_enabled ? 10 : 0;
 
     // Backwards compatibility hack:
     // If mahony kp from the firmware internal filter is higher than 1, it's
@@ -318,11 +393,6 @@ static void configure(data *d) {
     d->reverse_tolerance = 50000;
     d->reverse_stop_step_size = 100.0 / d->float_conf.hertz;
 
-    // Feature: Turntilt
-    d->yaw_aggregate_target = fmaxf(50, d->float_conf.turntilt_yaw_aggregate);
-    d->turntilt_boost_per_erpm = (float) d->float_conf.turntilt_erpm_boost / 100.0 /
-        (float) d->float_conf.turntilt_erpm_boost_end;
-
     // Feature: Darkride
     d->enable_upside_down = false;
     d->darkride_setpoint_correction = d->float_conf.dark_pitch_offset;
@@ -336,20 +406,9 @@ static void configure(data *d) {
     // Speed above which to warn users about an impending full switch fault
     d->switch_warn_beep_erpm = d->float_conf.is_footbeep_enabled ? 2000 : 100000;
 
-    // Variable nose angle adjustment / tiltback (setting is per 1000erpm, convert to per erpm)
-    d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
-    if (d->tiltback_variable > 0) {
-        d->tiltback_variable_max_erpm =
-            fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
-    } else {
-        d->tiltback_variable_max_erpm = 100000;
-    }
-
-    d->beeper_enabled = d->float_conf.is_beeper_enabled;
-
     konami_init(&d->flywheel_konami, flywheel_konami_sequence, sizeof(flywheel_konami_sequence));
 
-    reconfigure(d);
+    configure_tunables(d);
 
     if (d->state.state == STATE_DISABLED) {
         beep_alert(d, 3, false);
@@ -358,6 +417,83 @@ static void configure(data *d) {
     }
 }
 
+/**
+ * Waits for the loop to adopt the previously published tune, so that the
+ * shadow can be reused and a new tune builds on the config the loop runs.
+ */
+static bool tune_wait(data *d) {
+    for (int i = 0; __atomic_load_n(&d->tune_pending, __ATOMIC_ACQUIRE); ++i) {
+        if (i >= 1000) {
+            return false;
+        }
+        VESC_IF->sleep_us(100);
+    }
+    return true;
+}
+
+/**
+ * Starts a runtime tune from the current config. Returns the shadow to
+ * modify, NULL if the loop hasn't picked up the previous tune in 100ms.
+ */
+static Tune *tune_begin(data *d) {
+    if (!tune_wait(d)) {
+        log_error("Previous tune not applied yet, dropping tune.");
+        return NULL;
+    }
+
+    Tune *tune = &d->tune_shadow;
+    tune->conf = d->float_conf;
+    tune->mc_current_max = d->mc_current_max;
+    tune->mc_current_min = d->mc_current_min;
+    tune->mode = d->state.mode;
+    tune->full = false;
+    return tune;
+}
+
+static void tune_publish(data *d, Tune *tune) {
+    __atomic_store_n(&d->tune_pending, tune, __ATOMIC_RELEASE);
+}
+
+/**
+ * Called by the loop at the top of every iteration, adopts a published tune
+ * together with all the values derived from it, so the loop never runs on a
+ * partially applied one.
+ */
+static void tune_adopt(data *d) {
+    Tune *tune = __atomic_load_n(&d->tune_pending, __ATOMIC_ACQUIRE);
+    if (!tune) {
+        return;
+    }
+
+    d->float_conf = tune->conf;
+    if (tune->full) {
+        configure(d);
+    } else {
+        d->mc_current_max = tune->mc_current_max;
+        d->mc_current_min = tune->mc_current_min;
+        d->state.mode = tune->mode;
+        configure_tunables(d);
+    }
+
+    __atomic_store_n(&d->tune_pending, NULL, __ATOMIC_RELEASE);
+}
+
+/**
+ * Publishes the config stored in EEPROM as a full tune, dropping all runtime
+ * changes and leaving the special modes.
+ */
+static bool tune_reload(data *d) {
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return false;
+    }
+
+    read_cfg_from_eeprom(&tune->conf);
+    tune->full = true;
+    tune_publish(d, tune);
+    return true;
+}
+
 static void reset_vars(data *d) {
     motor_data_reset(&d->motor);
     atr_reset(&d->atr);
@@ -847,33 +983,31 @@ static void calculate_setpoint_interpolated(data *d) {
 }
 
 static void add_surge(data *d) {
-    if (d->surge_enable) {
-        float surge_now = 0;
-
-        if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.04) {
-            surge_now = d->surge_angle3;
-            beep_alert(d, 3, 1);
-        } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.02) {
-            surge_now = d->surge_angle2;
-            beep_alert(d, 2, 1);
-        } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start) {
-            surge_now = d->surge_angle;
-            beep_alert(d, 1, 1);
-        }
-        if (surge_now >= d->surge_adder) {
-            // kick in instantly
-            d->surge_adder = surge_now;
-        } else {
-            // release less harshly
-            d->surge_adder = d->surge_adder * 0.98 + surge_now * 0.02;
-        }
+    float surge_now = 0;
+
+    if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.04) {
+        surge_now = d->surge_angle3;
+        beep_alert(d, 3, 1);
+    } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.02) {
+        surge_now = d->surge_angle2;
+        beep_alert(d, 2, 1);
+    } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start) {
+        surge_now = d->surge_angle;
+        beep_alert(d, 1, 1);
+    }
+    if (surge_now >= d->surge_adder) {
+        // kick in instantly
+        d->surge_adder = surge_now;
+    } else {
+        // release less harshly
+        d->surge_adder = d->surge_adder * 0.98 + surge_now * 0.02;
+    }
 
-        // Add surge angle to setpoint
-        if (d->motor.erpm > 0) {
-            d->setpoint += d->surge_adder;
-        } else {
-            d->setpoint -= d->surge_adder;
-        }
+    // Add surge angle to setpoint
+    if (d->motor.erpm > 0) {
+        d->setpoint += d->surge_adder;
+    } else {
+        d->setpoint -= d->surge_adder;
     }
 }
 
@@ -959,10 +1093,6 @@ static void apply_inputtilt(data *d) {
 }
 
 static void apply_turntilt(data *d) {
-    if (d->float_conf.turntilt_strength == 0) {
-        return;
-    }
-
     float abs_yaw_aggregate = fabsf(d->yaw_aggregate);
 
     // incremental turn increment since the last iteration
@@ -1040,6 +1170,135 @@ static void apply_turntilt(data *d) {
     d->setpoint += d->turntilt_interpolated;
 }
 
+// Setpoint modifier stages, in the order they're applied after the setpoint
+// target interpolation. Stages which are off in the config are not run at all,
+// see compile_setpoint_pipeline().
+typedef enum {
+    SETPOINT_STAGE_SURGE = 0,
+    SETPOINT_STAGE_INPUTTILT,
+    SETPOINT_STAGE_NOSEANGLING,
+    SETPOINT_STAGE_TURNTILT,
+    SETPOINT_STAGE_TORQUETILT,
+    SETPOINT_STAGE_ATR,
+    SETPOINT_STAGE_COUNT
+} SetpointStageId;
+
+static void stage_surge(void *arg) {
+    add_surge(arg);
+}
+
+static void stage_inputtilt(void *arg) {
+    // Allow Input Tilt for Darkride
+    apply_inputtilt(arg);
+}
+
+static bool inputtilt_settled(const void *arg) {
+    const data *d = arg;
+    return d->inputtilt_interpolated == 0;
+}
+
+static void stage_noseangling(void *arg) {
+    data *d = arg;
+    if (!d->state.darkride && !d->state.wheelslip) {
+        apply_noseangling(d);
+    }
+}
+
+static bool noseangling_settled(const void *arg) {
+    const data *d = arg;
+    return d->noseangling_interpolated == 0;
+}
+
+static void stage_turntilt(void *arg) {
+    data *d = arg;
+    if (!d->state.darkride && !d->state.wheelslip) {
+        apply_turntilt(d);
+    }
+}
+
+static void stage_torque_tilt(void *arg) {
+    data *d = arg;
+    if (d->state.darkride) {
+        return;
+    }
+
+    // in case of wheelslip, don't change torque tilts, instead slightly decrease each cycle
+    if (d->state.wheelslip) {
+        torque_tilt_winddown(&d->torque_tilt);
+    } else {
+        torque_tilt_update(&d->torque_tilt, &d->motor, &d->float_conf);
+    }
+}
+
+static bool torque_tilt_settled(const void *arg) {
+    const data *d = arg;
+    return d->torque_tilt.offset == 0;
+}
+
+static void stage_atr(void *arg) {
+    data *d = arg;
+    if (d->state.darkride) {
+        return;
+    }
+
+    if (d->state.wheelslip) {
+        atr_and_braketilt_winddown(&d->atr);
+    } else {
+        atr_and_braketilt_update(&d->atr, &d->motor, &d->float_conf, d->proportional);
+    }
+}
+
+static bool atr_settled(const void *arg) {
+    const data *d = arg;
+    // turntilt reads the ATR target too
+    return d->atr.offset == 0 && d->atr.target_offset == 0 && d->atr.braketilt_offset == 0;
+}
+
+static const SetpointStage setpoint_stages[SETPOINT_STAGE_COUNT] = {
+    [SETPOINT_STAGE_SURGE] = {stage_surge, NULL},
+    [SETPOINT_STAGE_INPUTTILT] = {stage_inputtilt, inputtilt_settled},
+    [SETPOINT_STAGE_NOSEANGLING] = {stage_noseangling, noseangling_settled},
+    [SETPOINT_STAGE_TURNTILT] = {stage_turntilt, NULL},
+    [SETPOINT_STAGE_TORQUETILT] = {stage_torque_tilt, torque_tilt_settled},
+    [SETPOINT_STAGE_ATR] = {stage_atr, atr_settled},
+};
+
+/**
+ * Enables the setpoint stages whose config can make them contribute anything.
+ * Needs to be called whenever the config of any of them changes. Only
+ * requests the new run list, the loop compiles it between its iterations, so
+ * this is safe from the command handlers.
+ */
+static void compile_setpoint_pipeline(data *d) {
+    const RefloatConfig *cfg = &d->float_conf;
+    uint32_t enabled = 0;
+
+    if (d->surge_enable) {
+        enabled |= 1u << SETPOINT_STAGE_SURGE;
+    }
+    if (cfg->inputtilt_remote_type != INPUTTILT_NONE && cfg->inputtilt_angle_limit != 0) {
+        enabled |= 1u << SETPOINT_STAGE_INPUTTILT;
+    }
+    // Variable tiltback adds at most tiltback_variable_max, and that only past
+    // tiltback_variable_max_erpm (which flywheel mode sets to 0)
+    bool variable_tiltback = cfg->tiltback_variable_max != 0 &&
+        (d->tiltback_variable != 0 || d->tiltback_variable_max_erpm < 100000);
+    if (variable_tiltback || cfg->tiltback_constant != 0) {
+        enabled |= 1u << SETPOINT_STAGE_NOSEANGLING;
+    }
+    if (cfg->turntilt_strength != 0) {
+        enabled |= 1u << SETPOINT_STAGE_TURNTILT;
+    }
+    if (cfg->torquetilt_strength != 0 || cfg->torquetilt_strength_regen != 0) {
+        enabled |= 1u << SETPOINT_STAGE_TORQUETILT;
+    }
+    if (cfg->atr_strength_up != 0 || cfg->atr_strength_down != 0 || d->atr.braketilt_factor != 0) {
+        enabled |= 1u << SETPOINT_STAGE_ATR;
+    }
+
+    setpoint_pipeline_request(&d->setpoint_pipeline, enabled);
+}
+
 static void brake(data *d) {
     // Brake timeout logic
     float brake_timeout_length = 1;  // Brake Timeout hard-coded to 1s
@@ -1066,6 +1325,56 @@ static void imu_ref_callback(float *acc, float *gyro, float *mag, float dt) {
 
     data *d = (data *) ARG;
     balance_filter_update(&d->balance_filter, gyro, acc, dt);
+    imu_sync_signal(&d->imu_sync, dt);
+}
+
+static void pack_state(const data *d, uint8_t *state, uint8_t *flags, uint8_t *sat) {
+    *state = d->state.mode << 4 | d->state.state;
+    *flags = d->footpad_sensor.state << 6 | d->state.charging << 5 | d->state.darkride << 1 |
+        d->state.wheelslip;
+    *sat = d->state.sat << 4 | d->state.stop_condition;
+}
+
+static void publish_telemetry(data *d) {
+    TelemetrySnapshot *s = telemetry_publish_begin(&d->telemetry);
+
+    pack_state(d, &s->state, &s->flags, &s->sat);
+
+    s->values[TELEMETRY_PITCH] = d->pitch;
+    s->values[TELEMETRY_BALANCE_PITCH] = d->balance_pitch;
+    s->values[TELEMETRY_ROLL] = d->roll;
+    s->values[TELEMETRY_SETPOINT] = d->setpoint;
+    s->values[TELEMETRY_ATR_OFFSET] = d->atr.offset;
+    s->values[TELEMETRY_BRAKETILT_OFFSET] = d->atr.braketilt_offset;
+    s->values[TELEMETRY_TORQUETILT_OFFSET] = d->torque_tilt.offset;
+    s->values[TELEMETRY_TURNTILT_OFFSET] = d->turntilt_interpolated;
+    s->values[TELEMETRY_INPUTTILT_OFFSET] = d->inputtilt_interpolated;
+    s->values[TELEMETRY_PID_VALUE] = d->pid_value;
+    s->values[TELEMETRY_BOOSTER_CURRENT] = d->applied_booster_current;
+    s->values[TELEMETRY_MOTOR_CURRENT] = d->motor.current;
+    s->values[TELEMETRY_FILTERED_CURRENT] = d->motor.atr_filtered_current;
+    s->values[TELEMETRY_ERPM] = d->motor.erpm;
+    s->values[TELEMETRY_DUTY_CYCLE] = d->motor.duty_cycle;
+    s->values[TELEMETRY_FOOTPAD_ADC1] = d->footpad_sensor.adc1;
+    s->values[TELEMETRY_FOOTPAD_ADC2] = d->footpad_sensor.adc2;
+    s->values[TELEMETRY_THROTTLE] = d->throttle_val;
+    s->values[TELEMETRY_ACCEL_DIFF] = d->atr.accel_diff;
+
+    telemetry_publish_end(&d->telemetry);
+}
+
+static void record_blackbox(data *d) {
+    BlackboxSample s;
+    pack_state(d, &s.state, &s.flags, &s.sat);
+
+    s.values[BLACKBOX_PITCH] = d->pitch;
+    s.values[BLACKBOX_BALANCE_PITCH] = d->balance_pitch;
+    s.values[BLACKBOX_SETPOINT] = d->setpoint;
+    s.values[BLACKBOX_PID_VALUE] = d->pid_value;
+    s.values[BLACKBOX_MOTOR_CURRENT] = d->motor.current;
+    s.values[BLACKBOX_ERPM] = d->motor.erpm;
+
+    blackbox_record(&d->blackbox, &s, &d->state);
 }
 
 static void refloat_thd(void *arg) {
@@ -1074,6 +1383,11 @@ static void refloat_thd(void *arg) {
     configure(d);
 
     while (!VESC_IF->should_terminate()) {
+        imu_sync_iteration_start(&d->imu_sync);
+        LOOP_TIMING_BEGIN(&d->loop_timing);
+        tune_adopt(d);
+        setpoint_pipeline_adopt(&d->setpoint_pipeline, d);
+
         beeper_update(d);
 
         charging_timeout(&d->charging, &d->state);
@@ -1115,8 +1429,10 @@ static void refloat_thd(void *arg) {
         }
 
         VESC_IF->imu_get_gyro(d->gyro);
+        LOOP_TIMING_MARK(&d->loop_timing, LOOP_STAGE_IMU);
 
         motor_data_update(&d->motor);
+        LOOP_TIMING_MARK(&d->loop_timing, LOOP_STAGE_MOTOR_DATA);
 
         bool remote_connected = false;
         float servo_val = 0;
@@ -1180,7 +1496,7 @@ static void refloat_thd(void *arg) {
             d->yaw_aggregate += d->yaw_change;
         }
 
-        footpad_sensor_update(&d->footpad_sensor, &d->float_conf);
+        footpad_sensor_update(&d->footpad_sensor, d->current_time);
 
         if (d->footpad_sensor.state == FS_NONE && d->state.state == STATE_RUNNING &&
             d->state.mode != MODE_FLYWHEEL && d->motor.abs_erpm > d->switch_warn_beep_erpm) {
@@ -1237,23 +1553,13 @@ static void refloat_thd(void *arg) {
 
             // Calculate setpoint and interpolation
             calculate_setpoint_target(d);
+            // The inputs, faults and the wheelslip detection
+            LOOP_TIMING_MARK(&d->loop_timing, LOOP_STAGE_TRACTION);
+
             calculate_setpoint_interpolated(d);
             d->setpoint = d->setpoint_target_interpolated;
-            add_surge(d);
-            apply_inputtilt(d);  // Allow Input Tilt for Darkride
+            setpoint_pipeline_run(&d->setpoint_pipeline, d);
             if (!d->state.darkride) {
-                // in case of wheelslip, don't change torque tilts, instead slightly decrease each
-                // cycle
-                if (d->state.wheelslip) {
-                    torque_tilt_winddown(&d->torque_tilt);
-                    atr_and_braketilt_winddown(&d->atr);
-                } else {
-                    apply_noseangling(d);
-                    apply_turntilt(d);
-                    torque_tilt_update(&d->torque_tilt, &d->motor, &d->float_conf);
-                    atr_and_braketilt_update(&d->atr, &d->motor, &d->float_conf, d->proportional);
-                }
-
                 // aggregated torque tilts:
                 // if signs match between torque tilt and ATR + brake tilt, use the more significant
                 // one if signs do not match, they are simply added together
@@ -1266,6 +1572,9 @@ static void refloat_thd(void *arg) {
                 }
             }
 
+            // All of the setpoint modifiers, surge among them
+            LOOP_TIMING_MARK(&d->loop_timing, LOOP_STAGE_SURGE);
+
             // Prepare Brake Scaling (ramp scale values as needed for smooth transitions)
             if (d->motor.abs_erpm < 500) {
                 // All scaling should roll back to 1.0x when near a stop for a smooth stand-still
@@ -1404,6 +1713,7 @@ static void refloat_thd(void *arg) {
             } else {
                 d->pid_value = d->pid_value * 0.8 + new_pid_value * 0.2;
             }
+            LOOP_TIMING_MARK(&d->loop_timing, LOOP_STAGE_PID);
 
             // Output to motor
             if (d->start_counter_clicks) {
@@ -1417,6 +1727,7 @@ static void refloat_thd(void *arg) {
             } else {
                 set_current(d, d->pid_value);
             }
+            LOOP_TIMING_MARK(&d->loop_timing, LOOP_STAGE_OUTPUT);
 
             break;
 
@@ -1428,10 +1739,15 @@ static void refloat_thd(void *arg) {
                 }
             }
 
-            if (d->state.mode != MODE_FLYWHEEL && d->pitch > 75 && d->pitch < 105) {
-                if (konami_check(&d->flywheel_konami, &d->footpad_sensor, d->current_time)) {
+            if (d->state.mode == MODE_NORMAL && d->pitch > 75 && d->pitch < 105) {
+                if (konami_check(&d->flywheel_konami, &d->footpad_sensor, d->current_time) &&
+                    flywheel_start(d, 2)) {
+                    // The loop owns the config, it doesn't go through a tune
                     unsigned char enabled[6] = {0x82, 0, 0, 0, 0, 1};
-                    cmd_flywheel_toggle(d, enabled, 6);
+                    flywheel_configure(&d->float_conf, enabled, 6);
+                    d->mc_current_max = d->mc_current_min = 40;
+                    d->state.mode = MODE_FLYWHEEL;
+                    configure_tunables(d);
                 }
             }
 
@@ -1510,36 +1826,23 @@ static void refloat_thd(void *arg) {
             break;
         }
 
-        VESC_IF->sleep_us(d->loop_time_us);
-    }
-}
-
-static void write_cfg_to_eeprom(data *d) {
-    uint32_t ints = sizeof(RefloatConfig) / 4 + 1;
-    uint32_t *buffer = VESC_IF->malloc(ints * sizeof(uint32_t));
-    if (!buffer) {
-        log_error("Failed to write config to EEPROM: Out of memory.");
-        return;
-    }
+        if (telemetry_active(&d->telemetry)) {
+            publish_telemetry(d);
+        }
 
-    bool write_ok = true;
-    memcpy(buffer, &(d->float_conf), sizeof(RefloatConfig));
-    for (uint32_t i = 0; i < ints; i++) {
-        eeprom_var v;
-        v.as_u32 = buffer[i];
-        if (!VESC_IF->store_eeprom_var(&v, i + 1)) {
-            write_ok = false;
-            break;
+        if (blackbox_active(&d->blackbox)) {
+            record_blackbox(d);
         }
-    }
+        LOOP_TIMING_END(&d->loop_timing);
 
-    VESC_IF->free(buffer);
+        imu_sync_wait(&d->imu_sync);
+    }
+}
 
-    if (write_ok) {
-        eeprom_var v;
-        v.as_u32 = REFLOATCONFIG_SIGNATURE;
-        VESC_IF->store_eeprom_var(&v, 0);
-    } else {
+static void write_cfg_to_eeprom(data *d) {
+    int32_t written =
+        config_store_write(&d->float_conf, sizeof(RefloatConfig), REFLOATCONFIG_SIGNATURE);
+    if (written < 0) {
         log_error("Failed to write config to EEPROM.");
     }
 
@@ -1550,45 +1853,142 @@ static void led_thd(void *arg) {
     data *d = (data *) arg;
 
     while (!VESC_IF->should_terminate()) {
+        float start = VESC_IF->system_time();
         leds_update(&d->leds, &d->state, d->footpad_sensor.state);
-        VESC_IF->sleep_us(1e6 / LEDS_REFRESH_RATE);
+
+        // The paint waits up to two frames on the strip for the swap, keep the rate
+        float remaining = 1.0f / LEDS_REFRESH_RATE - (VESC_IF->system_time() - start);
+        VESC_IF->sleep_us(fmaxf(remaining, 0.001f) * 1e6);
     }
 }
 
-static void read_cfg_from_eeprom(RefloatConfig *config) {
-    uint32_t ints = sizeof(RefloatConfig) / 4 + 1;
-    uint32_t *buffer = VESC_IF->malloc(ints * sizeof(uint32_t));
-    if (!buffer) {
-        log_error("Failed to read config from EEPROM: Out of memory.");
-        return;
+// A run of consecutive fields a previous config layout shares with the current
+// one. In the previous layout the runs follow each other, each aligned like
+// its first field, which needs to be the most aligned field of the run.
+typedef struct {
+    uint16_t offset;
+    uint16_t size;
+    uint8_t align;
+} ConfigRun;
+
+#define CONFIG_RUN(first, last)                                                                    \
+    {                                                                                              \
+        offsetof(RefloatConfig, first),                                                            \
+            offsetof(RefloatConfig, last) + sizeof(((RefloatConfig *) 0)->last) -                  \
+                offsetof(RefloatConfig, first),                                                    \
+            __alignof__(((RefloatConfig *) 0)->first)                                              \
     }
 
-    eeprom_var v;
-    bool read_ok = VESC_IF->read_eeprom_var(&v, 0);
-    if (read_ok) {
-        if (v.as_u32 == REFLOATCONFIG_SIGNATURE) {
-            for (uint32_t i = 0; i < ints; i++) {
-                if (!VESC_IF->read_eeprom_var(&v, i + 1)) {
-                    read_ok = false;
-                    break;
-                }
-                buffer[i] = v.as_u32;
-            }
-        } else {
-            log_error("Failed signature check while reading config from EEPROM, using defaults.");
-            confparser_set_defaults_refloatconfig(config);
-            return;
+#define CONFIG_LAYOUT_MAX_RUNS 4
+
+// A previous config layout, described by the fields it shares with the current
+// one. The fields it doesn't have get their defaults when migrating.
+typedef struct {
+    uint8_t run_count;
+    ConfigRun runs[CONFIG_LAYOUT_MAX_RUNS];
+} ConfigLayout;
+
+// Before the footpad sensor hysteresis, filter and debounce delays
+static const ConfigLayout config_layout_footpad_unfiltered = {
+    3,
+    {
+        CONFIG_RUN(version, fault_adc2),
+        CONFIG_RUN(fault_delay_pitch, fault_reversestop_enabled),
+        CONFIG_RUN(tiltback_duty_angle, hardware),
+    },
+};
+
+// Previous layouts to migrate from, NULL-terminated. The stored image size
+// tells them apart: the signatures of previous layouts come from vesc_tool and
+// can't be derived from here, and the CRC makes the size trustworthy. A layout
+// change that keeps the size can't be told apart from the previous layout and
+// needs its own migration key. Images in the previous store format, among them
+// all of the layout before loop_imu_sync, have no size and can't be migrated.
+static const ConfigLayout *const config_layouts[] = {
+    &config_layout_footpad_unfiltered,
+    NULL,
+};
+
+static uint32_t align_up(uint32_t offset, uint32_t align) {
+    return (offset + align - 1) / align * align;
+}
+
+// Image size of @p layout, padded like the struct it was
+static uint32_t layout_size(const ConfigLayout *layout) {
+    uint32_t size = 0;
+    for (uint8_t i = 0; i < layout->run_count; ++i) {
+        size = align_up(size, layout->runs[i].align) + layout->runs[i].size;
+    }
+    return align_up(size, __alignof__(RefloatConfig));
+}
+
+/**
+ * Migrates a config stored in a previous layout as described by @p header,
+ * filling the fields the layout doesn't have with their defaults.
+ */
+static bool migrate_cfg(RefloatConfig *config, const ConfigStoreHeader *header) {
+    const ConfigLayout *layout = NULL;
+    for (const ConfigLayout *const *l = config_layouts; *l; ++l) {
+        if (layout_size(*l) == header->size) {
+            layout = *l;
+            break;
         }
     }
+    if (!layout) {
+        return false;
+    }
 
-    if (read_ok) {
-        memcpy(config, buffer, sizeof(RefloatConfig));
-    } else {
+    uint8_t *image = VESC_IF->malloc(header->size);
+    if (!image) {
+        return false;
+    }
+
+    bool ok = config_store_read_layout(image, header->size, header) == CONFIG_STORE_OK;
+    if (ok) {
         confparser_set_defaults_refloatconfig(config);
+
+        uint32_t offset = 0;
+        for (uint8_t i = 0; i < layout->run_count; ++i) {
+            const ConfigRun *run = &layout->runs[i];
+            offset = align_up(offset, run->align);
+            memcpy((uint8_t *) config + run->offset, image + offset, run->size);
+            offset += run->size;
+        }
+    }
+
+    VESC_IF->free(image);
+    return ok;
+}
+
+static void read_cfg_from_eeprom(RefloatConfig *config) {
+    ConfigStoreHeader header;
+    ConfigStoreResult res =
+        config_store_read(config, sizeof(RefloatConfig), REFLOATCONFIG_SIGNATURE, &header);
+
+    switch (res) {
+    case CONFIG_STORE_OK:
+        return;
+    case CONFIG_STORE_EMPTY:
+        log_error("No config found in EEPROM, using defaults.");
+        break;
+    case CONFIG_STORE_CORRUPT:
         log_error("Failed to read config from EEPROM, using defaults.");
+        break;
+    case CONFIG_STORE_OTHER_LAYOUT:
+        if (migrate_cfg(config, &header)) {
+            log_msg("Migrated config in EEPROM from a previous layout (%u bytes).", header.size);
+            return;
+        }
+        // Also images in the previous format, whose size isn't stored
+        log_error(
+            "Config in EEPROM has a different layout (signature %u, %u bytes), using defaults.",
+            header.signature,
+            header.size
+        );
+        break;
     }
 
-    VESC_IF->free(buffer);
+    confparser_set_defaults_refloatconfig(config);
 }
 
 static void data_init(data *d) {
@@ -1600,6 +2000,7 @@ static void data_init(data *d) {
 
     lcm_init(&d->lcm, &d->float_conf.hardware.leds);
     charging_init(&d->charging);
+    footpad_sensor_init(&d->footpad_sensor);
 }
 
 static float app_get_debug(int index) {
@@ -1653,6 +2054,13 @@ enum {
     // commands above 200 are unstable and can change protocol at any time
     COMMAND_GET_RTDATA_2 = 201,
     COMMAND_LIGHTS_CONTROL = 202,
+    COMMAND_LOOP_STATS = 203,  // loop period and IMU sample age jitter
+    COMMAND_SETPOINT_PIPELINE = 204,  // setpoint modifier stages and their cost
+    COMMAND_TELEMETRY_SUBSCRIBE = 205,
+    COMMAND_TELEMETRY_FRAME = 206,  // pushed, never received
+    COMMAND_BLACKBOX = 207,  // loop iterations around a trigger, dumped in chunks
+    COMMAND_LED_STATS = 208,  // LED frames rendered and skipped
+    COMMAND_LOOP_TIMING = 209,  // per-stage loop cost, empty unless built with LOOP_TIMING
 } Commands;
 
 static void send_realtime_data(data *d) {
@@ -1816,75 +2224,89 @@ static void cmd_handtest(data *d, unsigned char *cfg) {
         return;
     }
 
-    d->state.mode = cfg[0] ? MODE_HANDTEST : MODE_NORMAL;
-    if (d->state.mode == MODE_HANDTEST) {
-        // temporarily reduce max currents to make hand test safer / gentler
-        d->mc_current_max = d->mc_current_min = 7;
-        // Disable I-term and all tune modifiers and tilts
-        d->float_conf.ki = 0;
-        d->float_conf.kp_brake = 1;
-        d->float_conf.kp2_brake = 1;
-        d->float_conf.brkbooster_angle = 100;
-        d->float_conf.booster_angle = 100;
-        d->float_conf.torquetilt_strength = 0;
-        d->float_conf.torquetilt_strength_regen = 0;
-        d->float_conf.atr_strength_up = 0;
-        d->float_conf.atr_strength_down = 0;
-        d->float_conf.turntilt_strength = 0;
-        d->float_conf.tiltback_constant = 0;
-        d->float_conf.tiltback_variable = 0;
-        d->float_conf.fault_delay_pitch = 50;
-        d->float_conf.fault_delay_roll = 50;
-    } else {
-        read_cfg_from_eeprom(&d->float_conf);
-        configure(d);
+    if (!cfg[0]) {
+        tune_reload(d);
+        return;
+    }
+
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
     }
+
+    tune->mode = MODE_HANDTEST;
+    // temporarily reduce max currents to make hand test safer / gentler
+    tune->mc_current_max = tune->mc_current_min = 7;
+    // Disable I-term and all tune modifiers and tilts
+    tune->conf.ki = 0;
+    tune->conf.kp_brake = 1;
+    tune->conf.kp2_brake = 1;
+    tune->conf.brkbooster_angle = 100;
+    tune->conf.booster_angle = 100;
+    tune->conf.torquetilt_strength = 0;
+    tune->conf.torquetilt_strength_regen = 0;
+    tune->conf.atr_strength_up = 0;
+    tune->conf.atr_strength_down = 0;
+    tune->conf.turntilt_strength = 0;
+    tune->conf.tiltback_constant = 0;
+    tune->conf.tiltback_variable = 0;
+    tune->conf.fault_delay_pitch = 50;
+    tune->conf.fault_delay_roll = 50;
+    tune_publish(d, tune);
 }
 
 static void cmd_experiment(data *d, unsigned char *cfg) {
-    d->surge_angle = cfg[0];
-    d->surge_angle /= 10;
-    d->float_conf.surge_duty_start = cfg[1];
-    d->float_conf.surge_duty_start /= 100;
-    if ((d->surge_angle > 1) || (d->float_conf.surge_duty_start < 0.85)) {
-        d->float_conf.surge_duty_start = 0.85;
-        d->surge_angle = 0.6;
-    } else {
-        d->surge_enable = true;
-        beep_alert(d, 2, 0);
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
     }
-    d->surge_angle2 = d->surge_angle * 2;
-    d->surge_angle3 = d->surge_angle * 3;
 
-    if (d->surge_angle == 0) {
-        d->surge_enable = false;
+    // Surge is enabled by a non-zero angle
+    float surge_angle = cfg[0];
+    surge_angle /= 10;
+    tune->conf.surge_duty_start = cfg[1];
+    tune->conf.surge_duty_start /= 100;
+    if ((surge_angle > 1) || (tune->conf.surge_duty_start < 0.85)) {
+        tune->conf.surge_duty_start = 0.85;
+        // Keep surge as enabled or disabled as it was
+        tune->conf.surge_angle = tune->conf.surge_angle > 0 ? 0.6 : 0;
+    } else {
+        tune->conf.surge_angle = surge_angle;
+        beep_alert(d, 2, 0);
     }
+    tune_publish(d, tune);
 }
 
 static void cmd_booster(data *d, unsigned char *cfg) {
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
+    }
+
     int h1, h2;
     split(cfg[0], &h1, &h2);
-    d->float_conf.booster_angle = h1 + 5;
-    d->float_conf.booster_ramp = h2 + 2;
+    tune->conf.booster_angle = h1 + 5;
+    tune->conf.booster_ramp = h2 + 2;
 
     split(cfg[1], &h1, &h2);
     if (h1 == 0) {
-        d->float_conf.booster_current = 0;
+        tune->conf.booster_current = 0;
     } else {
-        d->float_conf.booster_current = 8 + h1 * 2;
+        tune->conf.booster_current = 8 + h1 * 2;
     }
 
     split(cfg[2], &h1, &h2);
-    d->float_conf.brkbooster_angle = h1 + 5;
-    d->float_conf.brkbooster_ramp = h2 + 2;
+    tune->conf.brkbooster_angle = h1 + 5;
+    tune->conf.brkbooster_ramp = h2 + 2;
 
     split(cfg[3], &h1, &h2);
     if (h1 == 0) {
-        d->float_conf.brkbooster_current = 0;
+        tune->conf.brkbooster_current = 0;
     } else {
-        d->float_conf.brkbooster_current = 8 + h1 * 2;
+        tune->conf.brkbooster_current = 8 + h1 * 2;
     }
 
+    tune_publish(d, tune);
     beep_alert(d, 1, false);
 }
 
@@ -1892,224 +2314,220 @@ static void cmd_booster(data *d, unsigned char *cfg) {
  * cmd_runtime_tune		Extract tune info from 20byte message but don't write to EEPROM!
  */
 static void cmd_runtime_tune(data *d, unsigned char *cfg, int len) {
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
+    }
+
     int h1, h2;
     if (len >= 12) {
         split(cfg[0], &h1, &h2);
-        d->float_conf.kp = h1 + 15;
-        d->float_conf.kp2 = ((float) h2) / 10;
+        tune->conf.kp = h1 + 15;
+        tune->conf.kp2 = ((float) h2) / 10;
 
         split(cfg[1], &h1, &h2);
-        d->float_conf.ki = h1;
+        tune->conf.ki = h1;
         if (h1 == 1) {
-            d->float_conf.ki = 0.005;
+            tune->conf.ki = 0.005;
         } else if (h1 > 1) {
-            d->float_conf.ki = ((float) (h1 - 1)) / 100;
+            tune->conf.ki = ((float) (h1 - 1)) / 100;
         }
-        d->float_conf.ki_limit = h2 + 19;
+        tune->conf.ki_limit = h2 + 19;
         if (h2 == 0) {
-            d->float_conf.ki_limit = 0;
+            tune->conf.ki_limit = 0;
         }
 
         split(cfg[2], &h1, &h2);
-        d->float_conf.booster_angle = h1 + 5;
-        d->float_conf.booster_ramp = h2 + 2;
+        tune->conf.booster_angle = h1 + 5;
+        tune->conf.booster_ramp = h2 + 2;
 
         split(cfg[3], &h1, &h2);
         if (h1 == 0) {
-            d->float_conf.booster_current = 0;
+            tune->conf.booster_current = 0;
         } else {
-            d->float_conf.booster_current = 8 + h1 * 2;
+            tune->conf.booster_current = 8 + h1 * 2;
         }
-        d->float_conf.turntilt_strength = h2;
+        tune->conf.turntilt_strength = h2;
 
         split(cfg[4], &h1, &h2);
-        d->float_conf.turntilt_angle_limit = (h1 & 0x3) + 2;
-        d->float_conf.turntilt_start_erpm = (float) (h1 >> 2) * 500 + 1000;
-        d->float_conf.mahony_kp = ((float) h2) / 10 + 1.5;
+        tune->conf.turntilt_angle_limit = (h1 & 0x3) + 2;
+        tune->conf.turntilt_start_erpm = (float) (h1 >> 2) * 500 + 1000;
+        tune->conf.mahony_kp = ((float) h2) / 10 + 1.5;
 
         split(cfg[5], &h1, &h2);
         if (h1 == 0) {
-            d->float_conf.atr_strength_up = 0;
+            tune->conf.atr_strength_up = 0;
         } else {
-            d->float_conf.atr_strength_up = ((float) h1) / 10.0 + 0.5;
+            tune->conf.atr_strength_up = ((float) h1) / 10.0 + 0.5;
         }
         if (h2 == 0) {
-            d->float_conf.atr_strength_down = 0;
+            tune->conf.atr_strength_down = 0;
         } else {
-            d->float_conf.atr_strength_down = ((float) h2) / 10.0 + 0.5;
+            tune->conf.atr_strength_down = ((float) h2) / 10.0 + 0.5;
         }
 
         split(cfg[6], &h1, &h2);
-        d->float_conf.atr_speed_boost = ((float) (h2 * 5)) / 100;
+        tune->conf.atr_speed_boost = ((float) (h2 * 5)) / 100;
         if (h1 != 0) {
-            d->float_conf.atr_speed_boost *= -1;
+            tune->conf.atr_speed_boost *= -1;
         }
 
         split(cfg[7], &h1, &h2);
-        d->float_conf.atr_angle_limit = h1 + 5;
-        d->float_conf.atr_on_speed = (h2 & 0x3) + 3;
-        d->float_conf.atr_off_speed = (h2 >> 2) + 2;
+        tune->conf.atr_angle_limit = h1 + 5;
+        tune->conf.atr_on_speed = (h2 & 0x3) + 3;
+        tune->conf.atr_off_speed = (h2 >> 2) + 2;
 
         split(cfg[8], &h1, &h2);
-        d->float_conf.atr_response_boost = ((float) h1) / 10 + 1;
-        d->float_conf.atr_transition_boost = ((float) h2) / 5 + 1;
+        tune->conf.atr_response_boost = ((float) h1) / 10 + 1;
+        tune->conf.atr_transition_boost = ((float) h2) / 5 + 1;
 
         split(cfg[9], &h1, &h2);
-        d->float_conf.atr_amps_accel_ratio = h1 + 5;
-        d->float_conf.atr_amps_decel_ratio = h2 + 5;
+        tune->conf.atr_amps_accel_ratio = h1 + 5;
+        tune->conf.atr_amps_decel_ratio = h2 + 5;
 
         split(cfg[10], &h1, &h2);
-        d->float_conf.braketilt_strength = h1;
-        d->float_conf.braketilt_lingering = h2;
+        tune->conf.braketilt_strength = h1;
+        tune->conf.braketilt_lingering = h2;
 
         split(cfg[11], &h1, &h2);
-        d->mc_current_max = h1 * 5 + 55;
-        d->mc_current_min = h2 * 5 + 55;
+        tune->mc_current_max = h1 * 5 + 55;
+        tune->mc_current_min = h2 * 5 + 55;
         if (h1 == 0) {
-            d->mc_current_max = VESC_IF->get_cfg_float(CFG_PARAM_l_current_max);
+            tune->mc_current_max = VESC_IF->get_cfg_float(CFG_PARAM_l_current_max);
         }
         if (h2 == 0) {
-            d->mc_current_min = fabsf(VESC_IF->get_cfg_float(CFG_PARAM_l_current_min));
+            tune->mc_current_min = fabsf(VESC_IF->get_cfg_float(CFG_PARAM_l_current_min));
         }
-
-        d->turntilt_step_size = d->float_conf.turntilt_speed / d->float_conf.hertz;
     }
     if (len >= 16) {
         split(cfg[12], &h1, &h2);
         float thup = h1;
         float thdown = h2;
-        d->float_conf.atr_threshold_up = thup / 2;
-        d->float_conf.atr_threshold_down = thdown / 2;
+        tune->conf.atr_threshold_up = thup / 2;
+        tune->conf.atr_threshold_down = thdown / 2;
 
         split(cfg[13], &h1, &h2);
         float ttup = h1;
         float ttdn = h2;
-        d->float_conf.torquetilt_strength = ttup / 10 * 0.3;
-        d->float_conf.torquetilt_strength_regen = ttdn / 10 * 0.3;
+        tune->conf.torquetilt_strength = ttup / 10 * 0.3;
+        tune->conf.torquetilt_strength_regen = ttdn / 10 * 0.3;
 
         split(cfg[14], &h1, &h2);
         float maxangle = h1;
-        d->float_conf.torquetilt_start_current = h2 + 15;
-        d->float_conf.torquetilt_angle_limit = maxangle / 2;
+        tune->conf.torquetilt_start_current = h2 + 15;
+        tune->conf.torquetilt_angle_limit = maxangle / 2;
 
         split(cfg[15], &h1, &h2);
         float onspd = h1;
         float offspd = h2;
-        d->float_conf.torquetilt_on_speed = onspd / 2;
-        d->float_conf.torquetilt_off_speed = offspd + 3;
+        tune->conf.torquetilt_on_speed = onspd / 2;
+        tune->conf.torquetilt_off_speed = offspd + 3;
     }
     if (len >= 17) {
         split(cfg[16], &h1, &h2);
-        d->float_conf.kp_brake = ((float) h1 + 1) / 10;
-        d->float_conf.kp2_brake = ((float) h2) / 10;
+        tune->conf.kp_brake = ((float) h1 + 1) / 10;
+        tune->conf.kp2_brake = ((float) h2) / 10;
         beep_alert(d, 1, 1);
     }
 
-    reconfigure(d);
+    tune_publish(d, tune);
 }
 
 static void cmd_tune_defaults(data *d) {
-    d->float_conf.kp = CFG_DFLT_KP;
-    d->float_conf.kp2 = CFG_DFLT_KP2;
-    d->float_conf.ki = CFG_DFLT_KI;
-    d->float_conf.mahony_kp = CFG_DFLT_MAHONY_KP;
-    d->float_conf.mahony_kp_roll = CFG_DFLT_MAHONY_KP_ROLL;
-    d->float_conf.bf_accel_confidence_decay = CFG_DFLT_BF_ACCEL_CONFIDENCE_DECAY;
-    d->float_conf.kp_brake = CFG_DFLT_KP_BRAKE;
-    d->float_conf.kp2_brake = CFG_DFLT_KP2_BRAKE;
-    d->float_conf.ki_limit = CFG_DFLT_KI_LIMIT;
-    d->float_conf.booster_angle = CFG_DFLT_BOOSTER_ANGLE;
-    d->float_conf.booster_ramp = CFG_DFLT_BOOSTER_RAMP;
-    d->float_conf.booster_current = CFG_DFLT_BOOSTER_CURRENT;
-    d->float_conf.brkbooster_angle = CFG_DFLT_BRKBOOSTER_ANGLE;
-    d->float_conf.brkbooster_ramp = CFG_DFLT_BRKBOOSTER_RAMP;
-    d->float_conf.brkbooster_current = CFG_DFLT_BRKBOOSTER_CURRENT;
-    d->float_conf.turntilt_strength = CFG_DFLT_TURNTILT_STRENGTH;
-    d->float_conf.turntilt_angle_limit = CFG_DFLT_TURNTILT_ANGLE_LIMIT;
-    d->float_conf.turntilt_start_angle = CFG_DFLT_TURNTILT_START_ANGLE;
-    d->float_conf.turntilt_start_erpm = CFG_DFLT_TURNTILT_START_ERPM;
-    d->float_conf.turntilt_speed = CFG_DFLT_TURNTILT_SPEED;
-    d->float_conf.turntilt_erpm_boost = CFG_DFLT_TURNTILT_ERPM_BOOST;
-    d->float_conf.turntilt_erpm_boost_end = CFG_DFLT_TURNTILT_ERPM_BOOST_END;
-    d->float_conf.turntilt_yaw_aggregate = CFG_DFLT_TURNTILT_YAW_AGGREGATE;
-    d->float_conf.atr_strength_up = CFG_DFLT_ATR_UPHILL_STRENGTH;
-    d->float_conf.atr_strength_down = CFG_DFLT_ATR_DOWNHILL_STRENGTH;
-    d->float_conf.atr_threshold_up = CFG_DFLT_ATR_THRESHOLD_UP;
-    d->float_conf.atr_threshold_down = CFG_DFLT_ATR_THRESHOLD_DOWN;
-    d->float_conf.atr_speed_boost = CFG_DFLT_ATR_SPEED_BOOST;
-    d->float_conf.atr_angle_limit = CFG_DFLT_ATR_ANGLE_LIMIT;
-    d->float_conf.atr_on_speed = CFG_DFLT_ATR_ON_SPEED;
-    d->float_conf.atr_off_speed = CFG_DFLT_ATR_OFF_SPEED;
-    d->float_conf.atr_response_boost = CFG_DFLT_ATR_RESPONSE_BOOST;
-    d->float_conf.atr_transition_boost = CFG_DFLT_ATR_TRANSITION_BOOST;
-    d->float_conf.atr_filter = CFG_DFLT_ATR_FILTER;
-    d->float_conf.atr_amps_accel_ratio = CFG_DFLT_ATR_AMPS_ACCEL_RATIO;
-    d->float_conf.atr_amps_decel_ratio = CFG_DFLT_ATR_AMPS_DECEL_RATIO;
-    d->float_conf.braketilt_strength = CFG_DFLT_BRAKETILT_STRENGTH;
-    d->float_conf.braketilt_lingering = CFG_DFLT_BRAKETILT_LINGERING;
-
-    d->float_conf.startup_pitch_tolerance = CFG_DFLT_STARTUP_PITCH_TOLERANCE;
-    d->float_conf.startup_roll_tolerance = CFG_DFLT_STARTUP_ROLL_TOLERANCE;
-    d->float_conf.startup_speed = CFG_DFLT_STARTUP_SPEED;
-    d->float_conf.startup_click_current = CFG_DFLT_STARTUP_CLICK_CURRENT;
-    d->float_conf.brake_current = CFG_DFLT_BRAKE_CURRENT;
-    d->float_conf.is_beeper_enabled = CFG_DFLT_IS_BEEPER_ENABLED;
-    d->float_conf.tiltback_constant = CFG_DFLT_TILTBACK_CONSTANT;
-    d->float_conf.tiltback_constant_erpm = CFG_DFLT_TILTBACK_CONSTANT_ERPM;
-    d->float_conf.tiltback_variable = CFG_DFLT_TILTBACK_VARIABLE;
-    d->float_conf.tiltback_variable_max = CFG_DFLT_TILTBACK_VARIABLE_MAX;
-    d->float_conf.noseangling_speed = CFG_DFLT_NOSEANGLING_SPEED;
-    d->float_conf.startup_pushstart_enabled = CFG_DFLT_PUSHSTART_ENABLED;
-    d->float_conf.startup_simplestart_enabled = CFG_DFLT_SIMPLESTART_ENABLED;
-    d->float_conf.startup_dirtylandings_enabled = CFG_DFLT_DIRTYLANDINGS_ENABLED;
-
-    // Update values normally done in configure()
-    d->turntilt_step_size = d->float_conf.turntilt_speed / d->float_conf.hertz;
-
-    d->startup_step_size = d->float_conf.startup_speed / d->float_conf.hertz;
-    d->noseangling_step_size = d->float_conf.noseangling_speed / d->float_conf.hertz;
-    d->startup_pitch_trickmargin = d->float_conf.startup_dirtylandings_enabled ? 10 : 0;
-    d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
-    if (d->tiltback_variable > 0) {
-        d->tiltback_variable_max_erpm =
-            fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
-    } else {
-        d->tiltback_variable_max_erpm = 100000;
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
     }
 
-    reconfigure(d);
+    tune->conf.kp = CFG_DFLT_KP;
+    tune->conf.kp2 = CFG_DFLT_KP2;
+    tune->conf.ki = CFG_DFLT_KI;
+    tune->conf.mahony_kp = CFG_DFLT_MAHONY_KP;
+    tune->conf.mahony_kp_roll = CFG_DFLT_MAHONY_KP_ROLL;
+    tune->conf.bf_accel_confidence_decay = CFG_DFLT_BF_ACCEL_CONFIDENCE_DECAY;
+    tune->conf.kp_brake = CFG_DFLT_KP_BRAKE;
+    tune->conf.kp2_brake = CFG_DFLT_KP2_BRAKE;
+    tune->conf.ki_limit = CFG_DFLT_KI_LIMIT;
+    tune->conf.booster_angle = CFG_DFLT_BOOSTER_ANGLE;
+    tune->conf.booster_ramp = CFG_DFLT_BOOSTER_RAMP;
+    tune->conf.booster_current = CFG_DFLT_BOOSTER_CURRENT;
+    tune->conf.brkbooster_angle = CFG_DFLT_BRKBOOSTER_ANGLE;
+    tune->conf.brkbooster_ramp = CFG_DFLT_BRKBOOSTER_RAMP;
+    tune->conf.brkbooster_current = CFG_DFLT_BRKBOOSTER_CURRENT;
+    tune->conf.turntilt_strength = CFG_DFLT_TURNTILT_STRENGTH;
+    tune->conf.turntilt_angle_limit = CFG_DFLT_TURNTILT_ANGLE_LIMIT;
+    tune->conf.turntilt_start_angle = CFG_DFLT_TURNTILT_START_ANGLE;
+    tune->conf.turntilt_start_erpm = CFG_DFLT_TURNTILT_START_ERPM;
+    tune->conf.turntilt_speed = CFG_DFLT_TURNTILT_SPEED;
+    tune->conf.turntilt_erpm_boost = CFG_DFLT_TURNTILT_ERPM_BOOST;
+    tune->conf.turntilt_erpm_boost_end = CFG_DFLT_TURNTILT_ERPM_BOOST_END;
+    tune->conf.turntilt_yaw_aggregate = CFG_DFLT_TURNTILT_YAW_AGGREGATE;
+    tune->conf.atr_strength_up = CFG_DFLT_ATR_UPHILL_STRENGTH;
+    tune->conf.atr_strength_down = CFG_DFLT_ATR_DOWNHILL_STRENGTH;
+    tune->conf.atr_threshold_up = CFG_DFLT_ATR_THRESHOLD_UP;
+    tune->conf.atr_threshold_down = CFG_DFLT_ATR_THRESHOLD_DOWN;
+    tune->conf.atr_speed_boost = CFG_DFLT_ATR_SPEED_BOOST;
+    tune->conf.atr_angle_limit = CFG_DFLT_ATR_ANGLE_LIMIT;
+    tune->conf.atr_on_speed = CFG_DFLT_ATR_ON_SPEED;
+    tune->conf.atr_off_speed = CFG_DFLT_ATR_OFF_SPEED;
+    tune->conf.atr_response_boost = CFG_DFLT_ATR_RESPONSE_BOOST;
+    tune->conf.atr_transition_boost = CFG_DFLT_ATR_TRANSITION_BOOST;
+    tune->conf.atr_filter = CFG_DFLT_ATR_FILTER;
+    tune->conf.atr_amps_accel_ratio = CFG_DFLT_ATR_AMPS_ACCEL_RATIO;
+    tune->conf.atr_amps_decel_ratio = CFG_DFLT_ATR_AMPS_DECEL_RATIO;
+    tune->conf.braketilt_strength = CFG_DFLT_BRAKETILT_STRENGTH;
+    tune->conf.braketilt_lingering = CFG_DFLT_BRAKETILT_LINGERING;
+
+    tune->conf.startup_pitch_tolerance = CFG_DFLT_STARTUP_PITCH_TOLERANCE;
+    tune->conf.startup_roll_tolerance = CFG_DFLT_STARTUP_ROLL_TOLERANCE;
+    tune->conf.startup_speed = CFG_DFLT_STARTUP_SPEED;
+    tune->conf.startup_click_current = CFG_DFLT_STARTUP_CLICK_CURRENT;
+    tune->conf.brake_current = CFG_DFLT_BRAKE_CURRENT;
+    tune->conf.is_beeper_enabled = CFG_DFLT_IS_BEEPER_ENABLED;
+    tune->conf.tiltback_constant = CFG_DFLT_TILTBACK_CONSTANT;
+    tune->conf.tiltback_constant_erpm = CFG_DFLT_TILTBACK_CONSTANT_ERPM;
+    tune->conf.tiltback_variable = CFG_DFLT_TILTBACK_VARIABLE;
+    tune->conf.tiltback_variable_max = CFG_DFLT_TILTBACK_VARIABLE_MAX;
+    tune->conf.noseangling_speed = CFG_DFLT_NOSEANGLING_SPEED;
+    tune->conf.startup_pushstart_enabled = CFG_DFLT_PUSHSTART_ENABLED;
+    tune->conf.startup_simplestart_enabled = CFG_DFLT_SIMPLESTART_ENABLED;
+    tune->conf.startup_dirtylandings_enabled = CFG_DFLT_DIRTYLANDINGS_ENABLED;
+
+    tune_publish(d, tune);
 }
 
 /**
  * cmd_runtime_tune_tilt: Extract settings from 20byte message but don't write to EEPROM!
  */
 static void cmd_runtime_tune_tilt(data *d, unsigned char *cfg, int len) {
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
+    }
+
     unsigned int flags = cfg[0];
     bool duty_beep = flags & 0x1;
-    d->float_conf.is_dutybeep_enabled = duty_beep;
+    tune->conf.is_dutybeep_enabled = duty_beep;
     float retspeed = cfg[1];
     if (retspeed > 0) {
-        d->float_conf.tiltback_return_speed = retspeed / 10;
-        d->tiltback_return_step_size = d->float_conf.tiltback_return_speed / d->float_conf.hertz;
+        tune->conf.tiltback_return_speed = retspeed / 10;
     }
-    d->float_conf.tiltback_duty = (float) cfg[2] / 100.0;
-    d->float_conf.tiltback_duty_angle = (float) cfg[3] / 10.0;
-    d->float_conf.tiltback_duty_speed = (float) cfg[4] / 10.0;
+    tune->conf.tiltback_duty = (float) cfg[2] / 100.0;
+    tune->conf.tiltback_duty_angle = (float) cfg[3] / 10.0;
+    tune->conf.tiltback_duty_speed = (float) cfg[4] / 10.0;
 
     if (len >= 6) {
         float surge_duty_start = cfg[5];
         if (surge_duty_start > 0) {
-            d->float_conf.surge_duty_start = surge_duty_start / 100.0;
-            d->float_conf.surge_angle = (float) cfg[6] / 20.0;
-            d->surge_angle = d->float_conf.surge_angle;
-            d->surge_angle2 = d->float_conf.surge_angle * 2;
-            d->surge_angle3 = d->float_conf.surge_angle * 3;
-            d->surge_enable = d->surge_angle > 0;
+            tune->conf.surge_duty_start = surge_duty_start / 100.0;
+            tune->conf.surge_angle = (float) cfg[6] / 20.0;
         }
         beep_alert(d, 1, 1);
     } else {
         beep_alert(d, 3, 0);
     }
+
+    tune_publish(d, tune);
 }
 
 /**
@@ -2117,18 +2535,19 @@ static void cmd_runtime_tune_tilt(data *d, unsigned char *cfg, int len) {
  * EEPROM!
  */
 static void cmd_runtime_tune_other(data *d, unsigned char *cfg, int len) {
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
+    }
+
     unsigned int flags = cfg[0];
-    d->beeper_enabled = ((flags & 0x2) == 2);
-    d->float_conf.fault_reversestop_enabled = ((flags & 0x4) == 4);
-    d->float_conf.fault_is_dual_switch = ((flags & 0x8) == 8);
-    d->float_conf.fault_darkride_enabled = ((flags & 0x10) == 0x10);
-    bool dirty_landings = ((flags & 0x20) == 0x20);
-    d->float_conf.startup_simplestart_enabled = ((flags & 0x40) == 0x40);
-    d->float_conf.startup_pushstart_enabled = ((flags & 0x80) == 0x80);
-
-    d->float_conf.is_beeper_enabled = d->beeper_enabled;
-    d->startup_pitch_trickmargin = dirty_landings ? 10 : 0;
-    d->float_conf.startup_dirtylandings_enabled = dirty_landings;
+    tune->conf.is_beeper_enabled = ((flags & 0x2) == 2);
+    tune->conf.fault_reversestop_enabled = ((flags & 0x4) == 4);
+    tune->conf.fault_is_dual_switch = ((flags & 0x8) == 8);
+    tune->conf.fault_darkride_enabled = ((flags & 0x10) == 0x10);
+    tune->conf.startup_dirtylandings_enabled = ((flags & 0x20) == 0x20);
+    tune->conf.startup_simplestart_enabled = ((flags & 0x40) == 0x40);
+    tune->conf.startup_pushstart_enabled = ((flags & 0x80) == 0x80);
 
     // startup
     float ctrspeed = cfg[1];
@@ -2137,12 +2556,11 @@ static void cmd_runtime_tune_other(data *d, unsigned char *cfg, int len) {
     float brakecurrent = cfg[4];
     float clickcurrent = cfg[5];
 
-    d->startup_step_size = ctrspeed / d->float_conf.hertz;
-    d->float_conf.startup_speed = ctrspeed;
-    d->float_conf.startup_pitch_tolerance = pitchtolerance / 10;
-    d->float_conf.startup_roll_tolerance = rolltolerance;
-    d->float_conf.brake_current = brakecurrent / 2;
-    d->float_conf.startup_click_current = clickcurrent;
+    tune->conf.startup_speed = ctrspeed;
+    tune->conf.startup_pitch_tolerance = pitchtolerance / 10;
+    tune->conf.startup_roll_tolerance = rolltolerance;
+    tune->conf.brake_current = brakecurrent / 2;
+    tune->conf.startup_click_current = clickcurrent;
 
     // nose angling
     float tiltconst = cfg[6] - 100;
@@ -2152,38 +2570,28 @@ static void cmd_runtime_tune_other(data *d, unsigned char *cfg, int len) {
     float tiltvarmax = cfg[10];
 
     if (fabsf(tiltconst) <= 20) {
-        d->float_conf.tiltback_constant = tiltconst / 2;
-        d->float_conf.tiltback_constant_erpm = tilterpm;
+        tune->conf.tiltback_constant = tiltconst / 2;
+        tune->conf.tiltback_constant_erpm = tilterpm;
         if (tiltspeed > 0) {
-            d->noseangling_step_size = tiltspeed / 10 / d->float_conf.hertz;
-            d->float_conf.noseangling_speed = tiltspeed / 10;
-        }
-        d->float_conf.tiltback_variable = tiltvarrate / 100;
-        d->float_conf.tiltback_variable_max = tiltvarmax / 10;
-
-        d->startup_step_size = d->float_conf.startup_speed / d->float_conf.hertz;
-        d->noseangling_step_size = d->float_conf.noseangling_speed / d->float_conf.hertz;
-        d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
-        if (d->tiltback_variable > 0) {
-            d->tiltback_variable_max_erpm =
-                fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
-        } else {
-            d->tiltback_variable_max_erpm = 100000;
+            tune->conf.noseangling_speed = tiltspeed / 10;
         }
-        d->float_conf.tiltback_variable_erpm = cfg[11] * 100;
+        tune->conf.tiltback_variable = tiltvarrate / 100;
+        tune->conf.tiltback_variable_max = tiltvarmax / 10;
+        tune->conf.tiltback_variable_erpm = cfg[11] * 100;
     }
 
     if (len >= 14) {
         int inputtilt = cfg[12] & 0x3;
         if (inputtilt <= INPUTTILT_PPM) {
-            d->float_conf.inputtilt_remote_type = inputtilt;
+            tune->conf.inputtilt_remote_type = inputtilt;
             if (inputtilt > 0) {
-                d->float_conf.inputtilt_angle_limit = cfg[12] >> 2;
-                d->float_conf.inputtilt_speed = cfg[13];
-                d->inputtilt_step_size = d->float_conf.inputtilt_speed / d->float_conf.hertz;
+                tune->conf.inputtilt_angle_limit = cfg[12] >> 2;
+                tune->conf.inputtilt_speed = cfg[13];
             }
         }
     }
+
+    tune_publish(d, tune);
 }
 
 void cmd_rc_move(data *d, unsigned char *cfg) {
@@ -2214,6 +2622,101 @@ void cmd_rc_move(data *d, unsigned char *cfg) {
     }
 }
 
+/**
+ * Takes the flywheel pitch and roll offsets, returns false if the board isn't
+ * upright enough for an intentional flywheel start.
+ */
+static bool flywheel_start(data *d, int command) {
+    if ((d->flywheel_pitch_offset == 0) || (command == 2)) {
+        // accidental button press?? board isn't evn close to being upright
+        if (fabsf(d->pitch) < 70) {
+            return false;
+        }
+
+        d->flywheel_pitch_offset = d->pitch;
+        d->flywheel_roll_offset = d->roll;
+        beep_alert(d, 1, 1);
+    } else {
+        beep_alert(d, 3, 0);
+    }
+    d->flywheel_abort = false;
+
+    // Limit speed of wheel
+    VESC_IF->set_cfg_float(CFG_PARAM_l_min_erpm + 100, -6000);
+    VESC_IF->set_cfg_float(CFG_PARAM_l_max_erpm + 100, 6000);
+    return true;
+}
+
+/**
+ * Applies the flywheel settings of the flywheel command in @p cfg to @p conf,
+ * see cmd_flywheel_toggle().
+ */
+static void flywheel_configure(RefloatConfig *conf, unsigned char *cfg, int len) {
+    int command = cfg[0] & 0x7F;
+
+    // Tighter startup/fault tolerances
+    conf->startup_pitch_tolerance = 0.2;
+    conf->startup_roll_tolerance = 25;
+    conf->fault_pitch = 6;
+    conf->fault_roll = 35;  // roll can fluctuate significantly in the upright position
+    if (command & 0x4) {
+        conf->fault_roll = 90;
+    }
+    conf->fault_delay_pitch = 50;  // 50ms delay should help filter out IMU noise
+    conf->fault_delay_roll = 50;  // 50ms delay should help filter out IMU noise
+    conf->surge_angle = 0;
+
+    // Aggressive P with some D (aka Rate-P) for Mahony kp=0.3
+    conf->kp = 8.0;
+    conf->kp2 = 0.3;
+
+    if (cfg[1] > 0) {
+        conf->kp = cfg[1];
+        conf->kp /= 10;
+    }
+    if (cfg[2] > 0) {
+        conf->kp2 = cfg[2];
+        conf->kp2 /= 100;
+    }
+
+    conf->tiltback_duty_angle = 2;
+    conf->tiltback_duty = 0.1;
+    conf->tiltback_duty_speed = 5;
+    conf->tiltback_return_speed = 5;
+
+    if (cfg[3] > 0) {
+        conf->tiltback_duty_angle = cfg[3];
+        conf->tiltback_duty_angle /= 10;
+    }
+    if (cfg[4] > 0) {
+        conf->tiltback_duty = cfg[4];
+        conf->tiltback_duty /= 100;
+    }
+    if ((len > 6) && (cfg[6] > 1) && (cfg[6] < 100)) {
+        conf->tiltback_duty_speed = cfg[6] / 2;
+        conf->tiltback_return_speed = cfg[6] / 2;
+    }
+
+    // d->flywheel_allow_abort = cfg[5];
+
+    // Disable I-term and all tune modifiers and tilts
+    conf->ki = 0;
+    conf->kp_brake = 1;
+    conf->kp2_brake = 1;
+    conf->brkbooster_angle = 100;
+    conf->booster_angle = 100;
+    conf->torquetilt_strength = 0;
+    conf->torquetilt_strength_regen = 0;
+    conf->atr_strength_up = 0;
+    conf->atr_strength_down = 0;
+    conf->turntilt_strength = 0;
+    conf->tiltback_constant = 0;
+    conf->tiltback_variable = 0;
+    conf->brake_current = 0;
+    conf->fault_darkride_enabled = false;
+    conf->fault_reversestop_enabled = false;
+}
+
 static void cmd_flywheel_toggle(data *d, unsigned char *cfg, int len) {
     if ((cfg[0] & 0x80) == 0) {
         return;
@@ -2240,98 +2743,27 @@ static void cmd_flywheel_toggle(data *d, unsigned char *cfg, int len) {
     // Optional:
     // cfg[6]: Duty TB Speed in deg/sec
     int command = cfg[0] & 0x7F;
-    d->state.mode = command == 0 ? MODE_NORMAL : MODE_FLYWHEEL;
-    if (d->state.mode == MODE_FLYWHEEL) {
-        if ((d->flywheel_pitch_offset == 0) || (command == 2)) {
-            // accidental button press?? board isn't evn close to being upright
-            if (fabsf(d->pitch) < 70) {
-                d->state.mode = MODE_NORMAL;
-                return;
-            }
+    if (command == 0) {
+        if (tune_reload(d)) {
+            beep_on(d, 1);
+        }
+        return;
+    }
 
-            d->flywheel_pitch_offset = d->pitch;
-            d->flywheel_roll_offset = d->roll;
-            beep_alert(d, 1, 1);
-        } else {
-            beep_alert(d, 3, 0);
-        }
-        d->flywheel_abort = false;
-
-        // Tighter startup/fault tolerances
-        d->startup_pitch_tolerance = 0.2;
-        d->float_conf.startup_pitch_tolerance = 0.2;
-        d->float_conf.startup_roll_tolerance = 25;
-        d->float_conf.fault_pitch = 6;
-        d->float_conf.fault_roll = 35;  // roll can fluctuate significantly in the upright position
-        if (command & 0x4) {
-            d->float_conf.fault_roll = 90;
-        }
-        d->float_conf.fault_delay_pitch = 50;  // 50ms delay should help filter out IMU noise
-        d->float_conf.fault_delay_roll = 50;  // 50ms delay should help filter out IMU noise
-        d->surge_enable = false;
-
-        // Aggressive P with some D (aka Rate-P) for Mahony kp=0.3
-        d->float_conf.kp = 8.0;
-        d->float_conf.kp2 = 0.3;
-
-        if (cfg[1] > 0) {
-            d->float_conf.kp = cfg[1];
-            d->float_conf.kp /= 10;
-        }
-        if (cfg[2] > 0) {
-            d->float_conf.kp2 = cfg[2];
-            d->float_conf.kp2 /= 100;
-        }
-
-        d->float_conf.tiltback_duty_angle = 2;
-        d->float_conf.tiltback_duty = 0.1;
-        d->float_conf.tiltback_duty_speed = 5;
-        d->float_conf.tiltback_return_speed = 5;
-
-        if (cfg[3] > 0) {
-            d->float_conf.tiltback_duty_angle = cfg[3];
-            d->float_conf.tiltback_duty_angle /= 10;
-        }
-        if (cfg[4] > 0) {
-            d->float_conf.tiltback_duty = cfg[4];
-            d->float_conf.tiltback_duty /= 100;
-        }
-        if ((len > 6) && (cfg[6] > 1) && (cfg[6] < 100)) {
-            d->float_conf.tiltback_duty_speed = cfg[6] / 2;
-            d->float_conf.tiltback_return_speed = cfg[6] / 2;
-        }
-        d->tiltback_duty_step_size = d->float_conf.tiltback_duty_speed / d->float_conf.hertz;
-        d->tiltback_return_step_size = d->float_conf.tiltback_return_speed / d->float_conf.hertz;
-
-        // Limit speed of wheel and limit amps
-        VESC_IF->set_cfg_float(CFG_PARAM_l_min_erpm + 100, -6000);
-        VESC_IF->set_cfg_float(CFG_PARAM_l_max_erpm + 100, 6000);
-        d->mc_current_max = d->mc_current_min = 40;
-
-        // d->flywheel_allow_abort = cfg[5];
-
-        // Disable I-term and all tune modifiers and tilts
-        d->float_conf.ki = 0;
-        d->float_conf.kp_brake = 1;
-        d->float_conf.kp2_brake = 1;
-        d->float_conf.brkbooster_angle = 100;
-        d->float_conf.booster_angle = 100;
-        d->float_conf.torquetilt_strength = 0;
-        d->float_conf.torquetilt_strength_regen = 0;
-        d->float_conf.atr_strength_up = 0;
-        d->float_conf.atr_strength_down = 0;
-        d->float_conf.turntilt_strength = 0;
-        d->float_conf.tiltback_constant = 0;
-        d->float_conf.tiltback_variable = 0;
-        d->float_conf.brake_current = 0;
-        d->float_conf.fault_darkride_enabled = false;
-        d->float_conf.fault_reversestop_enabled = false;
-        d->float_conf.tiltback_constant = 0;
-        d->tiltback_variable_max_erpm = 0;
-        d->tiltback_variable = 0;
-    } else {
-        flywheel_stop(d);
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return;
+    }
+
+    if (!flywheel_start(d, command)) {
+        return;
     }
+
+    flywheel_configure(&tune->conf, cfg, len);
+    // Limit amps
+    tune->mc_current_max = tune->mc_current_min = 40;
+    tune->mode = MODE_FLYWHEEL;
+    tune_publish(d, tune);
 }
 
 void flywheel_stop(data *d) {
@@ -2510,6 +2942,8 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
         return;
     }
     case COMMAND_CFG_SAVE: {
+        // Save the tune that was just sent, not the one before it
+        tune_wait(d);
         write_cfg_to_eeprom(d);
         return;
     }
@@ -2587,6 +3021,34 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
         lights_control_response(&d->float_conf.leds);
         return;
     }
+    case COMMAND_LOOP_STATS: {
+        imu_sync_cmd_stats(&d->imu_sync, 101, COMMAND_LOOP_STATS, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_SETPOINT_PIPELINE: {
+        setpoint_pipeline_cmd_inspect(
+            &d->setpoint_pipeline, 101, COMMAND_SETPOINT_PIPELINE, &buffer[2], len - 2
+        );
+        return;
+    }
+    case COMMAND_TELEMETRY_SUBSCRIBE: {
+        telemetry_cmd_subscribe(
+            &d->telemetry, 101, COMMAND_TELEMETRY_SUBSCRIBE, &buffer[2], len - 2
+        );
+        return;
+    }
+    case COMMAND_BLACKBOX: {
+        blackbox_cmd(&d->blackbox, 101, COMMAND_BLACKBOX, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_LED_STATS: {
+        leds_cmd_stats(&d->leds, 101, COMMAND_LED_STATS, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_LOOP_TIMING: {
+        loop_timing_cmd_download(&d->loop_timing, 101, COMMAND_LOOP_TIMING, &buffer[2], len - 2);
+        return;
+    }
     default: {
         if (!VESC_IF->app_is_output_disabled()) {
             log_error("Unknown command received: %u", command);
@@ -2649,16 +3111,30 @@ static bool set_cfg(uint8_t *buffer) {
         return false;
     }
 
-    bool res = confparser_deserialize_refloatconfig(buffer, &d->float_conf);
+    // Goes through the loop like a runtime tune, so that it neither runs on a
+    // half deserialized config nor gets a pending tune adopted over it
+    Tune *tune = tune_begin(d);
+    if (!tune) {
+        return false;
+    }
 
-    // Store to EEPROM
-    if (res) {
-        write_cfg_to_eeprom(d);
-        configure(d);
-        leds_configure(&d->leds, &d->float_conf.leds);
+    bool res = confparser_deserialize_refloatconfig(buffer, &tune->conf);
+    if (!res) {
+        return false;
     }
 
-    return res;
+    tune->full = true;
+    tune_publish(d, tune);
+
+    // Store to EEPROM what the loop runs once it has adopted it
+    if (!tune_wait(d)) {
+        log_error("Config not applied yet, not writing it to EEPROM.");
+        return false;
+    }
+    write_cfg_to_eeprom(d);
+    leds_configure(&d->leds, &d->float_conf.leds);
+
+    return true;
 }
 
 static int get_cfg_xml(uint8_t **buffer) {
@@ -2682,6 +3158,8 @@ static void stop(void *arg) {
     if (d->main_thread) {
         VESC_IF->request_terminate(d->main_thread);
     }
+    telemetry_stop(&d->telemetry);
+    blackbox_free(&d->blackbox);
     log_msg("Terminating.");
     leds_destroy(&d->leds);
     VESC_IF->free(d);
@@ -2709,9 +3187,17 @@ INIT_FUN(lib_info *info) {
     }
 
     balance_filter_init(&d->balance_filter);
+    imu_sync_init(&d->imu_sync);
+    setpoint_pipeline_init(&d->setpoint_pipeline, setpoint_stages, SETPOINT_STAGE_COUNT);
+    blackbox_init(&d->blackbox);
+    loop_timing_reset(&d->loop_timing);
+    if (!telemetry_init(&d->telemetry, 101, COMMAND_TELEMETRY_FRAME)) {
+        log_error("Failed to spawn Refloat Telemetry thread.");
+    }
     VESC_IF->imu_set_read_callback(imu_ref_callback);
 
-    footpad_sensor_update(&d->footpad_sensor, &d->float_conf);
+    footpad_sensor_configure(&d->footpad_sensor, &d->float_conf);
+    footpad_sensor_update(&d->footpad_sensor, d->current_time);
 
     d->main_thread = VESC_IF->spawn(refloat_thd, 1024, "Refloat Main", d);
     if (!d->main_thread) {
@@ -0,0 +1,171 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "setpoint_pipeline.h"
+
+#include "conf/buffer.h"
+#include "loop_timing.h"
+
+#include "vesc_c_if.h"
+
+#include <string.h>
+
+// Marks a request in SetpointPipeline.requested, so that an empty mask can be
+// requested too
+#define REQUEST_PENDING (1u << 31)
+
+static void update_run_list(SetpointPipeline *p) {
+    p->run_count = 0;
+    p->draining = 0;
+    for (uint8_t i = 0; i < p->stage_count; ++i) {
+        if (p->status[i] != SETPOINT_STAGE_OFF) {
+            p->run[p->run_count++] = i;
+        }
+        if (p->status[i] == SETPOINT_STAGE_DRAINING) {
+            ++p->draining;
+        }
+    }
+}
+
+void setpoint_pipeline_init(SetpointPipeline *p, const SetpointStage *stages, uint8_t count) {
+    memset(p, 0, sizeof(SetpointPipeline));
+    p->stages = stages;
+    p->stage_count = count < SETPOINT_PIPELINE_MAX_STAGES ? count : SETPOINT_PIPELINE_MAX_STAGES;
+}
+
+void setpoint_pipeline_compile(SetpointPipeline *p, uint32_t enabled, const void *arg) {
+    for (uint8_t i = 0; i < p->stage_count; ++i) {
+        const SetpointStage *stage = &p->stages[i];
+        if (enabled & (1u << i)) {
+            p->status[i] = SETPOINT_STAGE_ON;
+        } else if (p->status[i] != SETPOINT_STAGE_OFF && stage->settled && !stage->settled(arg)) {
+            p->status[i] = SETPOINT_STAGE_DRAINING;
+        } else {
+            p->status[i] = SETPOINT_STAGE_OFF;
+        }
+    }
+
+    update_run_list(p);
+}
+
+void setpoint_pipeline_request(SetpointPipeline *p, uint32_t enabled) {
+    __atomic_store_n(&p->requested, enabled | REQUEST_PENDING, __ATOMIC_RELEASE);
+}
+
+void setpoint_pipeline_adopt(SetpointPipeline *p, const void *arg) {
+    if (__atomic_load_n(&p->reset_timing, __ATOMIC_ACQUIRE)) {
+        memset(p->timings, 0, sizeof(p->timings));
+        p->reset_timing = false;
+    }
+
+    if (!__atomic_load_n(&p->requested, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    uint32_t requested = __atomic_exchange_n(&p->requested, 0, __ATOMIC_ACQUIRE);
+    if (requested & REQUEST_PENDING) {
+        setpoint_pipeline_compile(p, requested & ~REQUEST_PENDING, arg);
+    }
+}
+
+static void drain(SetpointPipeline *p, const void *arg) {
+    bool changed = false;
+    for (uint8_t i = 0; i < p->run_count; ++i) {
+        uint8_t s = p->run[i];
+        if (p->status[s] == SETPOINT_STAGE_DRAINING && p->stages[s].settled(arg)) {
+            p->status[s] = SETPOINT_STAGE_OFF;
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        update_run_list(p);
+    }
+}
+
+static void run_timed(SetpointPipeline *p, void *arg) {
+    uint32_t start = loop_timing_now();
+    for (uint8_t i = 0; i < p->run_count; ++i) {
+        uint8_t s = p->run[i];
+        p->stages[s].apply(arg);
+
+        // One counter read per stage, each stage ends where the next starts
+        uint32_t now = loop_timing_now();
+        uint32_t ticks = now - start;
+        start = now;
+
+        SetpointStageTiming *t = &p->timings[s];
+        ++t->count;
+        t->sum += ticks;
+        if (ticks > t->max) {
+            t->max = ticks;
+        }
+    }
+}
+
+void setpoint_pipeline_run(SetpointPipeline *p, void *arg) {
+    if (p->timing) {
+        run_timed(p, arg);
+    } else {
+        for (uint8_t i = 0; i < p->run_count; ++i) {
+            p->stages[p->run[i]].apply(arg);
+        }
+    }
+
+    if (p->draining) {
+        drain(p, arg);
+    }
+}
+
+void setpoint_pipeline_set_timing(SetpointPipeline *p, bool timing) {
+    if (timing) {
+        loop_timing_start_counter();
+    }
+    p->timing = timing;
+}
+
+void setpoint_pipeline_reset_timing(SetpointPipeline *p) {
+    __atomic_store_n(&p->reset_timing, true, __ATOMIC_RELEASE);
+}
+
+void setpoint_pipeline_cmd_inspect(
+    SetpointPipeline *p, uint8_t magic, uint8_t command, uint8_t *cfg, int len
+) {
+    if (len >= 1) {
+        setpoint_pipeline_set_timing(p, cfg[0] & 0x1);
+    }
+
+    uint8_t buffer[8 + SETPOINT_PIPELINE_MAX_STAGES * 13];
+    int32_t ind = 0;
+
+    buffer[ind++] = magic;
+    buffer[ind++] = command;
+    buffer[ind++] = p->timing;
+    buffer_append_uint32(buffer, LOOP_TIMING_TICKS_PER_US, &ind);
+    buffer[ind++] = p->stage_count;
+    for (uint8_t i = 0; i < p->stage_count; ++i) {
+        const SetpointStageTiming *t = &p->timings[i];
+        buffer[ind++] = p->status[i];
+        buffer_append_uint32(buffer, t->count, &ind);
+        buffer_append_uint32(buffer, t->max, &ind);
+        buffer_append_float32_auto(buffer, t->count ? (float) t->sum / t->count : 0, &ind);
+    }
+
+    VESC_IF->send_app_data(buffer, ind);
+
+    if (len >= 1 && (cfg[0] & 0x2)) {
+        setpoint_pipeline_reset_timing(p);
+    }
+}
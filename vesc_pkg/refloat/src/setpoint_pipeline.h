@@ -0,0 +1,126 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SETPOINT_PIPELINE_MAX_STAGES 8
+
+typedef void (*SetpointStageApply)(void *arg);
+typedef bool (*SetpointStageSettled)(const void *arg);
+
+typedef struct {
+    SetpointStageApply apply;
+    // Whether the stage's contribution to the setpoint is back at zero. A stage
+    // that has this keeps running after it gets disabled until it settles, so
+    // that its offset winds down instead of snapping off. NULL for stages
+    // which stop contributing as soon as they're disabled.
+    SetpointStageSettled settled;
+} SetpointStage;
+
+typedef enum {
+    SETPOINT_STAGE_OFF = 0,
+    SETPOINT_STAGE_ON,
+    SETPOINT_STAGE_DRAINING,  // disabled, running until settled
+} SetpointStageStatus;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+} SetpointStageTiming;
+
+/**
+ * Runs the setpoint modifiers from a registered stage table. The table is
+ * compiled into a list of the stages that are enabled by the config, so the
+ * ones which are off cost nothing per iteration. Optionally measures the
+ * cycles every stage takes.
+ */
+typedef struct {
+    const SetpointStage *stages;
+    uint8_t stage_count;
+
+    SetpointStageStatus status[SETPOINT_PIPELINE_MAX_STAGES];
+
+    // Indices of the stages to run, in the order of the table
+    uint8_t run[SETPOINT_PIPELINE_MAX_STAGES];
+    uint8_t run_count;
+    uint8_t draining;
+
+    // Mask last requested by setpoint_pipeline_request(), shared with the
+    // threads that change the config (accessed atomically)
+    uint32_t requested;
+
+    bool timing;
+    SetpointStageTiming timings[SETPOINT_PIPELINE_MAX_STAGES];
+    // Set by setpoint_pipeline_reset_timing(), adopted with the mask
+    volatile bool reset_timing;
+} SetpointPipeline;
+
+void setpoint_pipeline_init(SetpointPipeline *p, const SetpointStage *stages, uint8_t count);
+
+/**
+ * Compiles the run list from @p enabled, a bit mask of the stages in the
+ * order of the table. Stages which get disabled while their contribution
+ * isn't settled keep running until it is.
+ *
+ * Only to be called from the thread that runs the pipeline, other threads
+ * use setpoint_pipeline_request().
+ */
+void setpoint_pipeline_compile(SetpointPipeline *p, uint32_t enabled, const void *arg);
+
+/**
+ * Requests the run list for @p enabled from any thread. The thread running
+ * the pipeline compiles it in its next setpoint_pipeline_adopt(), the last
+ * request wins.
+ */
+void setpoint_pipeline_request(SetpointPipeline *p, uint32_t enabled);
+
+/**
+ * Compiles the run list for a pending request and resets the timing
+ * statistics if requested. Called by the thread running the pipeline between
+ * its runs.
+ */
+void setpoint_pipeline_adopt(SetpointPipeline *p, const void *arg);
+
+void setpoint_pipeline_run(SetpointPipeline *p, void *arg);
+
+/**
+ * Turns the per-stage cycle counting on or off. Without it, running the
+ * pipeline doesn't read the cycle counter at all.
+ */
+void setpoint_pipeline_set_timing(SetpointPipeline *p, bool timing);
+
+/**
+ * Requests a reset of the timing statistics from any thread, done in the next
+ * setpoint_pipeline_adopt().
+ */
+void setpoint_pipeline_reset_timing(SetpointPipeline *p);
+
+/**
+ * Command to inspect the pipeline.
+ *
+ * Request: optional flags (uint8): bit 0 turns the cycle counting on (off
+ * when clear), bit 1 resets the statistics after reading them.
+ * Response: cycle counting on (uint8), counter ticks per microsecond
+ * (uint32), number of stages (uint8), then for each stage in the order of the
+ * table: status (uint8, SetpointStageStatus), number of timed runs, max ticks
+ * (uint32) and mean ticks (float32_auto).
+ */
+void setpoint_pipeline_cmd_inspect(
+    SetpointPipeline *p, uint8_t magic, uint8_t command, uint8_t *cfg, int len
+);
@@ -0,0 +1,233 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "telemetry.h"
+
+#include "conf/buffer.h"
+#include "utils.h"
+
+#include <string.h>
+
+#define TELEMETRY_STACK_SIZE 1024
+#define TELEMETRY_IDLE_US 100000
+// Max frame: magic, command, counter, mask and the fields, at worst in the
+// compact format with the state as three fields
+#define TELEMETRY_FRAME_SIZE (2 + 2 + 4 + COMPACT_FRAME_MAX_SIZE(TELEMETRY_FIELD_COUNT + 2))
+
+static const float scales[TELEMETRY_FIELD_COUNT] = {
+    [TELEMETRY_PITCH] = 100,
+    [TELEMETRY_BALANCE_PITCH] = 100,
+    [TELEMETRY_ROLL] = 100,
+    [TELEMETRY_SETPOINT] = 100,
+    [TELEMETRY_ATR_OFFSET] = 100,
+    [TELEMETRY_BRAKETILT_OFFSET] = 100,
+    [TELEMETRY_TORQUETILT_OFFSET] = 100,
+    [TELEMETRY_TURNTILT_OFFSET] = 100,
+    [TELEMETRY_INPUTTILT_OFFSET] = 100,
+    [TELEMETRY_PID_VALUE] = 10,
+    [TELEMETRY_BOOSTER_CURRENT] = 10,
+    [TELEMETRY_MOTOR_CURRENT] = 10,
+    [TELEMETRY_FILTERED_CURRENT] = 10,
+    [TELEMETRY_ERPM] = 1,
+    [TELEMETRY_DUTY_CYCLE] = 1000,
+    [TELEMETRY_FOOTPAD_ADC1] = 1000,
+    [TELEMETRY_FOOTPAD_ADC2] = 1000,
+    [TELEMETRY_THROTTLE] = 1000,
+    [TELEMETRY_ACCEL_DIFF] = 100,
+};
+
+static void telemetry_thd(void *arg);
+
+bool telemetry_init(Telemetry *t, uint8_t magic, uint8_t frame_command) {
+    memset(t, 0, sizeof(Telemetry));
+    t->magic = magic;
+    t->frame_command = frame_command;
+
+    t->thread = VESC_IF->spawn(telemetry_thd, TELEMETRY_STACK_SIZE, "Refloat Telemetry", t);
+    return t->thread != NULL;
+}
+
+void telemetry_stop(Telemetry *t) {
+    t->mask = 0;
+    if (t->thread) {
+        VESC_IF->request_terminate(t->thread);
+        t->thread = NULL;
+    }
+}
+
+TelemetrySnapshot *telemetry_publish_begin(Telemetry *t) {
+    __atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return &t->snapshot;
+}
+
+void telemetry_publish_end(Telemetry *t) {
+    __atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELEASE);
+}
+
+// Copies the snapshot, retrying if the loop published in the meantime. The
+// loop runs at a higher priority and a copy takes far less than an iteration,
+// so this rarely takes more than one attempt.
+static void read_snapshot(Telemetry *t, TelemetrySnapshot *snapshot) {
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(snapshot, &t->snapshot, sizeof(TelemetrySnapshot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&t->seq, __ATOMIC_RELAXED));
+}
+
+static void append_int16_fields(
+    const TelemetrySnapshot *s, uint32_t mask, uint8_t *buffer, int32_t *ind
+) {
+    if (mask & (1u << TELEMETRY_STATE)) {
+        buffer[(*ind)++] = s->state;
+        buffer[(*ind)++] = s->flags;
+        buffer[(*ind)++] = s->sat;
+    }
+
+    for (int i = TELEMETRY_STATE + 1; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (mask & (1u << i)) {
+            float value = clampf(s->values[i] * scales[i], INT16_MIN, INT16_MAX);
+            buffer_append_int16(buffer, (int16_t) value, ind);
+        }
+    }
+}
+
+static void append_compact_fields(
+    Telemetry *t, const TelemetrySnapshot *s, uint32_t mask, uint8_t *buffer, int32_t *ind
+) {
+    float values[TELEMETRY_FIELD_COUNT + 2];
+    float field_scales[TELEMETRY_FIELD_COUNT + 2];
+    uint8_t count = 0;
+
+    if (mask & (1u << TELEMETRY_STATE)) {
+        const uint8_t state[] = {s->state, s->flags, s->sat};
+        for (int i = 0; i < 3; ++i) {
+            values[count] = state[i];
+            field_scales[count++] = 1;
+        }
+    }
+
+    for (int i = TELEMETRY_STATE + 1; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (mask & (1u << i)) {
+            values[count] = s->values[i];
+            field_scales[count++] = scales[i];
+        }
+    }
+
+    *ind += compact_frame_encode(&t->encoder, values, field_scales, count, buffer + *ind);
+}
+
+static void send_frame(Telemetry *t, uint32_t mask, TelemetryFormat format) {
+    TelemetrySnapshot s;
+    read_snapshot(t, &s);
+
+    uint8_t buffer[TELEMETRY_FRAME_SIZE];
+    int32_t ind = 0;
+    buffer[ind++] = t->magic;
+    buffer[ind++] = t->frame_command;
+    buffer_append_uint16(buffer, t->frame++, &ind);
+    buffer_append_uint32(buffer, mask, &ind);
+
+    if (format == TELEMETRY_FORMAT_COMPACT) {
+        append_compact_fields(t, &s, mask, buffer, &ind);
+    } else {
+        append_int16_fields(&s, mask, buffer, &ind);
+    }
+
+    VESC_IF->send_app_data(buffer, ind);
+}
+
+static void telemetry_thd(void *arg) {
+    Telemetry *t = arg;
+
+    while (!VESC_IF->should_terminate()) {
+        uint32_t mask = t->mask;
+        float expires = t->expires;
+        if (mask && expires > 0 && VESC_IF->system_time() > expires) {
+            t->mask = mask = 0;
+        }
+
+        if (!mask) {
+            VESC_IF->sleep_us(TELEMETRY_IDLE_US);
+            continue;
+        }
+
+        if (t->restart) {
+            t->restart = false;
+            t->frame = 0;
+            compact_frame_encoder_init(&t->encoder, t->rate);
+        }
+
+        // Sleep for the rest of the period to keep a steady rate
+        uint32_t start = VESC_IF->timer_time_now();
+        send_frame(t, mask, t->format);
+        uint32_t period_us = t->period_us;
+        uint32_t spent_us = VESC_IF->timer_seconds_elapsed_since(start) * 1e6f;
+        VESC_IF->sleep_us(spent_us < period_us ? period_us - spent_us : 1);
+    }
+}
+
+void telemetry_cmd_subscribe(Telemetry *t, uint8_t magic, uint8_t command, uint8_t *cfg, int len) {
+    if (len < 5) {
+        log_error("Command data length incorrect: %u", len);
+        return;
+    }
+
+    int32_t ind = 0;
+    uint32_t mask = buffer_get_uint32(cfg, &ind) & ((1u << TELEMETRY_FIELD_COUNT) - 1);
+    uint8_t rate = cfg[ind++];
+    uint8_t timeout = len >= 6 ? cfg[ind++] : 0;
+    uint8_t format = len >= 7 ? cfg[ind++] : TELEMETRY_FORMAT_INT16;
+    if (format > TELEMETRY_FORMAT_COMPACT) {
+        format = TELEMETRY_FORMAT_INT16;
+    }
+
+    if (rate == 0) {
+        mask = 0;
+    } else if (rate > TELEMETRY_MAX_RATE_HZ) {
+        rate = TELEMETRY_MAX_RATE_HZ;
+    }
+
+    if (!t->thread) {
+        mask = 0;
+    }
+
+    if (mask) {
+        // Pause the thread while the subscription changes
+        t->mask = 0;
+        t->period_us = 1000000 / rate;
+        t->expires = timeout ? VESC_IF->system_time() + timeout : 0;
+        t->rate = rate;
+        t->format = format;
+        t->restart = true;
+    } else {
+        rate = 0;
+    }
+    t->mask = mask;
+
+    uint8_t buffer[8];
+    ind = 0;
+    buffer[ind++] = magic;
+    buffer[ind++] = command;
+    buffer_append_uint32(buffer, mask, &ind);
+    buffer[ind++] = rate;
+    buffer[ind++] = format;
+    VESC_IF->send_app_data(buffer, ind);
+}
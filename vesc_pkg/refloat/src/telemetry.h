@@ -0,0 +1,129 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "compact_frame.h"
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TELEMETRY_MAX_RATE_HZ 100
+
+// Fields a subscription can select, the bit index in the mask. Every field
+// but TELEMETRY_STATE is sent as int16 of the value times its scale.
+typedef enum {
+    TELEMETRY_STATE = 0,  // 3 bytes, see TelemetrySnapshot
+    TELEMETRY_PITCH,  // deg * 100
+    TELEMETRY_BALANCE_PITCH,  // deg * 100
+    TELEMETRY_ROLL,  // deg * 100
+    TELEMETRY_SETPOINT,  // deg * 100
+    TELEMETRY_ATR_OFFSET,  // deg * 100
+    TELEMETRY_BRAKETILT_OFFSET,  // deg * 100
+    TELEMETRY_TORQUETILT_OFFSET,  // deg * 100
+    TELEMETRY_TURNTILT_OFFSET,  // deg * 100
+    TELEMETRY_INPUTTILT_OFFSET,  // deg * 100
+    TELEMETRY_PID_VALUE,  // A * 10
+    TELEMETRY_BOOSTER_CURRENT,  // A * 10
+    TELEMETRY_MOTOR_CURRENT,  // A * 10
+    TELEMETRY_FILTERED_CURRENT,  // A * 10
+    TELEMETRY_ERPM,  // erpm
+    TELEMETRY_DUTY_CYCLE,  // * 1000
+    TELEMETRY_FOOTPAD_ADC1,  // V * 1000
+    TELEMETRY_FOOTPAD_ADC2,  // V * 1000
+    TELEMETRY_THROTTLE,  // * 1000
+    TELEMETRY_ACCEL_DIFF,  // * 100
+    TELEMETRY_FIELD_COUNT
+} TelemetryField;
+
+typedef enum {
+    // Every field as in TelemetryField
+    TELEMETRY_FORMAT_INT16 = 0,
+    // A compact_frame.h frame of the fixed-point fields with the same scales,
+    // the state as three fields with a scale of 1. Keyframe once a second.
+    TELEMETRY_FORMAT_COMPACT,
+} TelemetryFormat;
+
+typedef struct {
+    uint8_t state;  // mode << 4 | state
+    uint8_t flags;  // footpad state << 6 | charging << 5 | darkride << 1 | wheelslip
+    uint8_t sat;  // sat << 4 | stop condition
+    float values[TELEMETRY_FIELD_COUNT];  // by TelemetryField, TELEMETRY_STATE unused
+} TelemetrySnapshot;
+
+/**
+ * Pushes telemetry frames to a subscribed client at a steady rate, from a
+ * thread of its own. The control loop publishes a snapshot every iteration
+ * while there is a subscription, the thread reads the fields selected by the
+ * subscription from it. The snapshot is guarded by a sequence counter, so the
+ * loop never waits for the reader.
+ */
+typedef struct {
+    // Subscription, written by the command handler
+    volatile uint32_t mask;
+    volatile uint32_t period_us;
+    volatile float expires;  // system time, 0 for never
+    volatile uint8_t rate;
+    volatile TelemetryFormat format;
+    volatile bool restart;  // set on subscribing, the next frame starts over
+    uint8_t magic, frame_command;
+
+    volatile uint32_t seq;  // odd while the loop writes the snapshot
+    TelemetrySnapshot snapshot;
+
+    uint16_t frame;
+    CompactFrameEncoder encoder;
+    lib_thread thread;
+} Telemetry;
+
+/**
+ * Spawns the telemetry thread, which idles until there's a subscription.
+ *
+ * @return false if the thread couldn't be spawned, subscriptions are refused
+ * then.
+ */
+bool telemetry_init(Telemetry *t, uint8_t magic, uint8_t frame_command);
+
+void telemetry_stop(Telemetry *t);
+
+static inline bool telemetry_active(const Telemetry *t) {
+    return t->mask != 0;
+}
+
+/**
+ * Returns the snapshot for the loop to fill in, to be followed by
+ * telemetry_publish_end() once it's complete.
+ */
+TelemetrySnapshot *telemetry_publish_begin(Telemetry *t);
+
+void telemetry_publish_end(Telemetry *t);
+
+/**
+ * Command to subscribe to the telemetry.
+ *
+ * Request: field mask (uint32, bits by TelemetryField, 0 unsubscribes), rate
+ * in Hz (uint8, limited to TELEMETRY_MAX_RATE_HZ), optionally a timeout in
+ * seconds (uint8) after which the subscription ends unless renewed, 0 or
+ * absent for none, and optionally the TelemetryFormat (uint8, default int16).
+ * Response: the accepted field mask (uint32), rate and format (uint8).
+ *
+ * Frames come with the frame command: frame counter (uint16), field mask
+ * (uint32), then the selected fields in the order of TelemetryField, in the
+ * subscribed format. The counter starts over with every subscription, a gap
+ * in it means lost frames.
+ */
+void telemetry_cmd_subscribe(Telemetry *t, uint8_t magic, uint8_t command, uint8_t *cfg, int len);
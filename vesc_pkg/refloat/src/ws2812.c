@@ -0,0 +1,83 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "ws2812.h"
+
+#include <string.h>
+
+// (c * c + c) / 256
+#define G(c) (((c) * (c) + (c)) / 256)
+#define G4(c) G(c), G(c + 1), G(c + 2), G(c + 3)
+#define G16(c) G4(c), G4(c + 4), G4(c + 8), G4(c + 12)
+#define G64(c) G16(c), G16(c + 16), G16(c + 32), G16(c + 48)
+
+static const uint8_t gamma_table[256] = {G64(0), G64(64), G64(128), G64(192)};
+
+#define B(n, bit) ((n) & (1 << (bit)) ? (uint16_t) WS2812_ONE : (uint16_t) WS2812_ZERO)
+#define N(n) {B(n, 3), B(n, 2), B(n, 1), B(n, 0)}
+
+static const uint16_t nibble_table[16][4] = {
+    N(0x0),
+    N(0x1),
+    N(0x2),
+    N(0x3),
+    N(0x4),
+    N(0x5),
+    N(0x6),
+    N(0x7),
+    N(0x8),
+    N(0x9),
+    N(0xA),
+    N(0xB),
+    N(0xC),
+    N(0xD),
+    N(0xE),
+    N(0xF),
+};
+
+static inline void expand_byte(uint16_t *out, uint8_t byte) {
+    memcpy(out, nibble_table[byte >> 4], sizeof(nibble_table[0]));
+    memcpy(out + 4, nibble_table[byte & 0xF], sizeof(nibble_table[0]));
+}
+
+void ws2812_encode(
+    uint16_t *bitbuffer,
+    const uint32_t *colors,
+    uint32_t length,
+    uint8_t bit_nr,
+    LedColorOrder color_order
+) {
+    for (uint32_t i = 0; i < length; ++i) {
+        uint32_t color = colors[i];
+        uint8_t w = gamma_table[(color >> 24) & 0xFF];
+        uint8_t r = gamma_table[(color >> 16) & 0xFF];
+        uint8_t g = gamma_table[(color >> 8) & 0xFF];
+        uint8_t b = gamma_table[color & 0xFF];
+
+        uint16_t *out = bitbuffer + i * bit_nr;
+        if (color_order == LED_COLOR_GRB) {
+            expand_byte(out, g);
+            expand_byte(out + 8, r);
+        } else {
+            expand_byte(out, r);
+            expand_byte(out + 8, g);
+        }
+        expand_byte(out + 16, b);
+
+        if (bit_nr == 32) {
+            expand_byte(out + 24, w);
+        }
+    }
+}
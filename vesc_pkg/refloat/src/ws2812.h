@@ -0,0 +1,42 @@
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "conf/datatypes.h"
+
+#include <stdint.h>
+
+// WS2812 bit timing as timer compare values, one halfword per bit in the DMA
+// bitbuffer, on a timer at half of the 168 MHz core clock
+#define WS2812_CLK_HZ 800000
+#define WS2812_TIM_PERIOD ((168000000 / 2 / WS2812_CLK_HZ) - 1)
+#define WS2812_ZERO (WS2812_TIM_PERIOD * 0.3)
+#define WS2812_ONE (WS2812_TIM_PERIOD * 0.7)
+
+/**
+ * Gamma-corrects @p length colors (0xWWRRGGBB) and expands them into
+ * @p bitbuffer, @p bit_nr (24 for RGB, 32 for RGBW) halfwords per LED, most
+ * significant bit first, white last.
+ *
+ * Every byte is two copies from a table of the 4 halfwords of each nibble.
+ */
+void ws2812_encode(
+    uint16_t *bitbuffer,
+    const uint32_t *colors,
+    uint32_t length,
+    uint8_t bit_nr,
+    LedColorOrder color_order
+);
@@ -0,0 +1,37 @@
+#include "window.h"
+
+void window_init(Window *w, float *buffer, uint8_t capacity, uint8_t length) {
+    w->data = buffer;
+    w->mask = capacity - 1;
+    w->length = length;
+    w->inv_length = 1.0f / length;
+    w->extrema = false;
+    window_reset(w);
+}
+
+void window_track_extrema(Window *w, uint8_t *buffer) {
+    w->min_deque.indices = buffer;
+    w->max_deque.indices = buffer + w->mask + 1;
+    w->extrema = true;
+    window_reset(w);
+}
+
+void window_reset(Window *w) {
+    for (int i = 0; i <= w->mask; i++) {
+        w->data[i] = 0;
+    }
+    w->head = 0;
+    w->mean = 0;
+    w->m2 = 0;
+
+    if (w->extrema) {
+        // All the samples are zero, the newest one stays in the window the
+        // longest and stands for all of them.
+        w->min_deque.indices[0] = w->mask;
+        w->min_deque.front = 0;
+        w->min_deque.back = 1;
+        w->max_deque.indices[0] = w->mask;
+        w->max_deque.front = 0;
+        w->max_deque.back = 1;
+    }
+}
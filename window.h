@@ -0,0 +1,210 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The longest window, buffer indices are 8-bit
+#define WINDOW_MAX_LENGTH 128
+
+/**
+ * Capacity of a window buffer able to hold @p length samples, rounded up to a
+ * power of two so that indexing is a mask instead of a modulo. Usable in
+ * array declarations, only valid for lengths up to WINDOW_MAX_LENGTH, which
+ * WINDOW_INIT checks.
+ */
+#define WINDOW_CAPACITY(length)                                                                    \
+    ((length) <= 4        ? 4                                                                      \
+         : (length) <= 8  ? 8                                                                      \
+         : (length) <= 16 ? 16                                                                     \
+         : (length) <= 32 ? 32                                                                     \
+         : (length) <= 64 ? 64                                                                     \
+                          : WINDOW_MAX_LENGTH)
+
+/**
+ * Initializes @p window over the array @p buffer, which has to be declared
+ * with WINDOW_CAPACITY(length) elements.
+ */
+#define WINDOW_INIT(window, buffer, length)                                                        \
+    do {                                                                                           \
+        _Static_assert(                                                                            \
+            (length) <= WINDOW_MAX_LENGTH, "window length has to be at most WINDOW_MAX_LENGTH"     \
+        );                                                                                         \
+        _Static_assert(                                                                            \
+            sizeof(buffer) / sizeof((buffer)[0]) == WINDOW_CAPACITY(length),                       \
+            "window buffer has to have WINDOW_CAPACITY(length) elements"                           \
+        );                                                                                         \
+        window_init(window, buffer, WINDOW_CAPACITY(length), length);                              \
+    } while (0)
+
+/**
+ * Like WINDOW_INIT, additionally tracking the minimum and maximum of the
+ * window in the array @p extrema_buffer, which has to be declared with
+ * WINDOW_EXTREMA_CAPACITY(length) elements.
+ */
+#define WINDOW_EXTREMA_CAPACITY(length) (2 * WINDOW_CAPACITY(length))
+
+#define WINDOW_INIT_EXTREMA(window, buffer, extrema_buffer, length)                                \
+    do {                                                                                           \
+        WINDOW_INIT(window, buffer, length);                                                       \
+        _Static_assert(                                                                            \
+            sizeof(extrema_buffer) / sizeof((extrema_buffer)[0]) ==                                \
+                WINDOW_EXTREMA_CAPACITY(length),                                                   \
+            "extrema buffer has to have WINDOW_EXTREMA_CAPACITY(length) elements"                  \
+        );                                                                                         \
+        window_track_extrema(window, extrema_buffer);                                              \
+    } while (0)
+
+/**
+ * Sliding window over the last `length` samples of a signal, with the mean and
+ * variance kept up to date incrementally in O(1) per sample.
+ *
+ * The window always holds `length` samples, it starts out filled with zeros.
+ *
+ * Optionally, the minimum and maximum are tracked with a pair of monotonic
+ * deques of buffer indices: the max deque holds the samples that can still
+ * become the maximum (each one greater than all newer samples), in order of
+ * age, so the maximum is always at its front. Every sample is pushed and
+ * popped at most once, which makes the update amortized O(1).
+ */
+typedef struct {
+    uint8_t *indices;
+    uint8_t front;
+    uint8_t back;  // one past the newest entry
+} WindowDeque;
+
+typedef struct {
+    float *data;
+    uint8_t mask;
+    uint8_t length;
+    uint8_t head;  // index of the next sample to be written
+    float inv_length;
+
+    float mean;
+    float m2;  // sum of squared differences from the mean
+
+    bool extrema;
+    WindowDeque min_deque;
+    WindowDeque max_deque;
+} Window;
+
+void window_init(Window *w, float *buffer, uint8_t capacity, uint8_t length);
+
+/**
+ * Enables min/max tracking, @p buffer has to hold 2 * capacity of the window
+ * elements.
+ */
+void window_track_extrema(Window *w, uint8_t *buffer);
+
+void window_reset(Window *w);
+
+/**
+ * Returns the sample @p age steps back, 0 being the newest one and
+ * `length - 1` the oldest one still in the window.
+ */
+static inline float window_get(const Window *w, uint8_t age) {
+    return w->data[(uint8_t) (w->head - 1 - age) & w->mask];
+}
+
+static inline float window_newest(const Window *w) {
+    return window_get(w, 0);
+}
+
+static inline float window_oldest(const Window *w) {
+    return window_get(w, w->length - 1);
+}
+
+static inline bool window_deque_empty(const WindowDeque *q) {
+    return q->front == q->back;
+}
+
+static inline uint8_t window_deque_first(const Window *w, const WindowDeque *q) {
+    return q->indices[q->front & w->mask];
+}
+
+static inline uint8_t window_deque_last(const Window *w, const WindowDeque *q) {
+    return q->indices[(uint8_t) (q->back - 1) & w->mask];
+}
+
+// Drops the sample at buffer index @p leaving from the front of the deques if
+// it's there, has to be done before its slot is reused.
+static inline void window_extrema_expire(Window *w, uint8_t leaving) {
+    WindowDeque *max_q = &w->max_deque;
+    WindowDeque *min_q = &w->min_deque;
+
+    if (!window_deque_empty(max_q) && window_deque_first(w, max_q) == leaving) {
+        ++max_q->front;
+    }
+    if (!window_deque_empty(min_q) && window_deque_first(w, min_q) == leaving) {
+        ++min_q->front;
+    }
+}
+
+// Appends the newest sample, dropping all the samples it outlives.
+static inline void window_extrema_insert(Window *w, uint8_t index, float value) {
+    WindowDeque *max_q = &w->max_deque;
+    WindowDeque *min_q = &w->min_deque;
+
+    while (!window_deque_empty(max_q) && w->data[window_deque_last(w, max_q)] <= value) {
+        --max_q->back;
+    }
+    max_q->indices[max_q->back++ & w->mask] = index;
+
+    while (!window_deque_empty(min_q) && w->data[window_deque_last(w, min_q)] >= value) {
+        --min_q->back;
+    }
+    min_q->indices[min_q->back++ & w->mask] = index;
+}
+
+static inline void window_push(Window *w, float value) {
+    uint8_t leaving = (uint8_t) (w->head - w->length) & w->mask;
+    float old = w->data[leaving];
+    float old_mean = w->mean;
+    float delta = value - old;
+
+    w->mean += delta * w->inv_length;
+    w->m2 += delta * (value - w->mean + old - old_mean);
+    if (w->m2 < 0) {
+        w->m2 = 0;
+    }
+
+    uint8_t index = w->head;
+    if (w->extrema) {
+        window_extrema_expire(w, leaving);
+    }
+
+    w->data[index] = value;
+    w->head = (w->head + 1) & w->mask;
+
+    if (w->extrema) {
+        window_extrema_insert(w, index, value);
+    }
+}
+
+static inline float window_mean(const Window *w) {
+    return w->mean;
+}
+
+/**
+ * Population variance of the samples in the window.
+ */
+static inline float window_variance(const Window *w) {
+    return w->m2 * w->inv_length;
+}
+
+/**
+ * Minimum of the samples in the window, requires extrema tracking.
+ */
+static inline float window_min(const Window *w) {
+    return w->data[window_deque_first(w, &w->min_deque)];
+}
+
+/**
+ * Maximum of the samples in the window, requires extrema tracking.
+ */
+static inline float window_max(const Window *w) {
+    return w->data[window_deque_first(w, &w->max_deque)];
+}
+
+static inline float window_peak_to_peak(const Window *w) {
+    return window_max(w) - window_min(w);
+}